@@ -24,12 +24,18 @@
 #include "stm32wbxx_core_interface_def.h"
 #include "tl.h"
 #include <string.h>
+#include <stdbool.h>
 
+/* Exported types ------------------------------------------------------------*/
+/* Completion callback of an asynchronous command to the M0 (task context),
+ * p_cmd then holds the response of the M0 */
+typedef void (*ZIGBEE_CmdCallback_t)(Zigbee_Cmd_Request_t *p_cmd, void *arg);
 
 /* Exported functions  ------------------------------------------------------------*/
 void Pre_ZigbeeCmdProcessing(void);
 void Post_ZigbeeCmdProcessing(void);
 void ZIGBEE_CmdTransfer(void);
+bool ZIGBEE_CmdTransferAsync(Zigbee_Cmd_Request_t *p_cmd, ZIGBEE_CmdCallback_t callback, void *arg);
 Zigbee_Cmd_Request_t* ZIGBEE_Get_OTCmdPayloadBuffer(void);
 Zigbee_Cmd_Request_t* ZIGBEE_Get_OTCmdRspPayloadBuffer(void);
 Zigbee_Cmd_Request_t* ZIGBEE_Get_NotificationPayloadBuffer(void);
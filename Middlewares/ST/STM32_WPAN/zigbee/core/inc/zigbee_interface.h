@@ -27,6 +27,7 @@ extern "C" {
 #include "zigbee_types.h"
 #include "stm32wbxx_core_interface_def.h"
 #include "zigbee.h"
+#include "zcl/zcl.h"
 
 /*---------------------------------------------------------------
  * Well-Known Zigbee Security Keys
@@ -50,11 +51,61 @@ extern const uint8_t sec_key_touchlink_cert[ZB_SEC_KEYSIZE];
 
 /* Exported defines ----------------------------------------------------------*/
 /* Exported types ------------------------------------------------------------*/
+/* Usage of the callback info pool of the asynchronous requests */
+struct ZbIpcCbPoolStatsT {
+    unsigned int size; /* entries in the pool */
+    unsigned int in_use; /* entries allocated */
+    unsigned int high_water; /* max of in_use */
+    unsigned int exhausted; /* allocations done while the pool was empty */
+    unsigned int heap_in_use; /* allocations from the heap not freed yet */
+};
+
+/* Usage of the heap serving the memory requests of the M0 */
+struct ZbM0HeapStatsT {
+    unsigned int size; /* bytes of the heap region */
+    unsigned int used; /* bytes of the allocated blocks */
+    unsigned int requested; /* bytes requested for them (used - requested: internal fragmentation) */
+    unsigned int used_max; /* max of used */
+    unsigned int free_blocks; /* number of free blocks */
+    unsigned int largest_free; /* bytes of the largest free block (vs size - used: external fragmentation) */
+    unsigned int alloc_cnt; /* allocations served by the region */
+    unsigned int fallback_cnt; /* allocations served by malloc(), region full */
+    unsigned int fail_cnt; /* allocations failed */
+};
+
 /* Exported constants --------------------------------------------------------*/
 /* External variables --------------------------------------------------------*/
 /* Exported macros -----------------------------------------------------------*/
 /* Exported functions ------------------------------------------------------- */
 
+/* Same as ZbZclClusterCommandReq(), without waiting for the M0: the request
+ * (and its payload) is copied, then sent through ZIGBEE_CmdTransferAsync()
+ * once the previous commands to the M0 are done. Returns
+ * ZCL_STATUS_INSUFFICIENT_SPACE if it can't be queued, a failure of the M0
+ * is reported through the callback (as by ZbZclClusterCommandReqDelayed()). */
+enum ZclStatusCodeT ZbZclClusterCommandReqAsync(struct ZbZclClusterT *clusterPtr, struct ZbZclClusterCommandReqT *req,
+    void (*callback)(struct ZbZclCommandRspT *zcl_rsp, void *arg), void *arg);
+
+/* Usage counters of the callback info pool (ZB_IPC_CB_INFO_POOL_SZ entries),
+ * the heap being used once it is exhausted */
+void ZbIpcCbPoolStats(struct ZbIpcCbPoolStatsT *stats);
+
+/* Usage counters of the heap region (2^ZB_M0_HEAP_ORDER bytes) serving the
+ * memory requests of the M0 */
+void ZbM0HeapStats(struct ZbM0HeapStatsT *stats);
+
+/* Reports through print (one line per call) the memory allocated by the M0
+ * and not freed yet. With CONFIG_ZB_M4_MALLOC_DEBUG_SZ, each live allocation
+ * is listed (the leaks during a soak test), followed by the peak usage and
+ * the size class histograms. */
+void zb_malloc_report(void (*print)(const char *fmt, ...));
+
+/* Dumps through print (one line per call) the memory requests of the M0
+ * recorded since the previous dump, when built with CONFIG_ZB_M0_HEAP_TRACE_SZ:
+ * "a <ptr> <size>" or "f <ptr>", the trace format replayed by the host
+ * benchmark of the M0 heap (Tests/Host/Traces). */
+void ZbM0HeapTraceDump(void (*print)(const char *fmt, ...));
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
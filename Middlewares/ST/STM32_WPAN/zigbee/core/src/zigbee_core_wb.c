@@ -50,6 +50,12 @@
 #define ZB_HEAP_MAX_ALLOC                   2000U
 #endif
 
+/* Callback info of the pending asynchronous requests taken from a static
+ * pool, the heap being used only once the pool is exhausted */
+#ifndef ZB_IPC_CB_INFO_POOL_SZ
+#define ZB_IPC_CB_INFO_POOL_SZ              16U
+#endif
+
 /* Protyptes (move to header file? */
 void zb_ipc_m4_stack_logging_config(bool enable);
 unsigned int ZbHeapMaxAlloc(void);
@@ -88,15 +94,97 @@ void zb_heap_free(struct ZigBeeT *zb, void *ptr, const char *funcname, unsigned
 /* #define CONFIG_ZB_M4_MALLOC_DEBUG_SZ            512U */
 
 #ifdef CONFIG_ZB_M4_MALLOC_DEBUG_SZ
+/* The live allocations are kept in an open addressing hash table keyed by
+ * pointer (linear probing, removal by backward shift so there are no
+ * tombstones). It is filled up to 3/4 of CONFIG_ZB_M4_MALLOC_DEBUG_SZ to
+ * keep the probe sequences short. */
+#if ((CONFIG_ZB_M4_MALLOC_DEBUG_SZ & (CONFIG_ZB_M4_MALLOC_DEBUG_SZ - 1U)) != 0U)
+#error "CONFIG_ZB_M4_MALLOC_DEBUG_SZ shall be a power of two"
+#endif
+#define ZB_MALLOC_DEBUG_MAX_NB              ((CONFIG_ZB_M4_MALLOC_DEBUG_SZ * 3U) / 4U)
+#define ZB_MALLOC_DEBUG_HIST_NB             8U /* size classes <= 16, 32, ... 1024 and > 1024 bytes */
+
 PACKED_STRUCT zb_malloc_tracking_t {
     void *ptr;
     unsigned int sz;
 };
+
+struct zb_malloc_debug_t {
+    unsigned int nb; /* allocations in the table */
+    unsigned int live_sz; /* bytes of the tracked allocations */
+    unsigned int peak_sz; /* max of live_sz */
+    unsigned int untracked; /* allocations not tracked, table full */
+    unsigned int hist_alloc[ZB_MALLOC_DEBUG_HIST_NB]; /* allocations per size class */
+    unsigned int hist_live[ZB_MALLOC_DEBUG_HIST_NB]; /* live allocations per size class */
+};
+/* Not a member of the packed zb_ipc_globals: its address is taken, its
+ * counters must stay aligned. */
+static struct zb_malloc_debug_t zb_malloc_dbg;
 #endif
 
 static void * zb_malloc_track(void *ptr, unsigned int sz);
 static void * zb_malloc_untrack(void *ptr);
 
+/* M0 heap (MSG_M0TOM4_ZB_MALLOC) --------------------------------------------*/
+/* The memory requested by the M0 is taken from a dedicated region, managed as
+ * a binary buddy heap: one free list per power of two block size and a bitmap
+ * of the non empty lists. An allocation or a free takes at most
+ * (ZB_M0_HEAP_ORDER - ZB_M0_HEAP_MIN_ORDER) splits or merges, whatever the
+ * number of blocks. malloc() is only used when the region can't serve the
+ * request. The HEAP block of the applications (EWARM .icf) is smaller by the
+ * size of the region, their RAM budget being unchanged. */
+#ifndef ZB_M0_HEAP_ORDER
+#define ZB_M0_HEAP_ORDER                    13U /* region of 8 kB */
+#endif
+#define ZB_M0_HEAP_MIN_ORDER                4U /* 16 bytes blocks */
+#define ZB_M0_HEAP_HDR_SZ                   8U /* keeps the 8 bytes alignment of malloc() */
+#define ZB_M0_HEAP_TAG_USED                 0x5A5AU
+#define ZB_M0_HEAP_TAG_FREE                 0xA5A5U
+#define ZB_M0_HEAP_NONE                     0xFFFFFFFFU /* end of a free list */
+
+/* Free blocks are linked by their offset in the region, so that the header
+ * fits the smallest block whatever the size of a pointer (host builds) */
+#define ZB_M0_HEAP_BLOCK(_off_)             ((struct zb_m0_heap_block_t *)((uint8_t *)zb_m0_heap_region + (_off_)))
+#define ZB_M0_HEAP_OFFSET(_block_)          ((uint32_t)((uint8_t *)(_block_) - (uint8_t *)zb_m0_heap_region))
+
+struct zb_m0_heap_block_t {
+    uint16_t order;
+    uint16_t tag;
+    uint32_t sz; /* requested size, when allocated */
+    /* Free blocks only */
+    uint32_t next;
+    uint32_t prev;
+};
+
+struct zb_m0_heap_t {
+    bool init;
+    uint32_t avail; /* bit n set: free_list[n] not empty */
+    struct zb_m0_heap_block_t *free_list[ZB_M0_HEAP_ORDER + 1U];
+    struct ZbM0HeapStatsT stats;
+};
+static struct zb_m0_heap_t zb_m0_heap;
+static uint64_t zb_m0_heap_region[(1U << ZB_M0_HEAP_ORDER) / sizeof(uint64_t)];
+
+static void * zb_m0_heap_alloc(unsigned int sz);
+static void zb_m0_heap_free(void *ptr);
+
+#ifdef CONFIG_ZB_M0_HEAP_TRACE_SZ
+/* Record of the first CONFIG_ZB_M0_HEAP_TRACE_SZ memory requests of the M0,
+ * dumped by ZbM0HeapTraceDump() in the trace format replayed by the host
+ * benchmark of this heap (Tests/Host/Traces) */
+#define ZB_M0_HEAP_TRACE_FREE               0xFFFFFFFFU
+
+struct zb_m0_heap_trace_t {
+    void *ptr;
+    uint32_t sz; /* ZB_M0_HEAP_TRACE_FREE for a free */
+};
+static struct zb_m0_heap_trace_t zb_m0_heap_trace_buf[CONFIG_ZB_M0_HEAP_TRACE_SZ];
+static unsigned int zb_m0_heap_trace_nb;
+static unsigned int zb_m0_heap_trace_lost;
+
+static void zb_m0_heap_trace(void *ptr, uint32_t sz);
+#endif
+
 /* API Wrapper Helpers -------------------------------------------------------*/
 #define IPC_REQ_FUNC(name, cmd_id, req_type) \
     void name(struct ZigBeeT *zb, req_type *r) \
@@ -238,7 +326,20 @@ struct zb_ipc_m4_cb_info_t {
     void *callback;
     void *arg;
     bool zcl_recv_multi_rsp;
+    struct zb_ipc_m4_cb_info_t *next; /* free list link, when in the pool */
+};
+
+/* Pool of callback info. The entries are handed out in order the first time,
+ * then reused from the free list. It is not locked: the requests and their
+ * callbacks (Zigbee_CallBackProcessing) all run from the tasks of the
+ * sequencer, never from an interrupt. */
+struct zb_ipc_cb_pool_t {
+    struct zb_ipc_m4_cb_info_t info[ZB_IPC_CB_INFO_POOL_SZ];
+    struct zb_ipc_m4_cb_info_t *free_list;
+    unsigned int nb_used; /* info[] entries handed out at least once */
+    struct ZbIpcCbPoolStatsT stats;
 };
+static struct zb_ipc_cb_pool_t zb_ipc_cb_pool;
 
 static const va_list va_null;
 
@@ -312,19 +413,57 @@ zb_ipc_m4_cb_info_alloc(void *callback, void *arg)
 {
     struct zb_ipc_m4_cb_info_t *info;
 
-    info = malloc(sizeof(struct zb_ipc_m4_cb_info_t));
+    info = zb_ipc_cb_pool.free_list;
     if (info != NULL) {
-        memset(info, 0, sizeof(struct zb_ipc_m4_cb_info_t));
-        info->callback = callback;
-        info->arg = arg;
+        zb_ipc_cb_pool.free_list = info->next;
+    }
+    else if (zb_ipc_cb_pool.nb_used < ZB_IPC_CB_INFO_POOL_SZ) {
+        info = &zb_ipc_cb_pool.info[zb_ipc_cb_pool.nb_used];
+        zb_ipc_cb_pool.nb_used++;
+    }
+    else {
+        /* Pool exhausted */
+        zb_ipc_cb_pool.stats.exhausted++;
+    }
+    if (info != NULL) {
+        zb_ipc_cb_pool.stats.in_use++;
+        if (zb_ipc_cb_pool.stats.in_use > zb_ipc_cb_pool.stats.high_water) {
+            zb_ipc_cb_pool.stats.high_water = zb_ipc_cb_pool.stats.in_use;
+        }
     }
+
+    if (info == NULL) {
+        info = malloc(sizeof(struct zb_ipc_m4_cb_info_t));
+        if (info == NULL) {
+            return NULL;
+        }
+        zb_ipc_cb_pool.stats.heap_in_use++;
+    }
+    memset(info, 0, sizeof(struct zb_ipc_m4_cb_info_t));
+    info->callback = callback;
+    info->arg = arg;
     return info;
 }
 
 static void
 zb_ipc_m4_cb_info_free(struct zb_ipc_m4_cb_info_t *info)
 {
-    free(info);
+    if ((info < &zb_ipc_cb_pool.info[0]) || (info >= &zb_ipc_cb_pool.info[ZB_IPC_CB_INFO_POOL_SZ])) {
+        /* Allocated from the heap, pool was exhausted */
+        free(info);
+        zb_ipc_cb_pool.stats.heap_in_use--;
+        return;
+    }
+    info->next = zb_ipc_cb_pool.free_list;
+    zb_ipc_cb_pool.free_list = info;
+    zb_ipc_cb_pool.stats.in_use--;
+}
+
+void
+ZbIpcCbPoolStats(struct ZbIpcCbPoolStatsT *stats)
+{
+    *stats = zb_ipc_cb_pool.stats;
+    stats->size = ZB_IPC_CB_INFO_POOL_SZ;
 }
 
 static uint32_t
@@ -2729,6 +2868,120 @@ ZbZclClusterCommandReqDelayed(struct ZbZclClusterT *cluster, struct ZbZclCluster
     return ZCL_STATUS_SUCCESS;
 }
 
+/* Asynchronous cluster command: the sequence number request, then the command
+ * request, go through ZIGBEE_CmdTransferAsync(). The request and its payload
+ * are kept here until the M0 has processed the command request. */
+struct cluster_command_async_t {
+    struct ZbZclClusterT *cluster;
+    struct ZbZclCommandReqT req;
+    Zigbee_Cmd_Request_t ipc; /* request, then response of the M0 */
+    struct zb_ipc_m4_cb_info_t *info;
+    void (*callback)(struct ZbZclCommandRspT *rsp, void *arg);
+    void *arg;
+};
+
+static void cluster_command_async_seqnum(Zigbee_Cmd_Request_t *ipcc_req, void *arg);
+static void cluster_command_async_done(Zigbee_Cmd_Request_t *ipcc_req, void *arg);
+
+enum ZclStatusCodeT
+ZbZclClusterCommandReqAsync(struct ZbZclClusterT *clusterPtr, struct ZbZclClusterCommandReqT *req,
+    void (*callback)(struct ZbZclCommandRspT *zcl_rsp, void *arg), void *arg)
+{
+    struct cluster_command_async_t *async;
+
+    async = ZbHeapAlloc(clusterPtr->zb, sizeof(struct cluster_command_async_t) + req->length);
+    if (async == NULL) {
+        return ZCL_STATUS_INSUFFICIENT_SPACE;
+    }
+    (void)memset(async, 0, sizeof(struct cluster_command_async_t));
+    if (callback != NULL) {
+        async->info = zb_ipc_m4_cb_info_alloc((void *)callback, arg);
+        if (async->info == NULL) {
+            ZbHeapFree(clusterPtr->zb, async);
+            return ZCL_STATUS_INSUFFICIENT_SPACE;
+        }
+        if (ZbApsAddrIsBcast(&req->dst)) {
+            async->info->zcl_recv_multi_rsp = true; /* callback only freed on ZCL_STATUS_TIMEOUT */
+        }
+    }
+    async->cluster = clusterPtr;
+    async->callback = callback;
+    async->arg = arg;
+
+    /* Same request as ZbZclClusterCommandReq(), the sequence number is set
+     * once received from the M0 */
+    ZbZclClusterInitCommandReq(clusterPtr, &async->req);
+    async->req.dst = req->dst;
+    async->req.hdr.cmdId = req->cmdId;
+    async->req.hdr.frameCtrl.frameType = ZCL_FRAMETYPE_CLUSTER;
+    async->req.hdr.frameCtrl.manufacturer = (clusterPtr->mfrCode != 0U) ? 1U : 0U;
+    async->req.hdr.frameCtrl.direction = (clusterPtr->direction == ZCL_DIRECTION_TO_SERVER) ? \
+        ZCL_DIRECTION_TO_CLIENT : ZCL_DIRECTION_TO_SERVER;
+    async->req.hdr.frameCtrl.noDefaultResp = req->noDefaultResp;
+    async->req.hdr.manufacturerCode = clusterPtr->mfrCode;
+    async->req.payload = (uint8_t *)(async + 1);
+    async->req.length = req->length;
+    if (req->length != 0U) {
+        (void)memcpy(async->req.payload, req->payload, req->length);
+    }
+
+    async->ipc.ID = MSG_M4TOM0_ZCL_GET_SEQNUM;
+    async->ipc.Size = 0;
+    if (!ZIGBEE_CmdTransferAsync(&async->ipc, cluster_command_async_seqnum, async)) {
+        if (async->info != NULL) {
+            zb_ipc_m4_cb_info_free(async->info);
+        }
+        ZbHeapFree(clusterPtr->zb, async);
+        return ZCL_STATUS_INSUFFICIENT_SPACE;
+    }
+    return ZCL_STATUS_SUCCESS;
+    /* Followed up in cluster_command_async_seqnum() */
+}
+
+static void
+cluster_command_async_seqnum(Zigbee_Cmd_Request_t *ipcc_req, void *arg)
+{
+    struct cluster_command_async_t *async = arg;
+
+    async->req.hdr.seqNum = (uint8_t)ipcc_req->Data[0];
+    ipcc_req->ID = MSG_M4TOM0_ZCL_COMMAND_REQ;
+    ipcc_req->Size = 2;
+    ipcc_req->Data[0] = (uint32_t)&async->req;
+    ipcc_req->Data[1] = (uint32_t)async->info;
+    /* The entry of the sequence number request has just been released */
+    if (!ZIGBEE_CmdTransferAsync(ipcc_req, cluster_command_async_done, async)) {
+        ipcc_req->Size = 1;
+        ipcc_req->Data[0] = (uint32_t)ZCL_STATUS_INSUFFICIENT_SPACE;
+        cluster_command_async_done(ipcc_req, async);
+    }
+}
+
+static void
+cluster_command_async_done(Zigbee_Cmd_Request_t *ipcc_req, void *arg)
+{
+    struct cluster_command_async_t *async = arg;
+    struct ZbZclCommandRspT rsp;
+    enum ZclStatusCodeT status;
+
+    /* Same as ZbZclClusterCommandReqDelayed(): a request not sent is
+     * reported through the callback */
+    status = (enum ZclStatusCodeT)ipcc_req->Data[0];
+    if (status != ZCL_STATUS_SUCCESS) {
+        if (async->info != NULL) {
+            zb_ipc_m4_cb_info_free(async->info);
+        }
+        if (async->callback != NULL) {
+            (void)memset(&rsp, 0, sizeof(rsp));
+            rsp.status = status;
+            rsp.profileId = async->cluster->profileId;
+            rsp.clusterId = async->cluster->clusterId;
+            async->callback(&rsp, async->arg);
+        }
+    }
+    ZbHeapFree(async->cluster->zb, async);
+    /* Followed up in MSG_M0TOM4_ZCL_COMMAND_REQ_CB handler if callback != NULL */
+}
+
 enum ZclStatusCodeT
 ZbZclClusterCommandRsp(struct ZbZclClusterT *clusterPtr, struct ZbZclAddrInfoT *dstInfo,
     uint8_t cmdId, struct ZbApsBufT *payloads, uint8_t numPayloads)
@@ -4253,9 +4506,12 @@ Zigbee_M0RequestProcessing(void)
             /* Make room for tracking size at start of memory block */
             alloc_sz += 4U;
 #endif
-            ptr = malloc(alloc_sz);
+            ptr = zb_m0_heap_alloc(alloc_sz);
             if (ptr != NULL) {
                 ptr = zb_malloc_track(ptr, alloc_sz);
+#ifdef CONFIG_ZB_M0_HEAP_TRACE_SZ
+                zb_m0_heap_trace(ptr, (uint32_t)p_logging->Data[0]);
+#endif
             }
             /* Return ptr in second argument */
             p_logging->Data[1] = (uint32_t)ptr;
@@ -4270,8 +4526,11 @@ Zigbee_M0RequestProcessing(void)
             assert(p_logging->Size == 1);
             ptr = (void *)p_logging->Data[0];
             assert(ptr != NULL);
+#ifdef CONFIG_ZB_M0_HEAP_TRACE_SZ
+            zb_m0_heap_trace(ptr, ZB_M0_HEAP_TRACE_FREE);
+#endif
             ptr = zb_malloc_untrack(ptr);
-            free(ptr);
+            zb_m0_heap_free(ptr);
             break;
         }
 
@@ -4285,20 +4544,58 @@ Zigbee_M0RequestProcessing(void)
 }
 
 /* ZbMalloc (MSG_M0TOM4_ZB_MALLOC) Debugging */
+#ifdef CONFIG_ZB_M4_MALLOC_DEBUG_SZ
+static unsigned int
+zb_malloc_hash(void *ptr)
+{
+    uint32_t h = (uint32_t)ptr >> 2;
+
+    /* Fibonacci hashing, the upper bits are the best mixed */
+    h *= 2654435761UL;
+    return (h >> 16) & (CONFIG_ZB_M4_MALLOC_DEBUG_SZ - 1U);
+}
+
+static unsigned int
+zb_malloc_size_class(unsigned int sz)
+{
+    unsigned int size_class;
+
+    if (sz <= 16U) {
+        return 0U;
+    }
+    size_class = 28U - __CLZ(sz - 1U);
+    return (size_class < ZB_MALLOC_DEBUG_HIST_NB) ? size_class : (ZB_MALLOC_DEBUG_HIST_NB - 1U);
+}
+
+#endif
+
 static void *
 zb_malloc_track(void *ptr, unsigned int sz)
 {
 #ifdef CONFIG_ZB_M4_MALLOC_DEBUG_SZ
-    unsigned int i;
+    struct zb_malloc_debug_t *dbg = &zb_malloc_dbg;
+    unsigned int i, size_class;
 
-    for (i = 0; i < CONFIG_ZB_M4_MALLOC_DEBUG_SZ; i++) {
-        if (zb_ipc_globals.zb_malloc_info[i].ptr == NULL) {
-            zb_ipc_globals.zb_malloc_info[i].ptr = ptr;
-            zb_ipc_globals.zb_malloc_info[i].sz = sz;
-            return;
-        }
+    if (dbg->nb >= ZB_MALLOC_DEBUG_MAX_NB) {
+        dbg->untracked++;
+        ZbLogPrintf(zb_ipc_globals.zb, ZB_LOG_MASK_HEAP, __func__, "Warning, can't track allocation (p=%p, sz=%d)", ptr, sz);
+        return ptr;
+    }
+    i = zb_malloc_hash(ptr);
+    while (zb_ipc_globals.zb_malloc_info[i].ptr != NULL) {
+        i = (i + 1U) & (CONFIG_ZB_M4_MALLOC_DEBUG_SZ - 1U);
     }
-    ZbLogPrintf(zb_ipc_globals.zb, ZB_LOG_MASK_HEAP, __func__, "Warning, can't track allocation (p=%p, sz=%d)", ptr, sz);
+    zb_ipc_globals.zb_malloc_info[i].ptr = ptr;
+    zb_ipc_globals.zb_malloc_info[i].sz = sz;
+
+    dbg->nb++;
+    dbg->live_sz += sz;
+    if (dbg->live_sz > dbg->peak_sz) {
+        dbg->peak_sz = dbg->live_sz;
+    }
+    size_class = zb_malloc_size_class(sz);
+    dbg->hist_alloc[size_class]++;
+    dbg->hist_live[size_class]++;
     return ptr;
 
 #else
@@ -4315,15 +4612,39 @@ static void *
 zb_malloc_untrack(void *ptr)
 {
 #ifdef CONFIG_ZB_M4_MALLOC_DEBUG_SZ
-    unsigned int i;
-
-    for (i = 0; i < CONFIG_ZB_M4_MALLOC_DEBUG_SZ; i++) {
-        if (zb_ipc_globals.zb_malloc_info[i].ptr == ptr) {
-            zb_ipc_globals.zb_malloc_info[i].ptr = NULL;
-            return;
+    struct zb_malloc_debug_t *dbg = &zb_malloc_dbg;
+    struct zb_malloc_tracking_t *info = zb_ipc_globals.zb_malloc_info;
+    unsigned int i, j, home, sz;
+
+    i = zb_malloc_hash(ptr);
+    while (info[i].ptr != ptr) {
+        if (info[i].ptr == NULL) {
+            ZbLogPrintf(zb_ipc_globals.zb, ZB_LOG_MASK_HEAP, __func__, "Warning, can't find allocation (p=%p)", ptr);
+            return ptr;
+        }
+        i = (i + 1U) & (CONFIG_ZB_M4_MALLOC_DEBUG_SZ - 1U);
+    }
+    sz = info[i].sz;
+    dbg->nb--;
+    dbg->live_sz -= sz;
+    dbg->hist_live[zb_malloc_size_class(sz)]--;
+
+    /* Backward shift: the next entries of the probe sequence whose home slot
+     * is not after the hole are moved into it */
+    j = i;
+    for (;;) {
+        j = (j + 1U) & (CONFIG_ZB_M4_MALLOC_DEBUG_SZ - 1U);
+        if (info[j].ptr == NULL) {
+            break;
+        }
+        home = zb_malloc_hash(info[j].ptr);
+        if (((j - home) & (CONFIG_ZB_M4_MALLOC_DEBUG_SZ - 1U)) < ((j - i) & (CONFIG_ZB_M4_MALLOC_DEBUG_SZ - 1U))) {
+            continue;
         }
+        info[i] = info[j];
+        i = j;
     }
-    ZbLogPrintf(zb_ipc_globals.zb, ZB_LOG_MASK_HEAP, __func__, "Warning, can't find allocation (p=%p)", ptr);
+    info[i].ptr = NULL;
     return ptr;
 
 #else
@@ -4341,16 +4662,234 @@ unsigned int
 zb_malloc_current_sz(void)
 {
 #ifdef CONFIG_ZB_M4_MALLOC_DEBUG_SZ
-    unsigned int i, alloc_sz = 0U;
+    return zb_malloc_dbg.live_sz;
+#else
+    return zb_ipc_globals.zb_alloc_sz;
+#endif
+}
+
+void
+zb_malloc_report(void (*print)(const char *fmt, ...))
+{
+#ifdef CONFIG_ZB_M4_MALLOC_DEBUG_SZ
+    struct zb_malloc_debug_t *dbg = &zb_malloc_dbg;
+    unsigned int i;
 
     for (i = 0; i < CONFIG_ZB_M4_MALLOC_DEBUG_SZ; i++) {
         if (zb_ipc_globals.zb_malloc_info[i].ptr != NULL) {
-            alloc_sz += zb_ipc_globals.zb_malloc_info[i].sz;
+            print("Live allocation (p=%p, sz=%d)",
+                zb_ipc_globals.zb_malloc_info[i].ptr, zb_ipc_globals.zb_malloc_info[i].sz);
         }
     }
-    return alloc_sz;
+    print("%d allocations, %d bytes (peak %d), %d untracked",
+        dbg->nb, dbg->live_sz, dbg->peak_sz, dbg->untracked);
+    for (i = 0; i < ZB_MALLOC_DEBUG_HIST_NB; i++) {
+        print("%s%d bytes: %d allocations, %d live",
+            (i == (ZB_MALLOC_DEBUG_HIST_NB - 1U)) ? "> " : "<= ",
+            (i == (ZB_MALLOC_DEBUG_HIST_NB - 1U)) ? (8 << i) : (16 << i),
+            dbg->hist_alloc[i], dbg->hist_live[i]);
+    }
 #else
-    return zb_ipc_globals.zb_alloc_sz;
+    print("%d bytes allocated", zb_ipc_globals.zb_alloc_sz);
+#endif
+}
+
+static void
+zb_m0_heap_link(struct zb_m0_heap_block_t *block, uint32_t order)
+{
+    struct zb_m0_heap_block_t *next = zb_m0_heap.free_list[order];
+
+    block->order = (uint16_t)order;
+    block->tag = ZB_M0_HEAP_TAG_FREE;
+    block->prev = ZB_M0_HEAP_NONE;
+    block->next = ZB_M0_HEAP_NONE;
+    if (next != NULL) {
+        block->next = ZB_M0_HEAP_OFFSET(next);
+        next->prev = ZB_M0_HEAP_OFFSET(block);
+    }
+    zb_m0_heap.free_list[order] = block;
+    zb_m0_heap.avail |= (1UL << order);
+    zb_m0_heap.stats.free_blocks++;
+}
+
+static void
+zb_m0_heap_unlink(struct zb_m0_heap_block_t *block, uint32_t order)
+{
+    if (block->prev != ZB_M0_HEAP_NONE) {
+        ZB_M0_HEAP_BLOCK(block->prev)->next = block->next;
+    }
+    else if (block->next != ZB_M0_HEAP_NONE) {
+        zb_m0_heap.free_list[order] = ZB_M0_HEAP_BLOCK(block->next);
+    }
+    else {
+        zb_m0_heap.free_list[order] = NULL;
+    }
+    if (block->next != ZB_M0_HEAP_NONE) {
+        ZB_M0_HEAP_BLOCK(block->next)->prev = block->prev;
+    }
+    if (zb_m0_heap.free_list[order] == NULL) {
+        zb_m0_heap.avail &= ~(1UL << order);
+    }
+    block->tag = 0U;
+    zb_m0_heap.stats.free_blocks--;
+}
+
+static void
+zb_m0_heap_init(void)
+{
+    zb_m0_heap.stats.size = 1UL << ZB_M0_HEAP_ORDER;
+    zb_m0_heap_link((struct zb_m0_heap_block_t *)zb_m0_heap_region, ZB_M0_HEAP_ORDER);
+    zb_m0_heap.init = true;
+}
+
+static void *
+zb_m0_heap_alloc(unsigned int sz)
+{
+    struct zb_m0_heap_block_t *block = NULL;
+    uint32_t need, order, avail, i;
+    void *ptr;
+
+    ZbEnterCritical(zb_ipc_globals.zb);
+    if (!zb_m0_heap.init) {
+        zb_m0_heap_init();
+    }
+    need = sz + ZB_M0_HEAP_HDR_SZ;
+    if ((need > sz) && (need <= (1UL << ZB_M0_HEAP_ORDER))) {
+        order = ZB_M0_HEAP_MIN_ORDER;
+        if (need > (1UL << ZB_M0_HEAP_MIN_ORDER)) {
+            order = 32U - __CLZ(need - 1U);
+        }
+        /* Smallest free block large enough */
+        avail = zb_m0_heap.avail & ~((1UL << order) - 1U);
+        if (avail != 0U) {
+            i = 31U - __CLZ(avail & (0U - avail));
+            block = zb_m0_heap.free_list[i];
+            zb_m0_heap_unlink(block, i);
+            /* Split it down to the requested size, freeing the upper halves */
+            while (i > order) {
+                i--;
+                zb_m0_heap_link((struct zb_m0_heap_block_t *)((uint8_t *)block + (1UL << i)), i);
+            }
+            block->order = (uint16_t)order;
+            block->tag = ZB_M0_HEAP_TAG_USED;
+            block->sz = sz;
+            zb_m0_heap.stats.used += 1UL << order;
+            zb_m0_heap.stats.requested += sz;
+            if (zb_m0_heap.stats.used > zb_m0_heap.stats.used_max) {
+                zb_m0_heap.stats.used_max = zb_m0_heap.stats.used;
+            }
+            zb_m0_heap.stats.alloc_cnt++;
+        }
+    }
+    ZbExitCritical(zb_ipc_globals.zb);
+
+    if (block != NULL) {
+        return (uint8_t *)block + ZB_M0_HEAP_HDR_SZ;
+    }
+
+    /* Region full (or too fragmented) */
+    ptr = malloc(sz);
+    ZbEnterCritical(zb_ipc_globals.zb);
+    if (ptr != NULL) {
+        zb_m0_heap.stats.fallback_cnt++;
+    }
+    else {
+        zb_m0_heap.stats.fail_cnt++;
+    }
+    ZbExitCritical(zb_ipc_globals.zb);
+    return ptr;
+}
+
+static void
+zb_m0_heap_free(void *ptr)
+{
+    struct zb_m0_heap_block_t *block, *buddy;
+    uint8_t *region = (uint8_t *)zb_m0_heap_region;
+    uint32_t order, offset;
+
+    if (((uint8_t *)ptr < region) || ((uint8_t *)ptr >= (region + (1UL << ZB_M0_HEAP_ORDER)))) {
+        /* Allocated by malloc() */
+        free(ptr);
+        return;
+    }
+
+    ZbEnterCritical(zb_ipc_globals.zb);
+    block = (struct zb_m0_heap_block_t *)((uint8_t *)ptr - ZB_M0_HEAP_HDR_SZ);
+    assert(block->tag == ZB_M0_HEAP_TAG_USED);
+    order = block->order;
+    zb_m0_heap.stats.used -= 1UL << order;
+    zb_m0_heap.stats.requested -= block->sz;
+
+    /* Merge with its buddy as long as it is free with the same size */
+    while (order < ZB_M0_HEAP_ORDER) {
+        offset = (uint32_t)((uint8_t *)block - region);
+        buddy = (struct zb_m0_heap_block_t *)(region + (offset ^ (1UL << order)));
+        if ((buddy->tag != ZB_M0_HEAP_TAG_FREE) || (buddy->order != order)) {
+            break;
+        }
+        zb_m0_heap_unlink(buddy, order);
+        if (buddy < block) {
+            block = buddy;
+        }
+        order++;
+    }
+    zb_m0_heap_link(block, order);
+    ZbExitCritical(zb_ipc_globals.zb);
+}
+
+void
+ZbM0HeapStats(struct ZbM0HeapStatsT *stats)
+{
+    ZbEnterCritical(zb_ipc_globals.zb);
+    if (!zb_m0_heap.init) {
+        zb_m0_heap_init();
+    }
+    *stats = zb_m0_heap.stats;
+    stats->largest_free = 0U;
+    if (zb_m0_heap.avail != 0U) {
+        stats->largest_free = 1UL << (31U - __CLZ(zb_m0_heap.avail));
+    }
+    ZbExitCritical(zb_ipc_globals.zb);
+}
+
+#ifdef CONFIG_ZB_M0_HEAP_TRACE_SZ
+static void
+zb_m0_heap_trace(void *ptr, uint32_t sz)
+{
+    if (zb_m0_heap_trace_nb >= CONFIG_ZB_M0_HEAP_TRACE_SZ) {
+        zb_m0_heap_trace_lost++;
+        return;
+    }
+    zb_m0_heap_trace_buf[zb_m0_heap_trace_nb].ptr = ptr;
+    zb_m0_heap_trace_buf[zb_m0_heap_trace_nb].sz = sz;
+    zb_m0_heap_trace_nb++;
+}
+
+#endif
+
+void
+ZbM0HeapTraceDump(void (*print)(const char *fmt, ...))
+{
+#ifdef CONFIG_ZB_M0_HEAP_TRACE_SZ
+    unsigned int i;
+
+    for (i = 0; i < zb_m0_heap_trace_nb; i++) {
+        if (zb_m0_heap_trace_buf[i].sz == ZB_M0_HEAP_TRACE_FREE) {
+            print("f %lx", (unsigned long)zb_m0_heap_trace_buf[i].ptr);
+        }
+        else {
+            print("a %lx %lu", (unsigned long)zb_m0_heap_trace_buf[i].ptr,
+                (unsigned long)zb_m0_heap_trace_buf[i].sz);
+        }
+    }
+    if (zb_m0_heap_trace_lost != 0U) {
+        print("# %u requests not recorded, trace full", zb_m0_heap_trace_lost);
+    }
+    /* The next requests are recorded from the start of the buffer */
+    zb_m0_heap_trace_nb = 0U;
+    zb_m0_heap_trace_lost = 0U;
+#else
+    print("# M0 heap trace not recorded (CONFIG_ZB_M0_HEAP_TRACE_SZ)");
 #endif
 }
 
@@ -37,6 +37,31 @@
 /* Element tag in flash */
 #define EE_TAG                     0x8000UL
 
+/* Wide element tags in flash (header and trailer) */
+#define EE_TAG_WIDE                0xC000UL
+#define EE_TAG_END                 0x4000UL
+
+/* Elements in flash (64-bit words, CRC of the element in the 16 LSBs):
+   - element: data (32) | EE_TAG | virtual address (14) | CRC (16)
+   - wide element: header 0 (16) | ~nb (8) | nb (8) | EE_TAG_WIDE |
+     first virtual address (14) | CRC (16), followed by (nb + 1) / 2 words
+     holding its nb data words, two per word (first one in the 32 LSBs,
+     unused half of the last word set to 0), then a trailer: copy of the
+     header with EE_TAG_END. The CRC covers the header and the data words.
+     The trailer lets the pages be searched backward, a word tagged
+     EE_TAG_END giving the start of its element. A wide element is never
+     split over two pages */
+
+/* Trailer of a wide element from its header, and the other way round */
+#define EE_WIDE_END( el ) \
+          ((el) ^ ((uint64_t)(EE_TAG_WIDE ^ EE_TAG_END) << 16))
+
+/* Macro to get the (first) virtual address of an element */
+#define EE_EL_ADDR( el )           ((uint32_t)(((el) & 0x3FFFFFFFUL) >> 16))
+
+/* Maximum number of elements programmed by one flash driver call */
+#define EE_BLOCK_NB                32
+
 /* Page state definition */
 enum
 {
@@ -55,6 +80,11 @@ enum
 #define EE_FLASH_PAGE( pv, p ) \
           ((((pv)->address - HW_FLASH_ADDRESS) / HW_FLASH_PAGE_SIZE) + (p))
 
+/* Macro to check if a virtual address is reserved for the statistics */
+#define EE_IS_STATS( pv, a ) \
+          (((pv)->erase_count != 0) && ((a) >= (pv)->stats_addr) && \
+           ((a) <= (pv)->stats_addr + (pv)->nb_pages))
+
 /* Macro to get first page index of following pool, among circular pool list */
 #define EE_NEXT_POOL( pv ) \
            (((pv)->current_write_page < (pv)->nb_pages) ? (pv)->nb_pages : 0)
@@ -72,26 +102,130 @@ enum
 #if (CFG_EE_BANK1_SIZE & ((2 * HW_FLASH_PAGE_SIZE) - 1))
 #error EE: wrong value of CFG_EE_BANK1_SIZE
 #endif
-#if ((CFG_EE_BANK0_MAX_NB > \
+
+/* Statistics of each bank persisted in reserved variables: erase count of
+   the pages (2 per variable) then number of pool transfers */
+#ifndef CFG_EE_STATS
+#define CFG_EE_STATS               1
+#endif
+#if CFG_EE_STATS
+#define EE_STATS0_NB               (CFG_EE_BANK0_SIZE / (2 * HW_FLASH_PAGE_SIZE) + 1)
+#define EE_STATS1_NB               (CFG_EE_BANK1_SIZE / (2 * HW_FLASH_PAGE_SIZE) + 1)
+#else /* CFG_EE_STATS */
+#define EE_STATS0_NB               0
+#define EE_STATS1_NB               0
+#endif /* CFG_EE_STATS */
+
+/* The reserved variables follow the user ones (at the end of the pool if
+   the max number of user variables is not defined) */
+#if defined(CFG_EE_BANK0_MAX_NB) && (CFG_EE_BANK0_MAX_NB > 0)
+#define EE_STATS0_ADDR             CFG_EE_BANK0_MAX_NB
+#else
+#define EE_STATS0_ADDR \
+  (EE_NB_MAX_ELT * CFG_EE_BANK0_SIZE / (2 * HW_FLASH_PAGE_SIZE) - EE_STATS0_NB)
+#endif
+#if defined(CFG_EE_BANK1_MAX_NB) && (CFG_EE_BANK1_MAX_NB > 0)
+#define EE_STATS1_ADDR             CFG_EE_BANK1_MAX_NB
+#else
+#define EE_STATS1_ADDR \
+  (EE_NB_MAX_ELT * CFG_EE_BANK1_SIZE / (2 * HW_FLASH_PAGE_SIZE) - EE_STATS1_NB)
+#endif
+
+#if ((CFG_EE_BANK0_MAX_NB + EE_STATS0_NB > \
       EE_NB_MAX_ELT * CFG_EE_BANK0_SIZE / (2 * HW_FLASH_PAGE_SIZE)) || \
-     (CFG_EE_BANK0_MAX_NB > 0x4000U))
+     (CFG_EE_BANK0_MAX_NB + EE_STATS0_NB > 0x4000U))
 #error EE: CFG_EE_BANK0_MAX_NB too big
 #endif
 #if ((CFG_EE_BANK1_SIZE > 0) && \
-     ((CFG_EE_BANK1_MAX_NB > \
+     ((CFG_EE_BANK1_MAX_NB + EE_STATS1_NB > \
        EE_NB_MAX_ELT * CFG_EE_BANK1_SIZE / (2 * HW_FLASH_PAGE_SIZE)) || \
-      (CFG_EE_BANK1_MAX_NB > 0x4000U)))
+      (CFG_EE_BANK1_MAX_NB + EE_STATS1_NB > 0x4000U)))
 #error EE: CFG_EE_BANK1_MAX_NB too big
 #endif
 #if (HW_FLASH_WIDTH != 8)
 #error EE: this module only works for a 64-bit flash
 #endif
 
+/* Number of virtual addresses covered by the RAM index of each bank */
+#ifndef CFG_EE_INDEX
+#define CFG_EE_INDEX               1
+#endif
+#if (CFG_EE_INDEX == 0)
+#define EE_INDEX0_NB               0
+#define EE_INDEX1_NB               0
+#else /* CFG_EE_INDEX */
+#if defined(CFG_EE_BANK0_MAX_NB) && (CFG_EE_BANK0_MAX_NB > 0)
+#define EE_INDEX0_NB               (CFG_EE_BANK0_MAX_NB + EE_STATS0_NB)
+#else
+#define EE_INDEX0_NB \
+          (EE_NB_MAX_ELT * CFG_EE_BANK0_SIZE / (2 * HW_FLASH_PAGE_SIZE))
+#endif
+#if defined(CFG_EE_BANK1_MAX_NB) && (CFG_EE_BANK1_MAX_NB > 0)
+#define EE_INDEX1_NB \
+          (CFG_EE_BANK1_SIZE ? (CFG_EE_BANK1_MAX_NB + EE_STATS1_NB) : 0)
+#else
+#define EE_INDEX1_NB \
+          (EE_NB_MAX_ELT * CFG_EE_BANK1_SIZE / (2 * HW_FLASH_PAGE_SIZE))
+#endif
+#if (((CFG_EE_BANK0_SIZE / HW_FLASH_WIDTH) > 0xFFFFU) || \
+     ((CFG_EE_BANK1_SIZE / HW_FLASH_WIDTH) > 0xFFFFU))
+#error EE: bank too big to be indexed (set CFG_EE_INDEX to 0)
+#endif
+#endif /* CFG_EE_INDEX */
+
+/* CRC backend used to protect the elements */
+#define EE_CRC_REF                 0   /* bitwise computation (reference) */
+#define EE_CRC_TABLE               1   /* 256-entry table lookup */
+#define EE_CRC_HW                  2   /* STM32 CRC peripheral */
+#ifndef CFG_EE_CRC
+#define CFG_EE_CRC                 EE_CRC_REF
+#endif
+#if (CFG_EE_CRC == EE_CRC_HW)
+#include "stm32wbxx_ll_bus.h"
+#include "stm32wbxx_ll_crc.h"
+#elif (CFG_EE_CRC != EE_CRC_REF) && (CFG_EE_CRC != EE_CRC_TABLE)
+#error EE: wrong value of CFG_EE_CRC
+#endif
+
+/* Time stamp of the EE_Init profile (see EE_GetInitProfile) */
+#ifndef CFG_EE_TIME
+#define CFG_EE_TIME()              0UL
+#endif
+
+/* EE state kept in RAM through a reset after EE_Shutdown */
+#ifndef CFG_EE_FAST_INIT
+#define CFG_EE_FAST_INIT           0
+#endif
+#if CFG_EE_FAST_INIT
+#ifndef EE_RETAINED
+#define EE_RETAINED                __attribute__ ((section(".noinit")))
+#endif
+#else /* CFG_EE_FAST_INIT */
+#undef EE_RETAINED
+#define EE_RETAINED
+#endif /* CFG_EE_FAST_INIT */
+
+/* Clean shutdown marker values */
+#define EE_MARKER_RUNNING          0x45455255UL   /* "EERU" */
+#define EE_MARKER_SHUTDOWN         0x45455344UL   /* "EESD" */
+
+/* Maximum number of data words packed in a wide element (0: no wide element
+   written, the ones already in flash are still read) */
+#ifndef CFG_EE_WIDE_NB
+#define CFG_EE_WIDE_NB             0
+#endif
+#if (CFG_EE_WIDE_NB > EE_BLOCK_NB)
+#error EE: CFG_EE_WIDE_NB too big
+#endif
+
 /* Macro to get a 64-bit pointer from an address represented as an integer */
 #ifndef EE_PTR
 #define EE_PTR( x )               ((uint64_t*)(uintptr_t)(x))
 #endif /* !EE_PTR */
 
+/* Macro to get a 32-bit pointer on the data words of a wide element */
+#define EE_PTR32( x )             ((const uint32_t*)EE_PTR( x ))
+
 /* Macro used for debug (empty by default) */
 #ifndef EE_DBG
 #define EE_DBG( x )
@@ -115,13 +249,51 @@ typedef struct
   /* Write position inside the current write page */
   uint16_t next_write_offset;
 
+  /* Number of pages of the standby pool (the next pool) erased and
+     verified blank, from its first page: the standby pool is ready for a
+     pool transfer when it is equal to nb_pages */
+  uint8_t  standby_blank;
+
+  /* Number of pool transfers which had to prepare the standby pool */
+  uint16_t nb_sync_clean;
+
+  /* Number of virtual addresses covered by the RAM index (0: no index) */
+  uint16_t index_nb;
+
+  /* RAM index: position in the bank (in flash words) of the last element
+     written for each virtual address, 0 if not present in the active pool */
+  uint16_t* index;
+
+  /* Virtual address of the first variable reserved for the statistics */
+  uint16_t stats_addr;
+
+  /* Erase count of each page of the bank (0 if no statistics): a page is
+     counted when it is set in ERASING state by a pool transfer */
+  uint16_t* erase_count;
+
+  /* Number of pool transfers since the format */
+  uint32_t nb_transfers;
+
+  /* Number of elements written by the user since EE_Init */
+  uint32_t nb_user_elements;
+
+  /* Number of elements programmed since EE_Init, pool transfers included */
+  uint32_t nb_programmed_elements;
+
+  /* Erase of a standby pool page queued to the flash driver by
+     EE_CleanPageAsync, and callback to call when it is done */
+  uint8_t  erase_queued;
+  void     (*clean_callback)( void );
+
 } EE_var_t;
 
 /*****************************************************************************/
 
 /* Local functions */
 
-static void EE_Reset( EE_var_t* pv, uint32_t address, uint8_t nb_pages );
+static void EE_Reset( EE_var_t* pv, uint32_t address, uint8_t nb_pages,
+                      uint16_t* index, uint16_t index_nb,
+                      uint16_t stats_addr, uint16_t* erase_count );
 
 static int EE_Recovery( EE_var_t* pv );
 
@@ -129,20 +301,120 @@ static int EE_Transfer( EE_var_t* pv, uint16_t addr, uint32_t page );
 
 static int EE_WriteEl( EE_var_t* pv, uint16_t addr, uint32_t data );
 
+static int EE_WriteEls( EE_var_t* pv, const uint64_t* el, uint32_t nb );
+
+static int EE_WriteVars( EE_var_t* pv, uint64_t* el, uint32_t* nb_el,
+                         uint16_t addr, const uint32_t* data, uint32_t nb );
+
+static int EE_ClearEl( uint32_t flash_addr, uint32_t size );
+
+static uint32_t EE_PoolEnd( const EE_var_t* pv, uint32_t last_page );
+
+static int EE_NextPage( EE_var_t* pv );
+
+static uint64_t EE_BuildEl( uint16_t addr, uint32_t data );
+
+static uint32_t EE_BuildWide( uint64_t* el, uint16_t addr,
+                              const uint32_t* data, uint32_t nb );
+
+static uint32_t EE_WideNb( uint64_t el );
+
+static uint32_t EE_ElSize( uint64_t el, uint32_t max, uint32_t* nb );
+
+static int EE_ElIsValid( uint32_t flash_addr, uint64_t el, uint32_t nb );
+
+static uint32_t EE_ElData( uint32_t flash_addr, uint64_t el, uint32_t idx );
+
 static int EE_ReadEl( const EE_var_t* pv,
                       uint16_t addr, uint32_t* data, uint32_t page );
 
+static int EE_ReadIdx( const EE_var_t* pv,
+                       uint16_t addr, uint32_t* data, uint32_t page );
+
+static void EE_BuildIndex( EE_var_t* pv, uint32_t last_page );
+
 static int EE_SetState( const EE_var_t* pv, uint32_t page, uint32_t state );
 
 static uint32_t EE_GetState( const EE_var_t* pv, uint32_t page );
 
+static void EE_CrcInit( void );
+
 static uint16_t EE_Crc( uint64_t v );
 
+static uint16_t EE_CrcWide( uint64_t v, const uint32_t* data, uint32_t nb );
+
+static uint32_t EE_LastDirtyPage( const EE_var_t* pv );
+
+static int EE_IsBlank( const EE_var_t* pv, uint32_t page );
+
+static int EE_PrepareStandby( int bank );
+
+static int EE_CleanStep( EE_var_t* pv, int async );
+
+static void EE_EraseDone( void* arg );
+
+static void EE_LoadStats( EE_var_t* pv );
+
+static void EE_ScanStats( EE_var_t* pv );
+
+static int EE_WriteStats( EE_var_t* pv );
+
+#if CFG_EE_FAST_INIT
+static int EE_Resume( int format, uint32_t base_address );
+
+static int EE_CheckState( const EE_var_t* pv );
+
+static uint16_t EE_StateCrc( void );
+#endif /* CFG_EE_FAST_INIT */
+
 /*****************************************************************************/
 
 /* Global variables */
 
-EE_var_t EE_var[CFG_EE_BANK1_SIZE ? 2 : 1];
+/* The state of the banks (RAM index and statistics included) is kept
+   through a reset when CFG_EE_FAST_INIT is set (see EE_Shutdown) */
+
+EE_RETAINED EE_var_t EE_var[CFG_EE_BANK1_SIZE ? 2 : 1];
+
+#if CFG_EE_INDEX
+/* (even number of entries, the CRC of the state being computed by words) */
+EE_RETAINED static uint16_t EE_index[(EE_INDEX0_NB + EE_INDEX1_NB + 1) & ~1UL];
+#define EE_INDEX_PTR( n )          (&EE_index[n])
+#else /* CFG_EE_INDEX */
+#define EE_INDEX_PTR( n )          ((uint16_t*)0)
+#endif /* CFG_EE_INDEX */
+
+#if CFG_EE_STATS
+EE_RETAINED static uint16_t EE_erase_count[(CFG_EE_BANK0_SIZE +
+                                            CFG_EE_BANK1_SIZE) /
+                                           HW_FLASH_PAGE_SIZE];
+#define EE_ERASE_COUNT_PTR( n )    (&EE_erase_count[n])
+#else /* CFG_EE_STATS */
+#define EE_ERASE_COUNT_PTR( n )    ((uint16_t*)0)
+#endif /* CFG_EE_STATS */
+
+/* Flash address of the last wide element found valid (0: none), so that
+   its CRC is not computed again for each of its variables */
+static uint32_t EE_wide_checked;
+
+#if CFG_EE_STATS
+/* Banks whose statistics in RAM are known to be valid since the reset (bit
+   per bank): they are random after a power up, until loaded from flash */
+static uint32_t EE_stats_loaded;
+#endif /* CFG_EE_STATS */
+
+/* Profile of the last EE_Init of each bank */
+static EE_InitProfile_t EE_profile[CFG_EE_BANK1_SIZE ? 2 : 1];
+
+#if CFG_EE_FAST_INIT
+/* Clean shutdown marker: magic, bank address and CRC of the state */
+EE_RETAINED static struct
+{
+  uint32_t magic;
+  uint32_t address;
+  uint32_t crc;
+} EE_marker;
+#endif /* CFG_EE_FAST_INIT */
 
 /*****************************************************************************/
 
@@ -150,24 +422,80 @@ int EE_Init( int format, uint32_t base_address )
 {
   int status;
   uint16_t total_nb_pages;
+  uint32_t start;
+#if CFG_EE_STATS
+  uint16_t i;
+#endif /* CFG_EE_STATS */
+
+  start = CFG_EE_TIME( );
+
+  EE_CrcInit( );
+
+  EE_wide_checked = 0;
+
+  EE_profile[0] = (EE_InitProfile_t){ 0 };
+  if ( CFG_EE_BANK1_SIZE )
+  {
+    EE_profile[1] = (EE_InitProfile_t){ 0 };
+  }
+
+#if CFG_EE_FAST_INIT
+
+  /* After a clean shutdown, the state kept in RAM is used if the flash
+     still matches it */
+  if ( EE_Resume( format, base_address ) )
+  {
+#if CFG_EE_STATS
+    EE_stats_loaded = 3;
+#endif /* CFG_EE_STATS */
+    EE_profile[0].fast_init = 1;
+    EE_profile[0].total = CFG_EE_TIME( ) - start;
+    if ( CFG_EE_BANK1_SIZE )
+    {
+      EE_profile[1].fast_init = 1;
+    }
+
+    return EE_OK;
+  }
+
+#endif /* CFG_EE_FAST_INIT */
 
   /* Reset global variables of both banks */
 
   EE_Reset( &EE_var[0],
             base_address,
-            CFG_EE_BANK0_SIZE / (2 * HW_FLASH_PAGE_SIZE) );
+            CFG_EE_BANK0_SIZE / (2 * HW_FLASH_PAGE_SIZE),
+            EE_INDEX_PTR( 0 ), EE_INDEX0_NB,
+            EE_STATS0_ADDR, EE_ERASE_COUNT_PTR( 0 ) );
 
   if ( CFG_EE_BANK1_SIZE )
   {
     EE_Reset( &EE_var[1],
               base_address + CFG_EE_BANK0_SIZE,
-              CFG_EE_BANK1_SIZE / (2 * HW_FLASH_PAGE_SIZE) );
+              CFG_EE_BANK1_SIZE / (2 * HW_FLASH_PAGE_SIZE),
+              EE_INDEX_PTR( EE_INDEX0_NB ), EE_INDEX1_NB,
+              EE_STATS1_ADDR,
+              EE_ERASE_COUNT_PTR( CFG_EE_BANK0_SIZE / HW_FLASH_PAGE_SIZE ) );
   }
 
   /* If format mode is set, start from scratch */
 
   if ( format )
   {
+#if CFG_EE_STATS
+    /* Statistics not loaded since the reset: taken from the pages before
+       they are erased */
+    if ( (EE_stats_loaded & 1) == 0 )
+    {
+      EE_ScanStats( &EE_var[0] );
+    }
+    if ( CFG_EE_BANK1_SIZE && ((EE_stats_loaded & 2) == 0) )
+    {
+      EE_ScanStats( &EE_var[1] );
+    }
+    EE_stats_loaded = 3;
+#endif /* CFG_EE_STATS */
+
     /* Force erase of all pages */
     total_nb_pages =
       2 * (EE_var[0].nb_pages + (CFG_EE_BANK1_SIZE ? EE_var[1].nb_pages : 0));
@@ -182,14 +510,34 @@ int EE_Init( int format, uint32_t base_address )
       return EE_ERASE_ERROR;
     }
 
-    /* Set first page of each pool in ACTIVE State */
+#if CFG_EE_STATS
+    for ( i = 0; i < total_nb_pages; i++ )
+    {
+      EE_erase_count[i]++;
+    }
+#endif /* CFG_EE_STATS */
+
+    /* Set first page of each pool in ACTIVE State, then save the
+       statistics (erase counts from before the format, plus this erase) */
     status = EE_SetState( &EE_var[0], 0, EE_STATE_ACTIVE );
 
+    if ( status == EE_OK )
+    {
+      status = EE_WriteStats( &EE_var[0] );
+    }
+
     if ( CFG_EE_BANK1_SIZE && (status == EE_OK) )
     {
       status = EE_SetState( &EE_var[1], 0, EE_STATE_ACTIVE );
+
+      if ( status == EE_OK )
+      {
+        status = EE_WriteStats( &EE_var[1] );
+      }
     }
 
+    EE_profile[0].total = CFG_EE_TIME( ) - start;
+
     return status;
   }
 
@@ -197,9 +545,15 @@ int EE_Init( int format, uint32_t base_address )
 
   status = EE_Recovery( &EE_var[0] );
 
+  EE_profile[0].total = CFG_EE_TIME( ) - start;
+
   if ( CFG_EE_BANK1_SIZE && (status == EE_OK) )
   {
+    start = CFG_EE_TIME( );
+
     status = EE_Recovery( &EE_var[1] );
+
+    EE_profile[1].total = CFG_EE_TIME( ) - start;
   }
 
   return status;
@@ -207,12 +561,34 @@ int EE_Init( int format, uint32_t base_address )
 
 /*****************************************************************************/
 
+void EE_Shutdown( void )
+{
+#if CFG_EE_FAST_INIT
+
+  /* Seal the state of the banks: any later write changes it, so that the
+     next EE_Init falls back to the recovery from flash */
+  EE_marker.magic = EE_MARKER_SHUTDOWN;
+  EE_marker.address = EE_var[0].address;
+  EE_marker.crc = EE_StateCrc( );
+
+#endif /* CFG_EE_FAST_INIT */
+}
+
+/*****************************************************************************/
+
+void EE_GetInitProfile( int bank, EE_InitProfile_t* profile )
+{
+  *profile = EE_profile[CFG_EE_BANK1_SIZE && bank];
+}
+
+/*****************************************************************************/
+
 int EE_Read( int bank, uint16_t addr, uint32_t* data )
 {
   EE_var_t *pv = &EE_var[CFG_EE_BANK1_SIZE && bank];;
 
-  /* Read element starting from active page */
-  return EE_ReadEl( pv, addr, data, pv->current_write_page );
+  /* Read element from RAM index or starting from active page */
+  return EE_ReadIdx( pv, addr, data, pv->current_write_page );
 }
 
 /*****************************************************************************/
@@ -220,7 +596,10 @@ int EE_Read( int bank, uint16_t addr, uint32_t* data )
 int EE_Write( int bank, uint16_t addr, uint32_t data )
 {
   EE_var_t *pv = &EE_var[CFG_EE_BANK1_SIZE && bank];;
-  uint32_t page;
+  uint32_t page, state;
+  int status;
+
+  pv->nb_user_elements++;
 
   /* Check if current pool is full */
   if ( pv->nb_written_elements < EE_NB_MAX_ELT * pv->nb_pages )
@@ -235,11 +614,26 @@ int EE_Write( int bank, uint16_t addr, uint32_t data )
   page = EE_NEXT_POOL( pv );
 
   /* Check next page state: it must be ERASED */
-  if ( EE_GetState( pv, page ) != EE_STATE_ERASED )
+  state = EE_GetState( pv, page );
+
+  if ( (state != EE_STATE_ERASED) && (state != EE_STATE_ERASING) )
   {
     return EE_STATE_ERROR;
   }
 
+  if ( pv->standby_blank < pv->nb_pages )
+  {
+    /* The next pool is needed before the end of its preparation (see
+       EE_CleanPage): finish it now */
+    pv->nb_sync_clean++;
+
+    status = EE_PrepareStandby( bank );
+    if ( status != EE_OK )
+    {
+      return status;
+    }
+  }
+
   /* Mark the ERASED page at RECEIVE state */
   if ( EE_SetState( pv, page, EE_STATE_RECEIVE ) != EE_OK )
   {
@@ -268,6 +662,9 @@ int EE_Write( int bank, uint16_t addr, uint32_t data )
     return EE_WRITE_ERROR;
   }
 
+  /* The previous pool is now the standby pool */
+  pv->standby_blank = 0;
+
   EE_DBG( EE_5 );
 
 #if CFG_EE_AUTO_CLEAN == 0
@@ -277,13 +674,97 @@ int EE_Write( int bank, uint16_t addr, uint32_t data )
 
 #else /* CFG_EE_AUTO_CLEAN */
 
-  return EE_Clean( bank, 0 );
+  return EE_PrepareStandby( bank );
 
 #endif /* CFG_EE_AUTO_CLEAN */
 }
 
 /*****************************************************************************/
 
+int EE_ReadBlock( int bank, uint16_t addr, uint32_t* data, uint16_t size )
+{
+  EE_var_t *pv = &EE_var[CFG_EE_BANK1_SIZE && bank];
+  int status;
+
+  /* Read each element from RAM index or starting from active page */
+  for ( ; size > 0; size--, addr++, data++ )
+  {
+    status = EE_ReadIdx( pv, addr, data, pv->current_write_page );
+    if ( status != EE_OK )
+    {
+      return status;
+    }
+  }
+
+  return EE_OK;
+}
+
+/*****************************************************************************/
+
+int EE_WriteBlock( int bank, uint16_t addr,
+                   const uint32_t* data, uint16_t size )
+{
+  EE_var_t *pv = &EE_var[CFG_EE_BANK1_SIZE && bank];
+  uint64_t el[EE_BLOCK_NB];
+  uint32_t nb, nb_el = 0;
+  int status, clean = EE_OK;
+
+  while ( size > 0 )
+  {
+    /* If the pool is full, the pool transfer is done by a single write
+       (if the block fills the new pool again, EE_Write cleans the old one
+       before reusing it) */
+    if ( pv->nb_written_elements >= EE_NB_MAX_ELT * pv->nb_pages )
+    {
+      status = EE_Write( bank, addr, *data );
+
+      if ( status == EE_CLEAN_NEEDED )
+      {
+        clean = status;
+      }
+      else if ( status != EE_OK )
+      {
+        return status;
+      }
+
+      addr++;
+      data++;
+      size--;
+      continue;
+    }
+
+    /* Number of variables that still fit in the pool (a wide element
+       takes less flash words than its variables) */
+    nb = EE_NB_MAX_ELT * pv->nb_pages - pv->nb_written_elements;
+    if ( nb > size )
+      nb = size;
+
+    /* Write the elements in flash, by groups */
+    if ( (EE_WriteVars( pv, el, &nb_el, addr, data, nb ) != EE_OK) ||
+         (EE_WriteEls( pv, el, nb_el ) != EE_OK) )
+    {
+      return EE_WRITE_ERROR;
+    }
+    nb_el = 0;
+
+    pv->nb_user_elements += nb;
+
+    addr += nb;
+    data += nb;
+    size -= nb;
+  }
+
+  /* Report if the last obsolete pool is still to be cleaned */
+  if ( (clean == EE_CLEAN_NEEDED) && (pv->standby_blank == pv->nb_pages) )
+  {
+    clean = EE_OK;
+  }
+
+  return clean;
+}
+
+/*****************************************************************************/
+
 int EE_Clean( int bank, int interrupt )
 {
   EE_var_t *pv = &EE_var[CFG_EE_BANK1_SIZE && bank];
@@ -300,14 +781,16 @@ int EE_Clean( int bank, int interrupt )
 
   EE_DBG( EE_1 );
 
-  /* Erase all the pages of the pool */
+  /* Erase all the pages of the pool (except the last ones already erased
+     by EE_CleanPage) */
 //  if ( HW_FLASH_Erase( EE_FLASH_PAGE( pv, page ), pv->nb_pages, interrupt )
 //       != 0 )
 //  {
 //    return EE_ERASE_ERROR;
 //  }
 
-  if( FD_EraseSectors(EE_FLASH_PAGE( pv, page ), pv->nb_pages) != 0 )
+  if( FD_EraseSectors(EE_FLASH_PAGE( pv, page ),
+                      EE_LastDirtyPage( pv ) - page + 1) != 0 )
   {
     return EE_ERASE_ERROR;
   }
@@ -317,10 +800,97 @@ int EE_Clean( int bank, int interrupt )
 
 /*****************************************************************************/
 
+int EE_CleanPage( int bank )
+{
+  EE_var_t *pv = &EE_var[CFG_EE_BANK1_SIZE && bank];
+
+  /* First wait for the erase queued by EE_CleanPageAsync */
+  if ( pv->erase_queued && (FD_FlushQueue() != 0) )
+  {
+    return EE_ERASE_ERROR;
+  }
+
+  return EE_CleanStep( pv, 0 );
+}
+
+/*****************************************************************************/
+
+int EE_CleanPageAsync( int bank, void (*callback)( void ) )
+{
+  EE_var_t *pv = &EE_var[CFG_EE_BANK1_SIZE && bank];
+
+  /* The previous erase is not done yet */
+  if ( pv->erase_queued )
+  {
+    return EE_CLEAN_QUEUED;
+  }
+
+  pv->clean_callback = callback;
+
+  return EE_CleanStep( pv, 1 );
+}
+
+/*****************************************************************************/
+
+void EE_GetStatus( int bank, EE_Status_t* status )
+{
+  const EE_var_t *pv = &EE_var[CFG_EE_BANK1_SIZE && bank];
+  uint32_t i;
+  uint16_t count;
+
+  status->standby_ready = (pv->standby_blank >= pv->nb_pages);
+  status->standby_pages = pv->nb_pages - pv->standby_blank;
+  status->free_elements =
+    EE_NB_MAX_ELT * pv->nb_pages - pv->nb_written_elements;
+  status->nb_sync_clean = pv->nb_sync_clean;
+
+  status->nb_transfers = pv->nb_transfers;
+  status->user_elements = pv->nb_user_elements;
+  status->programmed_elements = pv->nb_programmed_elements;
+
+  /* Count the user variables present in the RAM index */
+  status->valid_elements = 0;
+  for ( i = 0; (i < pv->index_nb) && (i < pv->stats_addr); i++ )
+  {
+    if ( pv->index[i] != 0 )
+    {
+      status->valid_elements++;
+    }
+  }
+
+  /* Min and max erase count of the pages */
+  status->erase_min = 0xFFFF;
+  status->erase_max = 0;
+  for ( i = 0; i < 2UL * pv->nb_pages; i++ )
+  {
+    count = EE_GetEraseCount( bank, i );
+    if ( count < status->erase_min )
+      status->erase_min = count;
+    if ( count > status->erase_max )
+      status->erase_max = count;
+  }
+}
+
+/*****************************************************************************/
+
+uint16_t EE_GetEraseCount( int bank, uint32_t page )
+{
+  const EE_var_t *pv = &EE_var[CFG_EE_BANK1_SIZE && bank];
+
+  if ( (pv->erase_count == 0) || (page >= 2UL * pv->nb_pages) )
+  {
+    return 0;
+  }
+
+  return pv->erase_count[page];
+}
+
+/*****************************************************************************/
+
 void EE_Dump( int bank, uint16_t addr, uint32_t* data, uint16_t size )
 {
   EE_var_t *pv = &EE_var[CFG_EE_BANK1_SIZE && bank];;
-  uint32_t flash_addr, end_flash_addr, word, idx;
+  uint32_t flash_addr, end_flash_addr, word, idx, len, nb, i;
   uint64_t el;
 
   /* Parse all elements from active pool of flash */
@@ -330,21 +900,27 @@ void EE_Dump( int bank, uint16_t addr, uint32_t* data, uint16_t size )
     flash_addr += end_flash_addr;
   end_flash_addr += flash_addr;
 
-  for ( ; flash_addr < end_flash_addr; flash_addr += HW_FLASH_WIDTH )
+  for ( ; flash_addr < end_flash_addr; flash_addr += len * HW_FLASH_WIDTH )
   {
     /* Read one element from flash */
     el = *EE_PTR( flash_addr );
     word = (uint32_t)el;
+    len = EE_ElSize( el, (HW_FLASH_PAGE_SIZE - ((flash_addr - pv->address) %
+                                                HW_FLASH_PAGE_SIZE)) /
+                         HW_FLASH_WIDTH, &nb );
 
     /* Consider only valid word */
-    if ( (word >> 30) == (EE_TAG >> 14) )
+    if ( (nb > 1) || ((word >> 30) == (EE_TAG >> 14)) )
     {
-      /* Check variable index (addr, idx, size <= 0x4000) */
-      idx = ((uint32_t)((word << 2) >> 18)) - addr;
-      if ( idx < size )
+      for ( i = 0; i < nb; i++ )
       {
-        /* Write in the data buffer the variable data */
-        data[idx] = (uint32_t)(el >> 32);
+        /* Check variable index (addr, idx, size <= 0x4000) */
+        idx = ((uint32_t)((word << 2) >> 18)) + i - addr;
+        if ( idx < size )
+        {
+          /* Write in the data buffer the variable data */
+          data[idx] = EE_ElData( flash_addr, el, i );
+        }
       }
     }
   }
@@ -352,21 +928,48 @@ void EE_Dump( int bank, uint16_t addr, uint32_t* data, uint16_t size )
 
 /*****************************************************************************/
 
-static void EE_Reset( EE_var_t* pv, uint32_t address, uint8_t nb_pages )
+static void EE_Reset( EE_var_t* pv, uint32_t address, uint8_t nb_pages,
+                      uint16_t* index, uint16_t index_nb,
+                      uint16_t stats_addr, uint16_t* erase_count )
 {
+  uint32_t i;
+
   /* Reset global variables of the bank */
   pv->address = address;
   pv->nb_pages = nb_pages;
   pv->current_write_page = 0;
   pv->nb_written_elements = 0;
   pv->next_write_offset = EE_HEADER_SIZE;
+  pv->standby_blank = 0;
+  pv->erase_queued = 0;
+  pv->nb_sync_clean = 0;
+  pv->nb_user_elements = 0;
+  pv->nb_programmed_elements = 0;
+
+  /* The statistics are kept: they are either loaded from flash by the
+     recovery or saved again after a format */
+  pv->stats_addr = stats_addr;
+  pv->erase_count = erase_count;
+
+  /* Attach and clear the RAM index of the bank */
+  pv->index = index;
+  pv->index_nb = index_nb;
+  for ( i = 0; i < index_nb; i++ )
+  {
+    index[i] = 0;
+  }
 }
 
 /*****************************************************************************/
 
 static int EE_Recovery( EE_var_t* pv )
 {
-  uint32_t page, first_page, state, prev_state, flash_addr, i;
+  uint32_t page, first_page, state, prev_state, flash_addr, i, size, nb;
+  uint32_t time;
+  uint64_t el;
+  EE_InitProfile_t *pp = &EE_profile[pv - EE_var];
+
+  time = CFG_EE_TIME( );
 
   /* Search all pages for a reliable RECEIVE page then ACTIVE page */
   for ( state = EE_STATE_RECEIVE; state <= EE_STATE_ACTIVE; state++ )
@@ -378,12 +981,21 @@ static int EE_Recovery( EE_var_t* pv )
 
       if ( (page == 0) || (page == pv->nb_pages) )
       {
-        /* Check if state is reliable by checking state of next page */
-        if ( EE_GetState( pv, page + 1 ) != EE_STATE_ERASED )
+        /* Check if state is reliable by checking state of next page (only
+           inside the pool: the other pool may still be in ERASING state) */
+        if ( (pv->nb_pages > 1) &&
+             (EE_GetState( pv, page + 1 ) != EE_STATE_ERASED) )
           continue;
       }
       else
       {
+        /* A reset between the state updates of EE_NextPage leaves the next
+           page in the same state: the next page is the right one */
+        if ( ((page + 1) != pv->nb_pages) &&
+             ((page + 1) != 2UL * pv->nb_pages) &&
+             (EE_GetState( pv, page + 1 ) == state) )
+          continue;
+
         prev_state = EE_GetState( pv, page - 1 );
 
         if ( prev_state != state )
@@ -405,20 +1017,38 @@ static int EE_Recovery( EE_var_t* pv )
       /* Update write page */
       pv->current_write_page = page;
 
+      pp->write_state = (uint8_t)state;
+      pp->search = CFG_EE_TIME( ) - time;
+      time = CFG_EE_TIME( );
+
       /* Count elements already in ACTIVE or RECEIVE page */
       flash_addr = EE_FLASH_ADDR( pv, page ) + EE_HEADER_SIZE;
-      for ( i = 0; i < EE_NB_MAX_ELT; i++ )
+      for ( i = 0; i < EE_NB_MAX_ELT; i += size )
       {
         /* Check if current element is valid */
-        if ( *EE_PTR( flash_addr ) == EE_ERASED )
+        el = *EE_PTR( flash_addr );
+        if ( el == EE_ERASED )
           break;
 
+        /* A wide element takes all its words, even if its write has been
+           interrupted by reset: it is then cleared, so that its data words
+           are not taken for elements by a backward search */
+        size = EE_ElSize( el, EE_NB_MAX_ELT - i, &nb );
+        if ( (EE_WideNb( el ) != 0) &&
+             ((nb == 0) || !EE_ElIsValid( flash_addr, el, nb )) )
+        {
+          if ( EE_ClearEl( flash_addr, size ) != EE_OK )
+          {
+            return EE_WRITE_ERROR;
+          }
+        }
+
         /* Update global variables accordingly */
-        pv->nb_written_elements++;
-        pv->next_write_offset += HW_FLASH_WIDTH;
+        pv->nb_written_elements += size;
+        pv->next_write_offset += size * HW_FLASH_WIDTH;
 
         /* Next element address */
-        flash_addr += HW_FLASH_WIDTH;
+        flash_addr += size * HW_FLASH_WIDTH;
       }
 
       /* Count elements already transferred in previous pool pages */
@@ -430,6 +1060,9 @@ static int EE_Recovery( EE_var_t* pv )
         page--;
       }
 
+      pp->count = CFG_EE_TIME( ) - time;
+      time = CFG_EE_TIME( );
+
       /* If we have found a RECEIVE page, it means that pool transfer
          has been interrupted by reset */
       if ( state == EE_STATE_RECEIVE )
@@ -441,23 +1074,46 @@ static int EE_Recovery( EE_var_t* pv )
         }
       }
 
+      pp->transfer = CFG_EE_TIME( ) - time;
+      time = CFG_EE_TIME( );
+
+      /* Build the RAM index from the content of the active pool */
+      EE_BuildIndex( pv, pv->current_write_page );
+
+      pp->index = CFG_EE_TIME( ) - time;
+      time = CFG_EE_TIME( );
+
+      /* Get the statistics saved in the active pool */
+      EE_LoadStats( pv );
+
+      pp->stats = CFG_EE_TIME( ) - time;
+
       /* RECEIVE/ACTIVE page found, check if some erasing is needed */
 
       /* Get first page of unused pool */
       first_page = EE_NEXT_POOL( pv );
 
-      /* Erase all the pages not already erased in the pool */
+      /* The pages not already erased in the pool are set in ERASING state
+         (if a transfer has been interrupted before), then erased by the
+         clean (see EE_CleanPage): the recovery does not wait for erases */
       for ( page = first_page; page < first_page + pv->nb_pages; page++ )
       {
-        if ( EE_GetState( pv, page ) != EE_STATE_ERASED )
+        state = EE_GetState( pv, page );
+        if ( state != EE_STATE_ERASED )
         {
-//          if ( HW_FLASH_Erase( EE_FLASH_PAGE( pv, page ), 1, 0 ) != 0 )
-//          {
-//            return EE_ERASE_ERROR;
-//          }
-          if ( FD_EraseSectors( EE_FLASH_PAGE( pv, page ), 1) != 0 )
+          pp->dirty_pages++;
+        }
+
+        if ( (state != EE_STATE_ERASED) && (state != EE_STATE_ERASING) )
+        {
+          if ( EE_SetState( pv, page, EE_STATE_ERASING ) != EE_OK )
+          {
+            return EE_WRITE_ERROR;
+          }
+
+          if ( pv->erase_count )
           {
-            return EE_ERASE_ERROR;
+            pv->erase_count[page]++;
           }
         }
       }
@@ -474,7 +1130,10 @@ static int EE_Recovery( EE_var_t* pv )
 
 static int EE_Transfer( EE_var_t* pv, uint16_t addr, uint32_t page )
 {
-  uint32_t state, var, data, last_page;
+  uint32_t state, var, value, copied, first = 0, last_page, nb = 0, nb_el = 0;
+  uint32_t end;
+  uint32_t data[EE_BLOCK_NB];
+  uint64_t el[EE_BLOCK_NB];
 
   /* Input "page" is the first page of the new pool;
      We compute "last_page" as the last page of the old pool to be set
@@ -501,6 +1160,12 @@ static int EE_Transfer( EE_var_t* pv, uint16_t addr, uint32_t page )
         {
           return EE_WRITE_ERROR;
         }
+
+        /* The page erase is counted now so that it is saved below */
+        if ( pv->erase_count )
+        {
+          pv->erase_count[page]++;
+        }
       }
 
       EE_DBG( EE_6 );
@@ -511,112 +1176,452 @@ static int EE_Transfer( EE_var_t* pv, uint16_t addr, uint32_t page )
 
       page--;
     }
+
+    pv->nb_transfers++;
   }
 
-  /* Now, we can copy variables from one pool to the other */
+  /* Now, we can copy variables from one pool to the other (the ones
+     above the highest virtual address of the old pool are not searched) */
+
+  end = EE_PoolEnd( pv, last_page );
+
+  /* In case of recovery, the RAM index is built on the old pool so that
+     the variables absent from it are skipped without a flash search */
+  if ( addr == EE_TAG )
+  {
+    EE_BuildIndex( pv, last_page );
+  }
 
-  for ( var = 0; var < EE_NB_MAX_ELT * pv->nb_pages; var++ )
+  for ( var = 0; var < end; var++ )
   {
-    /* Check each variable except the one passed as parameter
-       (and except the ones already transferred in case of recovery) */
-    if  ( (var != addr) &&
-          ((addr != EE_TAG) ||
-           (EE_ReadEl( pv, var, &data, pv->current_write_page ) != EE_OK)) )
+    /* Check each variable except the one passed as parameter */
+    if ( (var == addr) || ((addr != EE_TAG) && EE_IS_STATS( pv, var )) )
     {
-      /* Read the last variable update */
-      if ( EE_ReadEl( pv, var, &data, last_page ) == EE_OK )
+      continue;
+    }
+
+    /* Read the last variable update (the RAM index points to the old pool,
+       except for the variables already copied by this transfer) */
+    if ( EE_ReadIdx( pv, var, &value, last_page ) == EE_OK )
+    {
+      /* In case of recovery, skip the variables already transferred */
+      if ( (addr == EE_TAG) &&
+           (EE_ReadEl( pv, var, &copied, pv->current_write_page ) == EE_OK) )
       {
-        EE_DBG( EE_7 );
+        continue;
+      }
+
+      EE_DBG( EE_7 );
 
-        /* In case variable corresponding to the virtual address was found,
-           copy the variable to the new active page */
-        if ( EE_WriteEl( pv, var, data ) != EE_OK )
+      /* In case variable corresponding to the virtual address was found,
+         copy the variable to the new active page (consecutive variables
+         are gathered to be packed in wide elements, and the elements are
+         written by groups) */
+      if ( (nb == EE_BLOCK_NB) || ((nb > 0) && (first + nb != var)) )
+      {
+        if ( EE_WriteVars( pv, el, &nb_el, first, data, nb ) != EE_OK )
         {
           return EE_WRITE_ERROR;
         }
+        nb = 0;
+      }
+
+      if ( nb == 0 )
+      {
+        first = var;
       }
+      data[nb++] = value;
+    }
+    else if ( var < pv->index_nb )
+    {
+      /* Variable is not present in the new pool */
+      pv->index[var] = 0;
     }
   }
 
-  /* Transfer is now done, mark the receive state page as active */
-  return EE_SetState( pv, pv->current_write_page, EE_STATE_ACTIVE );
-}
-
+  /* Write the last copied variables */
+  if ( (EE_WriteVars( pv, el, &nb_el, first, data, nb ) != EE_OK) ||
+       (EE_WriteEls( pv, el, nb_el ) != EE_OK) )
+  {
+    return EE_WRITE_ERROR;
+  }
+
+  /* Save the statistics updated by this transfer */
+  if ( (addr != EE_TAG) && (EE_WriteStats( pv ) != EE_OK) )
+  {
+    return EE_WRITE_ERROR;
+  }
+
+  /* Transfer is now done, mark the receive state page as active */
+  return EE_SetState( pv, pv->current_write_page, EE_STATE_ACTIVE );
+}
+
 /*****************************************************************************/
 
 static int EE_WriteEl( EE_var_t* pv, uint16_t addr, uint32_t data )
 {
-  uint32_t page, flash_addr;
   uint64_t el;
 
-  /* It is assumed here that the current pool is not full
+  /* Build element to be written in flash */
+  if ( addr == EE_TAG )
+  {
+    el = 0ULL;
+  }
+  else
+  {
+    el = EE_BuildEl( addr, data );
+  }
+
+  return EE_WriteEls( pv, &el, 1 );
+}
+
+/*****************************************************************************/
+
+static int EE_WriteEls( EE_var_t* pv, const uint64_t* el, uint32_t nb )
+{
+  uint32_t flash_addr, pos, size, n, i, addr;
+
+  /* It is assumed here that the current pool can hold the "nb" elements,
+     that they fit in the active page (or in the next one if it is full)
      and that free pages in this pool are in ERASED state */
 
+  if ( nb == 0 )
+  {
+    return EE_OK;
+  }
+
   /* Check if active page is full */
   if ( pv->next_write_offset >= HW_FLASH_PAGE_SIZE )
   {
-    /* Get current active page */
-    page = pv->current_write_page;
-
-    /* Set new page as was previous one (active or receive) */
-    if ( EE_SetState( pv, page + 1, EE_GetState( pv, page ) ) != EE_OK )
+    if ( EE_NextPage( pv ) != EE_OK )
     {
       return EE_WRITE_ERROR;
     }
+  }
 
-    EE_DBG( EE_8 );
+  /* Compute write address */
+  flash_addr =
+    EE_FLASH_ADDR( pv, pv->current_write_page ) + pv->next_write_offset;
 
-    /* Set current page in valid state */
-    if ( EE_SetState( pv, page, EE_STATE_VALID ) != EE_OK )
+  /* Write elements in flash with one flash driver call */
+  if ( FD_WriteData( flash_addr, (uint64_t*)el, nb ) != 0 )
+  {
+    return EE_WRITE_ERROR;
+  }
+
+  EE_wide_checked = 0;
+
+  /* Keep the RAM index up to date (all the variables of a wide element
+     point to its header) */
+  pos = (flash_addr - pv->address) / HW_FLASH_WIDTH;
+  for ( i = 0; i < nb; i += size )
+  {
+    size = EE_ElSize( el[i], nb - i, &n );
+    for ( addr = EE_EL_ADDR( el[i] ); (n > 0) && (addr < pv->index_nb);
+          n--, addr++ )
     {
-      return EE_WRITE_ERROR;
+      pv->index[addr] = (uint16_t)(pos + i);
+    }
+  }
+
+  /* Increment global variables relative to write operation done */
+  pv->next_write_offset += nb * HW_FLASH_WIDTH;
+  pv->nb_written_elements += nb;
+  pv->nb_programmed_elements += nb;
+
+  return EE_OK;
+}
+
+/*****************************************************************************/
+
+static int EE_WriteVars( EE_var_t* pv, uint64_t* el, uint32_t* nb_el,
+                         uint16_t addr, const uint32_t* data, uint32_t nb )
+{
+  uint32_t room, n;
+
+  /* Elements of consecutive variables are added to the group "el" of
+     "*nb_el" elements: the group is written when it is full, the last one
+     has to be written by the caller. It is assumed here that the current
+     pool can hold the "nb" variables as single elements */
+
+  while ( nb > 0 )
+  {
+    /* Room left in the group: all its elements are written in one page */
+    room = EE_NB_MAX_ELT;
+    if ( pv->next_write_offset < HW_FLASH_PAGE_SIZE )
+      room = (HW_FLASH_PAGE_SIZE - pv->next_write_offset) / HW_FLASH_WIDTH;
+    if ( room > EE_BLOCK_NB )
+      room = EE_BLOCK_NB;
+
+    if ( *nb_el >= room )
+    {
+      if ( EE_WriteEls( pv, el, *nb_el ) != EE_OK )
+      {
+        return EE_WRITE_ERROR;
+      }
+      *nb_el = 0;
+      continue;
+    }
+    room -= *nb_el;
+
+    /* Number of variables packed in a wide element fitting in the room
+       (a data equal to 0xFFFFFFFF ends it, so that no word of the element
+       is programmed to the erased value) */
+    n = 0;
+#if (CFG_EE_WIDE_NB > 1)
+    while ( (n < nb) && (n < CFG_EE_WIDE_NB) && (n + 4 < 2 * room) &&
+            (data[n] != 0xFFFFFFFFUL) )
+    {
+      n++;
+    }
+#endif /* CFG_EE_WIDE_NB */
+
+    /* Below 4 variables, a wide element (header, data, trailer) would
+       take more words than single elements */
+    if ( n >= 4 )
+    {
+      *nb_el += EE_BuildWide( el + *nb_el, addr, data, n );
+    }
+    else
+    {
+      el[(*nb_el)++] = EE_BuildEl( addr, *data );
+      n = 1;
     }
 
-    /* Update global variables to use next page */
-    pv->current_write_page = page + 1;
-    pv->next_write_offset = EE_HEADER_SIZE;
+    addr += n;
+    data += n;
+    nb -= n;
   }
 
-  /* Build element to be written in flash */
-  if ( addr == EE_TAG )
+  return EE_OK;
+}
+
+/*****************************************************************************/
+
+static int EE_ClearEl( uint32_t flash_addr, uint32_t size )
+{
+  uint64_t zero;
+
+  /* The words of the element are set to 0 from the last one, so that its
+     header is kept (and the element cleared again by the next recovery)
+     until all its data words are cleared */
+  while ( size-- > 0 )
   {
-    el = 0ULL;
+    zero = 0ULL;
+    if ( (*EE_PTR( flash_addr + (size * HW_FLASH_WIDTH) ) != 0ULL) &&
+         (FD_WriteData( flash_addr + (size * HW_FLASH_WIDTH), &zero, 1 ) != 0) )
+    {
+      return EE_WRITE_ERROR;
+    }
   }
-  else
+
+  EE_wide_checked = 0;
+
+  return EE_OK;
+}
+
+/*****************************************************************************/
+
+static uint32_t EE_PoolEnd( const EE_var_t* pv, uint32_t last_page )
+{
+  uint32_t page, flash_addr, offset, size, nb, end = 0;
+  uint64_t el;
+
+  /* Highest virtual address (+1) of the elements of the pool ending with
+     "last_page", CRC not checked: a corrupted element can only raise it */
+  for ( page = last_page + 1 - pv->nb_pages; page <= last_page; page++ )
   {
-    /* Build element from virtual addr and data, plus CRC */
-    el = ((((uint64_t)data) << 32) | ((EE_TAG | (addr & 0x3FFFUL)) << 16));
-    el |= EE_Crc( el );
+    flash_addr = EE_FLASH_ADDR( pv, page );
+    for ( offset = EE_HEADER_SIZE;
+          offset < HW_FLASH_PAGE_SIZE; offset += size * HW_FLASH_WIDTH )
+    {
+      el = *EE_PTR( flash_addr + offset );
+      size = EE_ElSize( el, (HW_FLASH_PAGE_SIZE - offset) / HW_FLASH_WIDTH,
+                        &nb );
+
+      if ( (nb != 0) && (EE_EL_ADDR( el ) + nb > end) )
+      {
+        end = EE_EL_ADDR( el ) + nb;
+      }
+    }
   }
 
-  /* Compute write address */
-  flash_addr =
-    EE_FLASH_ADDR( pv, pv->current_write_page ) + pv->next_write_offset;
+  /* No more variables than elements in a pool */
+  if ( end > EE_NB_MAX_ELT * pv->nb_pages )
+  {
+    end = EE_NB_MAX_ELT * pv->nb_pages;
+  }
 
-  /* Write element in flash */
-//  if ( HW_FLASH_Write( flash_addr, el ) != 0 )
-//  {
-//    return EE_WRITE_ERROR;
-//  }
+  return end;
+}
+
+/*****************************************************************************/
+
+static int EE_NextPage( EE_var_t* pv )
+{
+  uint32_t page;
 
-  if ( FD_WriteData( flash_addr, &el, 1 ) != 0 )
+  /* Get current active page */
+  page = pv->current_write_page;
+
+  /* Set new page as was previous one (active or receive) */
+  if ( EE_SetState( pv, page + 1, EE_GetState( pv, page ) ) != EE_OK )
   {
     return EE_WRITE_ERROR;
   }
 
-  /* Increment global variables relative to write operation done */
-  pv->next_write_offset += HW_FLASH_WIDTH;
-  pv->nb_written_elements++;
+  EE_DBG( EE_8 );
+
+  /* Set current page in valid state */
+  if ( EE_SetState( pv, page, EE_STATE_VALID ) != EE_OK )
+  {
+    return EE_WRITE_ERROR;
+  }
+
+  /* Update global variables to use next page */
+  pv->current_write_page = page + 1;
+  pv->next_write_offset = EE_HEADER_SIZE;
 
   return EE_OK;
 }
 
 /*****************************************************************************/
 
+static uint64_t EE_BuildEl( uint16_t addr, uint32_t data )
+{
+  uint64_t el;
+
+  /* Build element from virtual addr and data, plus CRC */
+  el = ((((uint64_t)data) << 32) | ((EE_TAG | (addr & 0x3FFFUL)) << 16));
+  el |= EE_Crc( el );
+
+  return el;
+}
+
+/*****************************************************************************/
+
+static uint32_t EE_BuildWide( uint64_t* el, uint16_t addr,
+                              const uint32_t* data, uint32_t nb )
+{
+  uint32_t i;
+
+  /* Data words, two per flash word */
+  for ( i = 0; i < nb; i += 2 )
+  {
+    el[1 + (i / 2)] = (uint64_t)data[i] |
+                      ((i + 1 < nb) ? (((uint64_t)data[i + 1]) << 32) : 0ULL);
+  }
+
+  /* Header from first virtual addr and number of data words, plus CRC of
+     the header and the data words, then trailer */
+  el[0] = ((((uint64_t)(~nb & 0xFFUL)) << 40) | (((uint64_t)nb) << 32) |
+           ((EE_TAG_WIDE | (addr & 0x3FFFUL)) << 16));
+  el[0] |= EE_CrcWide( el[0], data, nb );
+  el[1 + ((nb + 1) / 2)] = EE_WIDE_END( el[0] );
+
+  return 2 + ((nb + 1) / 2);
+}
+
+/*****************************************************************************/
+
+static uint32_t EE_WideNb( uint64_t el )
+{
+  uint32_t nb;
+
+  /* Number of data words if the word is the header of a wide element,
+     0 otherwise (erased word included) */
+  nb = (uint32_t)(el >> 32) & 0xFFUL;
+
+  if ( (((uint32_t)el >> 30) == (EE_TAG_WIDE >> 14)) && (nb >= 2) &&
+       (((uint32_t)(el >> 40) & 0xFFUL) == (~nb & 0xFFUL)) &&
+       ((el >> 48) == 0) )
+  {
+    return nb;
+  }
+
+  return 0;
+}
+
+/*****************************************************************************/
+
+static uint32_t EE_ElSize( uint64_t el, uint32_t max, uint32_t* nb )
+{
+  uint32_t size;
+
+  /* Returns the number of flash words of the element starting with "el"
+     (at most "max", the words left in the page) and gives the number of
+     variables it holds (0 if erased, cleared or truncated) */
+  if ( (el == EE_ERASED) || (el == 0ULL) )
+  {
+    *nb = 0;
+    return 1;
+  }
+
+  *nb = EE_WideNb( el );
+  if ( *nb == 0 )
+  {
+    *nb = 1;
+    return 1;
+  }
+
+  size = 2 + ((*nb + 1) / 2);
+  if ( size > max )
+  {
+    *nb = 0;
+    return max;
+  }
+
+  return size;
+}
+
+/*****************************************************************************/
+
+static int EE_ElIsValid( uint32_t flash_addr, uint64_t el, uint32_t nb )
+{
+  /* Check the CRC of an element holding "nb" variables (see EE_ElSize) */
+  if ( nb == 1 )
+  {
+    return (EE_Crc( el ) == (uint16_t)el);
+  }
+
+  if ( flash_addr == EE_wide_checked )
+  {
+    return 1;
+  }
+
+  /* An element without its trailer has not been fully written */
+  if ( (*EE_PTR( flash_addr + ((1 + ((nb + 1) / 2)) * HW_FLASH_WIDTH )) !=
+        EE_WIDE_END( el )) ||
+       (EE_CrcWide( el, EE_PTR32( flash_addr + HW_FLASH_WIDTH ), nb ) !=
+        (uint16_t)el) )
+  {
+    return 0;
+  }
+
+  EE_wide_checked = flash_addr;
+
+  return 1;
+}
+
+/*****************************************************************************/
+
+static uint32_t EE_ElData( uint32_t flash_addr, uint64_t el, uint32_t idx )
+{
+  /* Data of the variable of index "idx" in the element */
+  if ( EE_WideNb( el ) == 0 )
+  {
+    return (uint32_t)(el >> 32);
+  }
+
+  return EE_PTR32( flash_addr + HW_FLASH_WIDTH )[idx];
+}
+
+/*****************************************************************************/
+
 static int EE_ReadEl( const EE_var_t* pv,
                       uint16_t addr, uint32_t* data, uint32_t page )
 {
-  uint32_t flash_addr, offset;
+  uint32_t flash_addr, offset, size, nb, idx;
   uint64_t el;
 
   /* Search variable in the pool (in decreasing page order from "page") */
@@ -629,15 +1634,30 @@ static int EE_ReadEl( const EE_var_t* pv,
     {
       /* Read one element from flash */
       el = *EE_PTR( flash_addr + offset );
+      nb = (((uint32_t)el >> 30) == (EE_TAG >> 14)) ? 1 : 0;
+
+      /* The trailer of a wide element gives its header: its data words
+         are skipped */
+      if ( ((uint32_t)el >> 30) == (EE_TAG_END >> 14) )
+      {
+        el = EE_WIDE_END( el );
+        nb = EE_WideNb( el );
+        size = (1 + ((nb + 1) / 2)) * HW_FLASH_WIDTH;
+        if ( (nb == 0) || (offset < EE_HEADER_SIZE + size) ||
+             (*EE_PTR( flash_addr + offset - size ) != el) )
+        {
+          continue;
+        }
+        offset -= size;
+      }
 
       /* Compare the read address with the input address and check CRC:
          in case of failed CRC, data is corrupted and has to be skipped */
-      if ( (el != EE_ERASED) && (el != 0ULL) &&
-           (((el & 0x3FFFFFFFUL) >> 16) == addr) &&
-           (EE_Crc( el ) == (uint16_t)el) )
+      idx = (uint32_t)addr - EE_EL_ADDR( el );
+      if ( (idx < nb) && EE_ElIsValid( flash_addr + offset, el, nb ) )
       {
         /* Get variable data */
-        *data = (uint32_t)(el >> 32);
+        *data = EE_ElData( flash_addr + offset, el, idx );
 
         /* Variable is found */
         return EE_OK;
@@ -657,6 +1677,90 @@ static int EE_ReadEl( const EE_var_t* pv,
 
 /*****************************************************************************/
 
+static int EE_ReadIdx( const EE_var_t* pv,
+                       uint16_t addr, uint32_t* data, uint32_t page )
+{
+  uint32_t flash_addr, offset, nb, idx;
+  uint64_t el;
+
+  /* Variables outside of the RAM index are searched in flash */
+  if ( addr >= pv->index_nb )
+  {
+    return EE_ReadEl( pv, addr, data, page );
+  }
+
+  /* The RAM index is exhaustive: no entry means no variable in the pool */
+  if ( pv->index[addr] == 0 )
+  {
+    return EE_NOT_FOUND;
+  }
+
+  /* Read the indexed element from flash */
+  offset = pv->index[addr] * HW_FLASH_WIDTH;
+  flash_addr = pv->address + offset;
+  el = *EE_PTR( flash_addr );
+  (void)EE_ElSize( el, (HW_FLASH_PAGE_SIZE - (offset % HW_FLASH_PAGE_SIZE)) /
+                       HW_FLASH_WIDTH, &nb );
+
+  /* Check the element as done when searching in flash: in case of failed
+     CRC, fall back to the search of a previous value */
+  idx = (uint32_t)addr - EE_EL_ADDR( el );
+  if ( (idx < nb) && EE_ElIsValid( flash_addr, el, nb ) )
+  {
+    *data = EE_ElData( flash_addr, el, idx );
+    return EE_OK;
+  }
+
+  return EE_ReadEl( pv, addr, data, page );
+}
+
+/*****************************************************************************/
+
+static void EE_BuildIndex( EE_var_t* pv, uint32_t last_page )
+{
+  uint32_t page, flash_addr, offset, addr, size, nb;
+  uint64_t el;
+
+  if ( pv->index_nb == 0 )
+  {
+    return;
+  }
+
+  for ( addr = 0; addr < pv->index_nb; addr++ )
+  {
+    pv->index[addr] = 0;
+  }
+
+  /* Parse the pool up to "last_page" in increasing order: the last valid
+     element found for a virtual address is the one returned by EE_ReadEl() */
+  page = (last_page < pv->nb_pages) ? 0 : pv->nb_pages;
+  for ( ; page <= last_page; page++ )
+  {
+    flash_addr = EE_FLASH_ADDR( pv, page );
+    for ( offset = EE_HEADER_SIZE;
+          offset < HW_FLASH_PAGE_SIZE; offset += size * HW_FLASH_WIDTH )
+    {
+      /* Read one element from flash */
+      el = *EE_PTR( flash_addr + offset );
+      size = EE_ElSize( el, (HW_FLASH_PAGE_SIZE - offset) / HW_FLASH_WIDTH,
+                        &nb );
+      addr = EE_EL_ADDR( el );
+
+      if ( (nb != 0) && (addr < pv->index_nb) &&
+           EE_ElIsValid( flash_addr + offset, el, nb ) )
+      {
+        for ( ; (nb > 0) && (addr < pv->index_nb); nb--, addr++ )
+        {
+          pv->index[addr] =
+            (uint16_t)((flash_addr + offset - pv->address) / HW_FLASH_WIDTH);
+        }
+      }
+    }
+  }
+}
+
+/*****************************************************************************/
+
 static int EE_SetState( const EE_var_t* pv, uint32_t page, uint32_t state )
 {
   uint32_t flash_addr;
@@ -702,14 +1806,529 @@ static uint32_t EE_GetState( const EE_var_t* pv, uint32_t page )
 
 /*****************************************************************************/
 
+static uint32_t EE_LastDirtyPage( const EE_var_t* pv )
+{
+  uint32_t page, first_page;
+
+  /* Get first page of unused pool */
+  first_page = EE_NEXT_POOL( pv );
+
+  /* Search the last page of the unused pool which is not erased */
+  for ( page = first_page + pv->nb_pages - 1; page > first_page; page-- )
+  {
+    if ( EE_GetState( pv, page ) != EE_STATE_ERASED )
+      break;
+  }
+
+  return page;
+}
+
+/*****************************************************************************/
+
+static int EE_IsBlank( const EE_var_t* pv, uint32_t page )
+{
+  uint32_t flash_addr, end_flash_addr;
+
+  /* Check that all the words of the page, header included, are erased */
+  flash_addr = EE_FLASH_ADDR( pv, page );
+  end_flash_addr = flash_addr + HW_FLASH_PAGE_SIZE;
+
+  for ( ; flash_addr < end_flash_addr; flash_addr += HW_FLASH_WIDTH )
+  {
+    if ( *EE_PTR( flash_addr ) != EE_ERASED )
+      return 0;
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+
+static int EE_CleanStep( EE_var_t* pv, int async )
+{
+  uint32_t page, first_page;
+
+  /* Nothing to do if the pool is already erased and verified */
+  if ( pv->standby_blank >= pv->nb_pages )
+  {
+    return EE_OK;
+  }
+
+  /* Get first page of unused pool */
+  first_page = EE_NEXT_POOL( pv );
+
+  if ( EE_GetState( pv, first_page ) != EE_STATE_ERASED )
+  {
+    /* Erase the last page not already erased: the pages are erased in
+       descending order so that the first page remains in ERASING state
+       until the whole pool is erased */
+    page = EE_LastDirtyPage( pv );
+
+    /* The blank check of the pool is still to be done */
+    pv->standby_blank = 0;
+
+    /* Queue the erase to the flash driver: if the queue is full, the erase
+       is done in polling mode */
+    if ( async )
+    {
+      pv->erase_queued = 1;
+      if ( FD_SubmitErase( EE_FLASH_PAGE( pv, page ), 1,
+                           EE_EraseDone, pv ) == 0 )
+      {
+        return EE_CLEAN_QUEUED;
+      }
+      pv->erase_queued = 0;
+    }
+
+    if ( FD_EraseSectors( EE_FLASH_PAGE( pv, page ), 1 ) != 0 )
+    {
+      return EE_ERASE_ERROR;
+    }
+
+    return EE_CLEAN_NEEDED;
+  }
+
+  /* Then check that the pages are fully blank, in ascending order: a page
+     may have been left partially erased or programmed by a reset */
+  page = first_page + pv->standby_blank;
+
+  if ( !EE_IsBlank( pv, page ) )
+  {
+    if ( FD_EraseSectors( EE_FLASH_PAGE( pv, page ), 1 ) != 0 )
+    {
+      return EE_ERASE_ERROR;
+    }
+
+    if ( pv->erase_count )
+    {
+      pv->erase_count[page]++;
+    }
+
+    if ( !EE_IsBlank( pv, page ) )
+    {
+      return EE_ERASE_ERROR;
+    }
+  }
+
+  pv->standby_blank++;
+
+  return (pv->standby_blank < pv->nb_pages) ? EE_CLEAN_NEEDED : EE_OK;
+}
+
+/*****************************************************************************/
+
+static void EE_EraseDone( void* arg )
+{
+  EE_var_t *pv = (EE_var_t*)arg;
+
+  pv->erase_queued = 0;
+
+  if ( pv->clean_callback )
+  {
+    pv->clean_callback( );
+  }
+}
+
+/*****************************************************************************/
+
+static int EE_PrepareStandby( int bank )
+{
+  int status;
+
+  /* Erase and check the standby pool page by page up to the end */
+  do
+  {
+    status = EE_CleanPage( bank );
+  }
+  while ( status == EE_CLEAN_NEEDED );
+
+  return status;
+}
+
+/*****************************************************************************/
+
+static void EE_LoadStats( EE_var_t* pv )
+{
+  uint32_t i, data;
+
+  if ( pv->erase_count == 0 )
+  {
+    return;
+  }
+
+  /* Erase counts of two pages per variable (0 if never saved) */
+  for ( i = 0; i < pv->nb_pages; i++ )
+  {
+    if ( EE_ReadIdx( pv, pv->stats_addr + i, &data,
+                     pv->current_write_page ) != EE_OK )
+    {
+      data = 0;
+    }
+
+    pv->erase_count[2 * i] = (uint16_t)data;
+    pv->erase_count[2 * i + 1] = (uint16_t)(data >> 16);
+  }
+
+  /* Then number of pool transfers */
+  if ( EE_ReadIdx( pv, pv->stats_addr + pv->nb_pages, &data,
+                   pv->current_write_page ) != EE_OK )
+  {
+    data = 0;
+  }
+
+  pv->nb_transfers = data;
+
+#if CFG_EE_STATS
+  EE_stats_loaded |= 1UL << (pv - EE_var);
+#endif /* CFG_EE_STATS */
+}
+
+/*****************************************************************************/
+
+static void EE_ScanStats( EE_var_t* pv )
+{
+  uint32_t page, flash_addr, offset, size, nb, idx, var, data;
+  uint64_t el;
+
+  if ( pv->erase_count == 0 )
+  {
+    return;
+  }
+
+  /* Statistics variables found in all the pages of the bank, whatever
+     their state (the bank is going to be formatted): the counts only
+     increase, so the highest value of each one is kept */
+  for ( page = 0; page < 2UL * pv->nb_pages; page++ )
+  {
+    pv->erase_count[page] = 0;
+  }
+  pv->nb_transfers = 0;
+
+  for ( page = 0; page < 2UL * pv->nb_pages; page++ )
+  {
+    flash_addr = EE_FLASH_ADDR( pv, page );
+    for ( offset = EE_HEADER_SIZE;
+          offset < HW_FLASH_PAGE_SIZE; offset += size * HW_FLASH_WIDTH )
+    {
+      el = *EE_PTR( flash_addr + offset );
+      size = EE_ElSize( el, (HW_FLASH_PAGE_SIZE - offset) / HW_FLASH_WIDTH,
+                        &nb );
+
+      if ( (nb == 0) ||
+           (EE_EL_ADDR( el ) + nb <= pv->stats_addr) ||
+           (EE_EL_ADDR( el ) > pv->stats_addr + pv->nb_pages) ||
+           !EE_ElIsValid( flash_addr + offset, el, nb ) )
+      {
+        continue;
+      }
+
+      for ( idx = 0; idx < nb; idx++ )
+      {
+        var = EE_EL_ADDR( el ) + idx;
+        if ( !EE_IS_STATS( pv, var ) )
+        {
+          continue;
+        }
+
+        data = EE_ElData( flash_addr + offset, el, idx );
+        var -= pv->stats_addr;
+        if ( var == pv->nb_pages )
+        {
+          if ( data > pv->nb_transfers )
+          {
+            pv->nb_transfers = data;
+          }
+          continue;
+        }
+
+        if ( (uint16_t)data > pv->erase_count[2 * var] )
+        {
+          pv->erase_count[2 * var] = (uint16_t)data;
+        }
+        if ( (uint16_t)(data >> 16) > pv->erase_count[2 * var + 1] )
+        {
+          pv->erase_count[2 * var + 1] = (uint16_t)(data >> 16);
+        }
+      }
+    }
+  }
+
+  EE_wide_checked = 0;
+}
+
+/*****************************************************************************/
+
+static int EE_WriteStats( EE_var_t* pv )
+{
+  uint64_t el[EE_BLOCK_NB];
+  uint32_t data[EE_BLOCK_NB];
+  uint32_t i, nb = 0, nb_el = 0;
+
+  if ( pv->erase_count == 0 )
+  {
+    return EE_OK;
+  }
+
+  /* Same layout as read by EE_LoadStats (the variables are written by
+     groups, the pool having always room for them) */
+  for ( i = 0; i <= pv->nb_pages; i++ )
+  {
+    data[nb++] = (i < pv->nb_pages) ?
+                 (pv->erase_count[2 * i] |
+                  ((uint32_t)pv->erase_count[2 * i + 1] << 16)) :
+                 pv->nb_transfers;
+
+    if ( (nb == EE_BLOCK_NB) || (i == pv->nb_pages) )
+    {
+      if ( EE_WriteVars( pv, el, &nb_el, pv->stats_addr + i + 1 - nb,
+                         data, nb ) != EE_OK )
+      {
+        return EE_WRITE_ERROR;
+      }
+      nb = 0;
+    }
+  }
+
+  return EE_WriteEls( pv, el, nb_el );
+}
+
+/*****************************************************************************/
+
+#if CFG_EE_FAST_INIT
+
+static int EE_Resume( int format, uint32_t base_address )
+{
+  int resume;
+
+  /* The state is resumed only after a clean shutdown, if it has not been
+     changed since (CRC) and if the flash matches it */
+  resume = ( (format == 0) &&
+             (EE_marker.magic == EE_MARKER_SHUTDOWN) &&
+             (EE_marker.address == base_address) &&
+             (EE_marker.crc == EE_StateCrc( )) &&
+             EE_CheckState( &EE_var[0] ) &&
+             (!CFG_EE_BANK1_SIZE || EE_CheckState( &EE_var[1] )) );
+
+#if CFG_EE_STATS
+  /* The statistics left in RAM are kept by a format only if they have
+     been loaded since the power-on */
+  if ( !resume && (EE_marker.magic != EE_MARKER_RUNNING) &&
+       (EE_marker.magic != EE_MARKER_SHUTDOWN) )
+  {
+    uint32_t i;
+
+    for ( i = 0; i < sizeof(EE_erase_count) / 2; i++ )
+    {
+      EE_erase_count[i] = 0;
+    }
+  }
+#endif /* CFG_EE_STATS */
+
+  EE_marker.magic = EE_MARKER_RUNNING;
+
+  if ( resume )
+  {
+    /* Per boot counters and flash driver requests lost by the reset (a
+       queued erase is done again by the next clean) */
+    EE_var[0].nb_user_elements = 0;
+    EE_var[0].nb_programmed_elements = 0;
+    EE_var[0].nb_sync_clean = 0;
+    EE_var[0].erase_queued = 0;
+    EE_var[0].clean_callback = 0;
+
+    if ( CFG_EE_BANK1_SIZE )
+    {
+      EE_var[1].nb_user_elements = 0;
+      EE_var[1].nb_programmed_elements = 0;
+      EE_var[1].nb_sync_clean = 0;
+      EE_var[1].erase_queued = 0;
+      EE_var[1].clean_callback = 0;
+    }
+  }
+
+  return resume;
+}
+
+/*****************************************************************************/
+
+static int EE_CheckState( const EE_var_t* pv )
+{
+  uint32_t page, first_page, standby_state, flash_addr;
+
+  /* Check the pages around the write position only: write page ACTIVE,
+     previous page VALID, next page ERASED, standby pool not in use */
+  page = pv->current_write_page;
+  first_page = (page < pv->nb_pages) ? 0 : pv->nb_pages;
+  standby_state = EE_GetState( pv, EE_NEXT_POOL( pv ) );
+
+  if ( (page >= 2UL * pv->nb_pages) ||
+       (pv->next_write_offset < EE_HEADER_SIZE) ||
+       (pv->next_write_offset > HW_FLASH_PAGE_SIZE) ||
+       (pv->nb_written_elements !=
+        ((page - first_page) * EE_NB_MAX_ELT) +
+        ((pv->next_write_offset - EE_HEADER_SIZE) / HW_FLASH_WIDTH)) ||
+       (EE_GetState( pv, page ) != EE_STATE_ACTIVE) ||
+       ((page != first_page) &&
+        (EE_GetState( pv, page - 1 ) != EE_STATE_VALID)) ||
+       ((page + 1 < first_page + pv->nb_pages) &&
+        (EE_GetState( pv, page + 1 ) != EE_STATE_ERASED)) ||
+       ((standby_state != EE_STATE_ERASED) &&
+        (standby_state != EE_STATE_ERASING)) )
+  {
+    return 0;
+  }
+
+  /* The write position is the end of the programmed words */
+  flash_addr = EE_FLASH_ADDR( pv, page ) + pv->next_write_offset;
+
+  if ( ((pv->next_write_offset < HW_FLASH_PAGE_SIZE) &&
+        (*EE_PTR( flash_addr ) != EE_ERASED)) ||
+       ((pv->next_write_offset > EE_HEADER_SIZE) &&
+        (*EE_PTR( flash_addr - HW_FLASH_WIDTH ) == EE_ERASED)) )
+  {
+    return 0;
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+
+static uint16_t EE_StateCrc( void )
+{
+  uint16_t crc;
+
+  /* CRC of the state of the banks, of their RAM index and statistics */
+  crc = EE_CrcWide( 0, (const uint32_t*)EE_var, sizeof(EE_var) / 4 );
+#if CFG_EE_INDEX
+  crc ^= EE_CrcWide( 0, (const uint32_t*)EE_index, sizeof(EE_index) / 4 );
+#endif /* CFG_EE_INDEX */
+#if CFG_EE_STATS
+  crc ^= EE_CrcWide( 0, (const uint32_t*)EE_erase_count,
+                     sizeof(EE_erase_count) / 4 );
+#endif /* CFG_EE_STATS */
+
+  return crc;
+}
+
+#endif /* CFG_EE_FAST_INIT */
+
+/*****************************************************************************/
+
+/*
+ * The element CRC is the CRC16-CCITT (polynomial 0x1021, initial value 0,
+ * no reflection) of the 6 upper bytes of the element, taken from byte 2 to
+ * byte 7, followed for a wide element by its data words (most significant
+ * byte first). All the backends give the same result, so that the flash
+ * content does not depend on the selected one.
+ */
+
+#if (CFG_EE_CRC == EE_CRC_TABLE)
+
+static const uint16_t EE_CrcTable[256] =
+{
+  0x0000U, 0x1021U, 0x2042U, 0x3063U, 0x4084U, 0x50A5U, 0x60C6U, 0x70E7U,
+  0x8108U, 0x9129U, 0xA14AU, 0xB16BU, 0xC18CU, 0xD1ADU, 0xE1CEU, 0xF1EFU,
+  0x1231U, 0x0210U, 0x3273U, 0x2252U, 0x52B5U, 0x4294U, 0x72F7U, 0x62D6U,
+  0x9339U, 0x8318U, 0xB37BU, 0xA35AU, 0xD3BDU, 0xC39CU, 0xF3FFU, 0xE3DEU,
+  0x2462U, 0x3443U, 0x0420U, 0x1401U, 0x64E6U, 0x74C7U, 0x44A4U, 0x5485U,
+  0xA56AU, 0xB54BU, 0x8528U, 0x9509U, 0xE5EEU, 0xF5CFU, 0xC5ACU, 0xD58DU,
+  0x3653U, 0x2672U, 0x1611U, 0x0630U, 0x76D7U, 0x66F6U, 0x5695U, 0x46B4U,
+  0xB75BU, 0xA77AU, 0x9719U, 0x8738U, 0xF7DFU, 0xE7FEU, 0xD79DU, 0xC7BCU,
+  0x48C4U, 0x58E5U, 0x6886U, 0x78A7U, 0x0840U, 0x1861U, 0x2802U, 0x3823U,
+  0xC9CCU, 0xD9EDU, 0xE98EU, 0xF9AFU, 0x8948U, 0x9969U, 0xA90AU, 0xB92BU,
+  0x5AF5U, 0x4AD4U, 0x7AB7U, 0x6A96U, 0x1A71U, 0x0A50U, 0x3A33U, 0x2A12U,
+  0xDBFDU, 0xCBDCU, 0xFBBFU, 0xEB9EU, 0x9B79U, 0x8B58U, 0xBB3BU, 0xAB1AU,
+  0x6CA6U, 0x7C87U, 0x4CE4U, 0x5CC5U, 0x2C22U, 0x3C03U, 0x0C60U, 0x1C41U,
+  0xEDAEU, 0xFD8FU, 0xCDECU, 0xDDCDU, 0xAD2AU, 0xBD0BU, 0x8D68U, 0x9D49U,
+  0x7E97U, 0x6EB6U, 0x5ED5U, 0x4EF4U, 0x3E13U, 0x2E32U, 0x1E51U, 0x0E70U,
+  0xFF9FU, 0xEFBEU, 0xDFDDU, 0xCFFCU, 0xBF1BU, 0xAF3AU, 0x9F59U, 0x8F78U,
+  0x9188U, 0x81A9U, 0xB1CAU, 0xA1EBU, 0xD10CU, 0xC12DU, 0xF14EU, 0xE16FU,
+  0x1080U, 0x00A1U, 0x30C2U, 0x20E3U, 0x5004U, 0x4025U, 0x7046U, 0x6067U,
+  0x83B9U, 0x9398U, 0xA3FBU, 0xB3DAU, 0xC33DU, 0xD31CU, 0xE37FU, 0xF35EU,
+  0x02B1U, 0x1290U, 0x22F3U, 0x32D2U, 0x4235U, 0x5214U, 0x6277U, 0x7256U,
+  0xB5EAU, 0xA5CBU, 0x95A8U, 0x8589U, 0xF56EU, 0xE54FU, 0xD52CU, 0xC50DU,
+  0x34E2U, 0x24C3U, 0x14A0U, 0x0481U, 0x7466U, 0x6447U, 0x5424U, 0x4405U,
+  0xA7DBU, 0xB7FAU, 0x8799U, 0x97B8U, 0xE75FU, 0xF77EU, 0xC71DU, 0xD73CU,
+  0x26D3U, 0x36F2U, 0x0691U, 0x16B0U, 0x6657U, 0x7676U, 0x4615U, 0x5634U,
+  0xD94CU, 0xC96DU, 0xF90EU, 0xE92FU, 0x99C8U, 0x89E9U, 0xB98AU, 0xA9ABU,
+  0x5844U, 0x4865U, 0x7806U, 0x6827U, 0x18C0U, 0x08E1U, 0x3882U, 0x28A3U,
+  0xCB7DU, 0xDB5CU, 0xEB3FU, 0xFB1EU, 0x8BF9U, 0x9BD8U, 0xABBBU, 0xBB9AU,
+  0x4A75U, 0x5A54U, 0x6A37U, 0x7A16U, 0x0AF1U, 0x1AD0U, 0x2AB3U, 0x3A92U,
+  0xFD2EU, 0xED0FU, 0xDD6CU, 0xCD4DU, 0xBDAAU, 0xAD8BU, 0x9DE8U, 0x8DC9U,
+  0x7C26U, 0x6C07U, 0x5C64U, 0x4C45U, 0x3CA2U, 0x2C83U, 0x1CE0U, 0x0CC1U,
+  0xEF1FU, 0xFF3EU, 0xCF5DU, 0xDF7CU, 0xAF9BU, 0xBFBAU, 0x8FD9U, 0x9FF8U,
+  0x6E17U, 0x7E36U, 0x4E55U, 0x5E74U, 0x2E93U, 0x3EB2U, 0x0ED1U, 0x1EF0U
+};
+
+#endif /* CFG_EE_CRC == EE_CRC_TABLE */
+
+/*****************************************************************************/
+
+static void EE_CrcInit( void )
+{
+#if (CFG_EE_CRC == EE_CRC_HW)
+  /* The CRC peripheral is dedicated to the EE module: it is configured once
+     here and only reset before each element */
+  LL_AHB1_GRP1_EnableClock( LL_AHB1_GRP1_PERIPH_CRC );
+  LL_CRC_SetPolynomialSize( CRC, LL_CRC_POLYLENGTH_16B );
+  LL_CRC_SetPolynomialCoef( CRC, 0x1021UL );
+  LL_CRC_SetInputDataReverseMode( CRC, LL_CRC_INDATA_REVERSE_NONE );
+  LL_CRC_SetOutputDataReverseMode( CRC, LL_CRC_OUTDATA_REVERSE_NONE );
+  LL_CRC_SetInitialData( CRC, 0 );
+#endif /* CFG_EE_CRC == EE_CRC_HW */
+}
+
+/*****************************************************************************/
+
 static uint16_t EE_Crc( uint64_t v )
 {
+  return EE_CrcWide( v, 0, 0 );
+}
+
+/*****************************************************************************/
+
+static uint16_t EE_CrcWide( uint64_t v, const uint32_t* data, uint32_t nb )
+{
+#if (CFG_EE_CRC == EE_CRC_HW)
+
+  LL_CRC_ResetCRCCalculationUnit( CRC );
+  LL_CRC_FeedData8( CRC, (uint8_t)(v >> 16) );
+  LL_CRC_FeedData8( CRC, (uint8_t)(v >> 24) );
+  LL_CRC_FeedData8( CRC, (uint8_t)(v >> 32) );
+  LL_CRC_FeedData8( CRC, (uint8_t)(v >> 40) );
+  LL_CRC_FeedData8( CRC, (uint8_t)(v >> 48) );
+  LL_CRC_FeedData8( CRC, (uint8_t)(v >> 56) );
+
+  /* Without input reversal, a 32-bit word is processed from its MSB */
+  for ( ; nb > 0; nb--, data++ )
+  {
+    LL_CRC_FeedData32( CRC, *data );
+  }
+
+  return LL_CRC_ReadData16( CRC );
+
+#elif (CFG_EE_CRC == EE_CRC_TABLE)
+
+  uint32_t crc = 0;
+
+#define EE_CRC_BYTE( b ) crc = (crc << 8) ^ \
+                         EE_CrcTable[((crc >> 8) ^ (b)) & 0xFFUL]
+
+#else /* CFG_EE_CRC == EE_CRC_REF */
+
   uint32_t x, crc = 0;
 
-#define EE_CRC_STEP( n ) x = ((crc >> 8) ^ (uint8_t)(v >> n)) & 0xFFUL; \
+#define EE_CRC_BYTE( b ) x = ((crc >> 8) ^ (b)) & 0xFFUL; \
                          x ^= x >> 4; \
                          crc = (crc << 8) ^ (x << 12) ^ (x << 5) ^ x
 
+#endif /* CFG_EE_CRC */
+
+#if (CFG_EE_CRC != EE_CRC_HW)
+
+#define EE_CRC_STEP( n ) EE_CRC_BYTE( (uint8_t)(v >> n) )
+
   EE_CRC_STEP( 16 );
   EE_CRC_STEP( 24 );
   EE_CRC_STEP( 32 );
@@ -717,7 +2336,17 @@ static uint16_t EE_Crc( uint64_t v )
   EE_CRC_STEP( 48 );
   EE_CRC_STEP( 56 );
 
+  for ( ; nb > 0; nb--, data++ )
+  {
+    EE_CRC_BYTE( (uint8_t)(*data >> 24) );
+    EE_CRC_BYTE( (uint8_t)(*data >> 16) );
+    EE_CRC_BYTE( (uint8_t)(*data >> 8) );
+    EE_CRC_BYTE( (uint8_t)*data );
+  }
+
   return (uint16_t)crc;
+
+#endif /* CFG_EE_CRC != EE_CRC_HW */
 }
 
 /*****************************************************************************/
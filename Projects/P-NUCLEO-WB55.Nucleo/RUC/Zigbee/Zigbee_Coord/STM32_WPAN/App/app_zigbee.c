@@ -18,6 +18,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "app_common.h"
+#include "app_entry.h"
 #include "tl_zigbee_hci.h"
 #include "shci.h"
 #include "stm32wbxx_core_interface_def.h"
@@ -35,10 +36,22 @@
 
 /* Private defines -----------------------------------------------------------*/
 #define APP_ZIGBEE_STARTUP_FAIL_DELAY  500U
+#define ZIGBEE_CMD_QUEUE_SIZE          4U    /* asynchronous commands to the M0 waiting for their completion */
+#define ZIGBEE_CMD_QUEUE_ENTRIES       (ZIGBEE_CMD_QUEUE_SIZE + 1U) /* and the blocking command */
 #define CHANNEL                        25
 #define CHANNELMASK_USED               (1<< CHANNEL)
 // #define CHANNELMASK_USED               WPAN_CHANNELMASK_2400MHZ; /* Full Channel in use */
 
+/* Private types -------------------------------------------------------------*/
+/* Asynchronous command to the M0 */
+typedef struct
+{
+  Zigbee_Cmd_Request_t * p_cmd;      /* request, then response of the M0 */
+  ZIGBEE_CmdCallback_t   callback;
+  void                 * arg;
+  __IO bool              done;       /* response received */
+} ZIGBEE_CmdEntry_t;
+
 /* Private function prototypes -----------------------------------------------*/
 static enum ZbStatusCodeT ZbStartupWait(struct ZigBeeT *zb, struct ZbStartupT *config);
 static void App_Zigbee_NwkForm       (void);
@@ -52,6 +65,10 @@ static void App_Zigbee_TraceError    (const char *pMess, uint32_t ErrCode);
 static void Wait_Getting_Ack_From_M0    (void);
 static void Receive_Ack_From_M0         (void);
 static void Receive_Notification_From_M0(void);
+static ZIGBEE_CmdEntry_t * ZIGBEE_CmdQueue(Zigbee_Cmd_Request_t *p_cmd, ZIGBEE_CmdCallback_t callback, void *arg);
+static void ZIGBEE_CmdSendNext          (void);
+static void ZIGBEE_CmdCopy              (Zigbee_Cmd_Request_t *p_dst, const Zigbee_Cmd_Request_t *p_src);
+static void App_Zigbee_ProcessCmdDone   (void);
 
 /* Private variables ---------------------------------------------------------*/
 static int8_t           tx_power = 0;
@@ -61,6 +78,17 @@ static TL_EvtPacket_t * p_ZIGBEE_request_M0_to_M4;
 static __IO uint32_t    CptReceiveNotifyFromM0 = 0;
 static __IO uint32_t    CptReceiveRequestFromM0 = 0;
 
+/* Commands to the M0 : sent one at a time, in the order of their submission.
+ * The queue holds, from ZigbeeCmdHead, the commands completed and waiting for
+ * their callback, the one waiting for the M0 ack, then the ZigbeeCmdToSend ones
+ * not sent yet. The blocking command is queued the same way, always last */
+static Zigbee_Cmd_Request_t ZigbeeCmdSync;                    /* blocking command and its response */
+static ZIGBEE_CmdEntry_t    ZigbeeCmdQueue[ZIGBEE_CMD_QUEUE_ENTRIES];
+static uint8_t              ZigbeeCmdHead;
+static uint8_t              ZigbeeCmdNb;
+static uint8_t              ZigbeeCmdToSend;
+static ZIGBEE_CmdEntry_t    * __IO p_ZIGBEE_entry_in_flight;   /* command waiting for the M0 ack */
+
 /* Buffer memories */
 PLACE_IN_SECTION("MB_MEM1") ALIGN(4) static TL_ZIGBEE_Config_t ZigbeeConfigBuffer;
 PLACE_IN_SECTION("MB_MEM2") ALIGN(4) static TL_CmdPacket_t     ZigbeeOtCmdBuffer;
@@ -99,11 +127,12 @@ void App_Zigbee_Init(void)
   App_Zigbee_TL_INIT();
 
   /* Flash Init */
-  App_NVM_Init();
+  App_NVM_Init(APPE_GetResetFlags());
 
   /* Create the different tasks */
   UTIL_SEQ_RegTask(1U << (uint32_t)CFG_TASK_NOTIFY_FROM_M0_TO_M4,  UTIL_SEQ_RFU, App_Zigbee_ProcessNotifyM0ToM4);
   UTIL_SEQ_RegTask(1U << (uint32_t)CFG_TASK_REQUEST_FROM_M0_TO_M4, UTIL_SEQ_RFU, App_Zigbee_ProcessRequestM0ToM4);
+  UTIL_SEQ_RegTask(1U << (uint32_t)CFG_TASK_ZIGBEE_CMD_DONE, UTIL_SEQ_RFU, App_Zigbee_ProcessCmdDone);
 
   /* Task associated with network creation process */
   UTIL_SEQ_RegTask(1U << CFG_TASK_ZIGBEE_NETWORK_FORM, UTIL_SEQ_RFU, App_Zigbee_NwkForm);
@@ -645,14 +674,16 @@ void App_Zigbee_RegisterCmdBuffer(TL_CmdPacket_t *p_buffer)
   p_ZIGBEE_otcmdbuffer = p_buffer;
 } /* App_Zigbee_RegisterCmdBuffer */
 
+/* The blocking command is built in ZigbeeCmdSync and its response copied back
+ * there, as the M0 command buffer may carry an asynchronous command meanwhile */
 Zigbee_Cmd_Request_t * ZIGBEE_Get_OTCmdPayloadBuffer(void)
 {
-  return (Zigbee_Cmd_Request_t *)p_ZIGBEE_otcmdbuffer->cmdserial.cmd.payload;
+  return &ZigbeeCmdSync;
 } /* ZIGBEE_Get_OTCmdPayloadBuffer */
 
 Zigbee_Cmd_Request_t * ZIGBEE_Get_OTCmdRspPayloadBuffer(void)
 {
-  return (Zigbee_Cmd_Request_t *)((TL_EvtPacket_t *)p_ZIGBEE_otcmdbuffer)->evtserial.evt.payload;
+  return &ZigbeeCmdSync;
 } /* ZIGBEE_Get_OTCmdRspPayloadBuffer */
 
 Zigbee_Cmd_Request_t * ZIGBEE_Get_NotificationPayloadBuffer(void)
@@ -667,12 +698,122 @@ Zigbee_Cmd_Request_t * ZIGBEE_Get_M0RequestPayloadBuffer(void)
 
 /**
  * @brief  This function is used to transfer the commands from the M4 to the M0.
+ *         Blocking : the command built in ZigbeeCmdSync is queued as an
+ *         asynchronous one, the commands queued before being sent first
+ *         (within the Pre/Post_ZigbeeCmdProcessing() of the caller), and it
+ *         returns with the response of the M0 in ZigbeeCmdSync. The callbacks
+ *         of the asynchronous commands are not called from here but from
+ *         their task.
  * @param   None
  * @return  None
  */
 void ZIGBEE_CmdTransfer(void)
+{
+  ZIGBEE_CmdEntry_t *entry = ZIGBEE_CmdQueue(&ZigbeeCmdSync, NULL, NULL);
+
+  /* Wait completion of cmd */
+  while (!entry->done)
+  {
+    ZIGBEE_CmdSendNext();
+    Wait_Getting_Ack_From_M0();
+  }
+
+  /* Only the M0 requests are processed during the wait, so no command was
+   * queued after this one : its entry is released at once */
+  ZigbeeCmdNb--;
+} /* ZIGBEE_CmdTransfer */
+
+/**
+ * @brief  Submit a command to the M0 without waiting for its completion.
+ *         The command is sent from the CFG_TASK_ZIGBEE_CMD_DONE task after
+ *         Pre_ZigbeeCmdProcessing(), as the stack requests, once the previous
+ *         ones are acknowledged by the M0 (a blocking transfer sends it
+ *         first). Its response is then copied back into p_cmd, and
+ *         Post_ZigbeeCmdProcessing() and the callback are called from the
+ *         task, in the order of submission. p_cmd (and the data it refers
+ *         to) shall remain valid until then.
+ * @param  p_cmd : command (ID, Size, Data), response of the M0 at completion
+ * @param  callback : completion callback (may be NULL)
+ * @param  arg : argument given back to the callback
+ * @retval false if ZIGBEE_CMD_QUEUE_SIZE commands are already pending
+ */
+bool ZIGBEE_CmdTransferAsync(Zigbee_Cmd_Request_t *p_cmd, ZIGBEE_CmdCallback_t callback, void *arg)
+{
+  if (ZigbeeCmdNb >= ZIGBEE_CMD_QUEUE_SIZE)
+  {
+    return false;
+  }
+
+  (void)ZIGBEE_CmdQueue(p_cmd, callback, arg);
+  UTIL_SEQ_SetTask(1U << (uint32_t)CFG_TASK_ZIGBEE_CMD_DONE, CFG_SCH_PRIO_0);
+  return true;
+} /* ZIGBEE_CmdTransferAsync */
+
+/**
+ * @brief  Add a command at the end of the queue.
+ * @param  p_cmd : command
+ * @param  callback : completion callback (NULL for the blocking command)
+ * @param  arg : argument given back to the callback
+ * @retval Queue entry of the command
+ */
+static ZIGBEE_CmdEntry_t * ZIGBEE_CmdQueue(Zigbee_Cmd_Request_t *p_cmd, ZIGBEE_CmdCallback_t callback, void *arg)
+{
+  ZIGBEE_CmdEntry_t *entry;
+
+  entry = &ZigbeeCmdQueue[(ZigbeeCmdHead + ZigbeeCmdNb) % ZIGBEE_CMD_QUEUE_ENTRIES];
+  entry->p_cmd = p_cmd;
+  entry->callback = callback;
+  entry->arg = arg;
+  entry->done = false;
+  ZigbeeCmdNb++;
+  ZigbeeCmdToSend++;
+
+  return entry;
+} /* ZIGBEE_CmdQueue */
+
+/**
+ * @brief  Copy a command or a response (header and Size arguments).
+ * @param  p_dst : destination
+ * @param  p_src : source
+ * @retval None
+ */
+static void ZIGBEE_CmdCopy(Zigbee_Cmd_Request_t *p_dst, const Zigbee_Cmd_Request_t *p_src)
+{
+  uint32_t size = p_src->Size;
+  uint32_t i;
+
+  if (size > OT_CMD_BUFFER_SIZE)
+  {
+    size = OT_CMD_BUFFER_SIZE;
+  }
+
+  p_dst->ID = p_src->ID;
+  p_dst->Size = size;
+  for (i = 0; i < size; i++)
+  {
+    p_dst->Data[i] = p_src->Data[i];
+  }
+} /* ZIGBEE_CmdCopy */
+
+/**
+ * @brief  Send the next queued command when the M0 command buffer is free.
+ * @param  None
+ * @retval None
+ */
+static void ZIGBEE_CmdSendNext(void)
 {
   Zigbee_Cmd_Request_t *cmd_req = (Zigbee_Cmd_Request_t *)p_ZIGBEE_otcmdbuffer->cmdserial.cmd.payload;
+  ZIGBEE_CmdEntry_t *entry;
+
+  if ((p_ZIGBEE_entry_in_flight != NULL) || (ZigbeeCmdToSend == 0U))
+  {
+    return;
+  }
+
+  entry = &ZigbeeCmdQueue[(ZigbeeCmdHead + ZigbeeCmdNb - ZigbeeCmdToSend) % ZIGBEE_CMD_QUEUE_ENTRIES];
+  ZigbeeCmdToSend--;
+  ZIGBEE_CmdCopy(cmd_req, entry->p_cmd);
+  p_ZIGBEE_entry_in_flight = entry;
 
   /* Zigbee OT command cmdcode range 0x280 .. 0x3DF = 352 */
   p_ZIGBEE_otcmdbuffer->cmdserial.cmd.cmdcode = 0x280U;
@@ -681,10 +822,40 @@ void ZIGBEE_CmdTransfer(void)
   p_ZIGBEE_otcmdbuffer->cmdserial.cmd.plen = 8U + (cmd_req->Size * 4U);
 
   TL_ZIGBEE_SendM4RequestToM0();
+} /* ZIGBEE_CmdSendNext */
 
-  /* Wait completion of cmd */
-  Wait_Getting_Ack_From_M0();
-} /* ZIGBEE_CmdTransfer */
+/**
+ * @brief  Task of the asynchronous commands : calls the callbacks of the
+ *         completed ones, in order, then sends the next one.
+ * @param  None
+ * @retval None
+ */
+static void App_Zigbee_ProcessCmdDone(void)
+{
+  ZIGBEE_CmdEntry_t entry;
+
+  while ((ZigbeeCmdNb != 0U) && (ZigbeeCmdQueue[ZigbeeCmdHead].done))
+  {
+    /* Entry released before the callback, which may submit a new command */
+    entry = ZigbeeCmdQueue[ZigbeeCmdHead];
+    ZigbeeCmdHead = (ZigbeeCmdHead + 1U) % ZIGBEE_CMD_QUEUE_ENTRIES;
+    ZigbeeCmdNb--;
+
+    Post_ZigbeeCmdProcessing();
+    if (entry.callback != NULL)
+    {
+      entry.callback(entry.p_cmd, entry.arg);
+    }
+  }
+
+  /* The pending M0 notifications are processed first, as before a stack
+   * request (a blocking transfer issued from them sends the queue) */
+  if ((p_ZIGBEE_entry_in_flight == NULL) && (ZigbeeCmdToSend != 0U))
+  {
+    Pre_ZigbeeCmdProcessing();
+    ZIGBEE_CmdSendNext();
+  }
+} /* App_Zigbee_ProcessCmdDone */
 
 /**
  * @brief  This function is called when the M0+ acknowledge  the fact that it has received a Cmd
@@ -743,6 +914,22 @@ static void Wait_Getting_Ack_From_M0(void)
  */
 static void Receive_Ack_From_M0(void)
 {
+  ZIGBEE_CmdEntry_t *entry = p_ZIGBEE_entry_in_flight;
+
+  /* Response saved with its command : the M0 command buffer is free again */
+  if (entry != NULL)
+  {
+    ZIGBEE_CmdCopy(entry->p_cmd, (Zigbee_Cmd_Request_t *)((TL_EvtPacket_t *)p_ZIGBEE_otcmdbuffer)->evtserial.evt.payload);
+    p_ZIGBEE_entry_in_flight = NULL;
+    entry->done = true;
+
+    /* Callback and next command of the asynchronous ones */
+    if (entry->p_cmd != &ZigbeeCmdSync)
+    {
+      UTIL_SEQ_SetTask(1U << (uint32_t)CFG_TASK_ZIGBEE_CMD_DONE, CFG_SCH_PRIO_0);
+    }
+  }
+
   UTIL_SEQ_SetEvt(EVENT_ACK_FROM_M0_EVT);
 } /* Receive_Ack_From_M0 */
 
@@ -178,6 +178,9 @@ typedef enum
 {
   CFG_TIM_PROC_ID_ISR,
   CFG_TIM_WAIT_BEFORE_READ_ATTR,
+  CFG_TIM_PERSIST_SAVE,
+  CFG_TIM_NVM_TRANSFER,
+  CFG_TIM_FLASH_OPS,
   CFG_TIM_LED_BLINK,
   CFG_TIM_MENU_REFRESH,
 } CFG_TimProcID_t;
@@ -297,6 +300,12 @@ typedef enum
   CFG_TASK_BUTTON_PIR,
   CFG_TASK_RETRY_PROC,
   CFG_TASK_LED_STATUS,
+  CFG_TASK_PERSIST_SAVE,
+  CFG_TASK_NVM_CLEAN,
+  CFG_TASK_FLASH_OPS,
+  CFG_TASK_NVM_TRANSFER,
+  CFG_TASK_NVM_RECORDS,
+  CFG_TASK_ZIGBEE_CMD_DONE,
 #if (CFG_USB_INTERFACE_ENABLE != 0)
   CFG_TASK_VCP_SEND_DATA,
 #endif /* (CFG_USB_INTERFACE_ENABLE != 0) */
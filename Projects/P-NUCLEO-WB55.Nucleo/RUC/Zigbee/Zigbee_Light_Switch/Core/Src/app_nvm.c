@@ -22,6 +22,10 @@
 /* HW dependencies */
 #include "ee.h"
 #include "hw_flash.h"
+#include "flash_driver.h"
+
+/* service dependencies */
+#include "stm32_seq.h"
 
 /* Debug Part */
 #include "stm_logging.h"
@@ -32,6 +36,19 @@
 
 /* Private variables ---------------------------------------------------------*/
 uint32_t persistNumWrites = 0;
+uint32_t persistNumWordsWritten = 0; /* words programmed by the delta saves */
+uint32_t persistNumWordsSkipped = 0; /* words already stored, not programmed */
+uint32_t persistNumFlashBytes = 0;   /* flash bytes programmed by the saves */
+uint32_t persistProgramTime = 0;     /* flash programming time of the saves in us */
+
+/* deferred save of the persistent data */
+static struct ZigBeeT *persist_zb;
+static bool           persist_dirty = false;
+static uint32_t       persist_dirty_tick;
+static uint8_t        TS_ID_PERSIST_SAVE;
+
+/* queued flash operations deferred by a guard window */
+static uint8_t        TS_ID_FLASH_OPS;
 
 /* cache in uninit RAM to store/retrieve persistent data */
 union cache
@@ -41,9 +58,140 @@ union cache
 };
 __attribute__ ((section(".noinit"))) union cache cache_persistent_data;
 
+/* validity of the RAM cache, kept with it over a warm reset */
+struct cache_info
+{
+  uint32_t magic; /* APP_NVM_CACHE_MAGIC when the cache holds the newest snapshot */
+  uint32_t len;   /* image length in bytes (length word included) */
+  uint32_t crc;   /* CRC32 of the image, as in the snapshot header */
+};
+__attribute__ ((section(".noinit"))) static struct cache_info cache_persistent_info;
+
+/* image stored in NVM when the persistent data are compressed */
+static union cache nvm_image;
+
+/* last valid snapshot (A/B) */
+static uint8_t  nvm_slot       = 0U;
+static uint32_t nvm_generation = 0U;
+
+/* binary export / import of the NVM over the trace UART */
+#if (CFG_DEBUG_TRACE == 0)
+#undef  CFG_NVM_TRANSFER
+#define CFG_NVM_TRANSFER  (0U)
+#endif
+
+#if (CFG_NVM_TRANSFER == 0)
+#undef  CFG_NVM_IMPORT
+#define CFG_NVM_IMPORT    (0U)
+#endif
+
+#if (CFG_NVM_TRANSFER != 0)
+#define APP_NVM_FRAME_HDR_SIZE    (6U)
+#define APP_NVM_FRAME_CRC_SIZE    (4U)
+#define APP_NVM_FRAME_MAX_PAYLOAD (4U + APP_NVM_FRAME_DATA_SIZE)
+#define HW_TS_NVM_FRAME_PERIOD    (APP_NVM_FRAME_PERIOD_MS * HW_TS_SERVER_1ms_NB_TICKS)
+#define HW_TS_NVM_RESTART_DELAY   (100U * HW_TS_SERVER_1ms_NB_TICKS)  /* trace output flushed */
+
+typedef enum
+{
+  APP_NVM_TRANSFER_IDLE,
+  APP_NVM_TRANSFER_EXPORT,
+  APP_NVM_TRANSFER_IMPORT,
+  APP_NVM_TRANSFER_IMPORT_DONE,
+  APP_NVM_TRANSFER_RESTART,
+} App_NVM_Transfer_t;
+
+static volatile App_NVM_Transfer_t nvm_transfer_state = APP_NVM_TRANSFER_IDLE;
+static union cache    nvm_transfer;         /* state image exported or imported */
+static const uint8_t *nvm_transfer_src;     /* image exported */
+static uint32_t       nvm_transfer_len;     /* image length in bytes */
+static uint32_t       nvm_transfer_offset;  /* bytes sent or received */
+static uint32_t       nvm_transfer_crc;     /* running CRC32 of the image */
+static uint8_t        nvm_transfer_source;
+static uint8_t        nvm_transfer_seq;
+static uint8_t        nvm_frame[APP_NVM_FRAME_HDR_SIZE + APP_NVM_FRAME_MAX_PAYLOAD + APP_NVM_FRAME_CRC_SIZE];
+static uint8_t        TS_ID_NVM_TRANSFER;
+#endif /* CFG_NVM_TRANSFER */
+
+#if (CFG_NVM_IMPORT != 0)
+#if ((APP_NVM_RX_BUFFER_SIZE & (APP_NVM_RX_BUFFER_SIZE - 1U)) != 0U)
+#error "APP_NVM_RX_BUFFER_SIZE shall be a power of 2"
+#endif
+
+static uint8_t        nvm_rx_buffer[APP_NVM_RX_BUFFER_SIZE];  /* bytes received under interrupt */
+static volatile uint16_t nvm_rx_head;       /* next byte written, by the UART interrupt */
+static volatile uint16_t nvm_rx_tail;       /* next byte read, by the transfer task */
+static volatile bool  nvm_rx_overflow;
+static uint16_t       nvm_rx_index;         /* bytes of the frame received */
+static uint16_t       nvm_rx_len;           /* payload length of the frame received */
+#endif /* CFG_NVM_IMPORT */
+
+/* keyed records of the application modules (application data bank) :
+   header word then two slots of sequence number, payload words and CRC32 */
+#define APP_NVM_RECORD_WORDS(len)         (((uint32_t)(len) + 3U) / 4U)
+#define APP_NVM_RECORD_SLOT_WORDS(len)    (APP_NVM_RECORD_WORDS(len) + 2U)
+#define APP_NVM_RECORD_PLACE_WORDS(len)   (1U + (2U * APP_NVM_RECORD_SLOT_WORDS(len)))
+#define APP_NVM_RECORD_SLOT_ADDR(addr, len, slot) \
+                                          ((uint16_t)((addr) + 1U + ((slot) * APP_NVM_RECORD_SLOT_WORDS(len))))
+#define APP_NVM_RECORD_HDR(id, ver, len)  ((uint32_t)(id) | ((uint32_t)(ver) << 16) | ((uint32_t)(len) << 24))
+#define APP_NVM_RECORD_HDR_ID(hdr)        ((uint16_t)((hdr) & 0xFFFFU))
+#define APP_NVM_RECORD_HDR_LEN(hdr)       ((uint8_t)((hdr) >> 24))
+#define APP_NVM_RECORD_BUF_WORDS          (1U + APP_NVM_RECORD_SLOT_WORDS(APP_NVM_RECORD_MAX_SIZE))
+
+typedef struct
+{
+  void     *data;     /* record data in RAM, owned by the module */
+  uint16_t  id;
+  uint16_t  addr;     /* virtual address of the header word */
+  uint8_t   version;
+  uint8_t   len;      /* in bytes */
+  bool      dirty;
+} App_NVM_Record_t;
+
+static App_NVM_Record_t nvm_records[APP_NVM_RECORD_MAX_NB];
+static uint8_t          nvm_records_nb = 0U;
+
+/* warm reset (RAM kept) and duration of the persistent data load */
+static bool     nvm_warm_reset    = false;
+static bool     persist_load_warm = false;
+static uint32_t persist_load_time = 0U; /* in us */
+
 
 /* Prototype Functions -------------------------------------------------------*/
 void App_Log_NVM(void);
+static bool App_NVM_ReadImage(uint16_t base);
+static bool App_NVM_IsStored(uint16_t base, const uint32_t *image, uint16_t index);
+static bool App_NVM_WriteBlock(uint16_t addr, const uint32_t *data, uint16_t size);
+static uint32_t App_NVM_Crc32(const uint8_t *data, uint32_t len);
+static uint32_t App_NVM_Crc32_Update(uint32_t crc, const uint8_t *data, uint32_t len);
+static uint32_t App_NVM_Compress(const uint8_t *src, uint32_t src_len, uint8_t *dst, uint32_t dst_size);
+static uint32_t App_NVM_Decompress(const uint8_t *src, uint32_t src_len, uint8_t *dst, uint32_t dst_size);
+static void App_Persist_Window_cb(void);
+static void App_Persist_Save_Task(void);
+static void App_NVM_Clean_Task(void);
+static void App_NVM_Clean_Done(void);
+static void App_NVM_Flash_Ops_Timer_cb(void);
+static bool App_NVM_CacheIsValid(uint32_t crc);
+static void App_NVM_CacheSetValid(uint32_t crc);
+static uint32_t App_NVM_GetCycles(void);
+static void App_NVM_Init_Profile_Disp(void);
+static void App_NVM_Stats_Print(const char *fmt, ...);
+static App_NVM_Record_t *App_NVM_Record_Find(uint16_t id);
+static bool App_NVM_Record_Alloc(App_NVM_Record_t *record);
+static bool App_NVM_Record_Write(App_NVM_Record_t *record);
+static bool App_NVM_Record_ReadSlot(const App_NVM_Record_t *record, uint8_t slot, uint32_t *words);
+static int8_t App_NVM_Record_Newest(const App_NVM_Record_t *record, uint32_t words[2][APP_NVM_RECORD_BUF_WORDS]);
+#if (CFG_NVM_TRANSFER != 0)
+static void App_NVM_Export_Start(uint8_t source, const uint8_t *image, uint32_t len);
+static void App_NVM_Frame_Send(uint8_t type, uint16_t len);
+static void App_NVM_Transfer_Task(void);
+static void App_NVM_Transfer_Timer_cb(void);
+#endif /* CFG_NVM_TRANSFER */
+#if (CFG_NVM_IMPORT != 0)
+static void App_NVM_Import_Parse(uint8_t byte);
+static void App_NVM_Frame_Rx(void);
+static void App_NVM_Import_Done(void);
+#endif /* CFG_NVM_IMPORT */
 
 /* Persistent Functions ------------------------------------------------------*/
 
@@ -92,8 +240,16 @@ enum ZbStatusCodeT App_Startup_Persist(struct ZigBeeT *zb)
  */
 bool App_Persist_Load(void)
 {
+  uint32_t start_cycles = App_NVM_GetCycles();
+  bool status;
+
   APP_ZB_DBG("Retrieving persistent data from FLASH");
-  return App_NVM_Read();
+  status = App_NVM_Read();
+
+  persist_load_time = (App_NVM_GetCycles() - start_cycles) / (SystemCoreClock / 1000000U);
+  APP_ZB_DBG("Persistent data loaded from %s in %d us",
+              persist_load_warm ? "RAM cache (warm reset)" : "FLASH", persist_load_time);
+  return status;
 } /* App_Persist_Load */
 
 
@@ -107,6 +263,7 @@ bool App_Persist_Save(struct ZigBeeT *zb)
   uint32_t len;
 
   /* Clear the RAM cache before saving */
+  cache_persistent_info.magic = 0U;
   memset(cache_persistent_data.U8_data, 0x00, ST_PERSIST_MAX_ALLOC_SZ);
 
   /* Call the API stack to get current persistent data */
@@ -138,7 +295,8 @@ bool App_Persist_Save(struct ZigBeeT *zb)
     APP_ZB_DBG("Persistent data Error during FLASHED");
     return false;
   }
-  APP_ZB_DBG("Persistent data FLASHED");
+  APP_ZB_DBG("Persistent data FLASHED (total words written = %d, skipped = %d)",
+              persistNumWordsWritten, persistNumWordsSkipped);
   App_Log_NVM();
 
   return true;
@@ -152,7 +310,12 @@ bool App_Persist_Save(struct ZigBeeT *zb)
  */
 void App_Persist_Delete(void)
 {
+  /* Drop any pending save, it would write back the deleted data */
+  HW_TS_Stop(TS_ID_PERSIST_SAVE);
+  persist_dirty = false;
+
   /* Clear RAM cache */
+  cache_persistent_info.magic = 0U;
   memset(cache_persistent_data.U8_data, 0x00, ST_PERSIST_MAX_ALLOC_SZ);
   APP_ZB_DBG("Persistent Data RAM cache cleared");
   App_NVM_Erase();
@@ -196,8 +359,48 @@ void App_Persist_Completed_cb(enum ZbStatusCodeT status,void *arg)
 void App_Persist_Notify_cb(struct ZigBeeT *zb, void *arg)
 {
   APP_ZB_DBG("Notification to save persistent data requested from stack");
+  persist_zb = zb;
+
+  if (!persist_dirty)
+  {
+    /* First notification: the save is done at the end of the window */
+    persist_dirty = true;
+    persist_dirty_tick = HAL_GetTick();
+    HW_TS_Start(TS_ID_PERSIST_SAVE, HW_TS_PERSIST_SAVE_WINDOW);
+  }
+  else if ((HAL_GetTick() - persist_dirty_tick + CFG_PERSIST_SAVE_WINDOW_MS) <= CFG_PERSIST_SAVE_MAX_DELAY_MS)
+  {
+    /* Following notifications postpone the save, within the max delay */
+    HW_TS_Start(TS_ID_PERSIST_SAVE, HW_TS_PERSIST_SAVE_WINDOW);
+  }
+} /* App_Persist_Notify_cb */
+
+/**
+ * @brief  Save now the persistent data if a notification is pending
+ * @param  None
+ * @retval None
+ */
+void App_Persist_Flush(void)
+{
+  if (!persist_dirty)
+  {
+    return;
+  }
+
+#if (CFG_NVM_TRANSFER != 0)
+  /* Keep the NVM unchanged during a transfer : saved at its end */
+  if (nvm_transfer_state != APP_NVM_TRANSFER_IDLE)
+  {
+    return;
+  }
+#endif /* CFG_NVM_TRANSFER */
+
+  HW_TS_Stop(TS_ID_PERSIST_SAVE);
+  persist_dirty = false;
+
+  APP_ZB_DBG("Saving persistent data (%d ms after notification)", HAL_GetTick() - persist_dirty_tick);
   /* Save the persistent data */
-  if (App_Persist_Save(zb) == true)
+  if (App_Persist_Save(persist_zb) == true)
   {
     APP_ZB_DBG("Data FLASHED");
   }
@@ -205,20 +408,74 @@ void App_Persist_Notify_cb(struct ZigBeeT *zb, void *arg)
   {
     APP_ZB_DBG("Error during Data FLASHED");
   }
-} /* App_Persist_Notify_cb */
+} /* App_Persist_Flush */
+
+/**
+ * @brief  End of the persistence save window (called under timer IRQ)
+ * @param  None
+ * @retval None
+ */
+static void App_Persist_Window_cb(void)
+{
+  /* The save is done in task context, out of the interrupt */
+  UTIL_SEQ_SetTask(1U << CFG_TASK_PERSIST_SAVE, CFG_SCH_PRIO_1);
+} /* App_Persist_Window_cb */
+
+/**
+ * @brief  Task of the coalesced save: postponed while a guard window is open
+ *         (radio transmission to come), up to CFG_FD_GUARD_MAX_DEFER_MS
+ *         after the max delay of the save
+ * @param  None
+ * @retval None
+ */
+static void App_Persist_Save_Task(void)
+{
+  uint32_t guard_left;
+  uint32_t elapsed;
+
+  if (!persist_dirty)
+  {
+    return;
+  }
+
+  guard_left = FD_GetGuardTimeLeft();
+  elapsed = HAL_GetTick() - persist_dirty_tick;
+  if ((guard_left != 0U) && (elapsed < (CFG_PERSIST_SAVE_MAX_DELAY_MS + CFG_FD_GUARD_MAX_DEFER_MS)))
+  {
+    if (guard_left > (CFG_PERSIST_SAVE_MAX_DELAY_MS + CFG_FD_GUARD_MAX_DEFER_MS - elapsed))
+    {
+      guard_left = CFG_PERSIST_SAVE_MAX_DELAY_MS + CFG_FD_GUARD_MAX_DEFER_MS - elapsed;
+    }
+    HW_TS_Start(TS_ID_PERSIST_SAVE, guard_left * HW_TS_SERVER_1ms_NB_TICKS);
+    return;
+  }
+
+  App_Persist_Flush();
+} /* App_Persist_Save_Task */
 
 
 /* Exported NVM Functions ----------------------------------------------------*/
 /**
  * @brief  Init the NVM
- * @param  None
+ * @param  reset_flags reset cause read at startup (RCC_CSR_xxxRSTF)
  * @retval None
  */
-void App_NVM_Init(void)
+void App_NVM_Init(uint32_t reset_flags)
 {
   int eeprom_init_status;
 
+#if (CFG_PERSIST_WARM_BOOT != 0)
+  /* RAM content is kept by a software or watchdog reset, not by a power-on reset */
+  nvm_warm_reset = ((reset_flags & (RCC_CSR_SFTRSTF | RCC_CSR_IWDGRSTF | RCC_CSR_WWDGRSTF)) != 0U) &&
+                   ((reset_flags & RCC_CSR_BORRSTF) == 0U);
+  APP_ZB_DBG("Reset cause : %s", nvm_warm_reset ? "warm (RAM kept)" : "cold");
+#else
+  (void)reset_flags;
+#endif /* CFG_PERSIST_WARM_BOOT */
+
   APP_ZB_DBG("Flash starting address = %x", HW_FLASH_ADDRESS + CFG_NVM_BASE_ADDRESS);
+  /* Cycle counter enabled for the EE_Init profile */
+  (void)App_NVM_GetCycles();
   eeprom_init_status = EE_Init(0, HW_FLASH_ADDRESS + CFG_NVM_BASE_ADDRESS);
 
   if (eeprom_init_status != EE_OK)
@@ -227,39 +484,144 @@ void App_NVM_Init(void)
     eeprom_init_status = EE_Init(1, HW_FLASH_ADDRESS + CFG_NVM_BASE_ADDRESS);
   }
   APP_ZB_DBG("EE_init status = %d", eeprom_init_status);
+  App_NVM_Init_Profile_Disp();
+
+  /* Deferred write of the dirty application records */
+  UTIL_SEQ_RegTask(1U << CFG_TASK_NVM_RECORDS, UTIL_SEQ_RFU, App_NVM_Record_Flush);
+
+  /* Application outputs back from the application data, before the stack start-up */
+  App_Core_Fast_Restore();
+
+  /* Deferred save of the persistent data notified by the stack */
+  HW_TS_Create(CFG_TIM_PERSIST_SAVE, &TS_ID_PERSIST_SAVE, hw_ts_SingleShot, App_Persist_Window_cb);
+  UTIL_SEQ_RegTask(1U << CFG_TASK_PERSIST_SAVE, UTIL_SEQ_RFU, App_Persist_Save_Task);
+
+  /* Background erase of the obsolete flash pages, through the flash operation queue */
+  UTIL_SEQ_RegTask(1U << CFG_TASK_NVM_CLEAN, UTIL_SEQ_RFU, App_NVM_Clean_Task);
+  UTIL_SEQ_RegTask(1U << CFG_TASK_FLASH_OPS, UTIL_SEQ_RFU, FD_ProcessQueue);
+  HW_TS_Create(CFG_TIM_FLASH_OPS, &TS_ID_FLASH_OPS, hw_ts_SingleShot, App_NVM_Flash_Ops_Timer_cb);
+
+#if (CFG_NVM_TRANSFER != 0)
+  /* Binary export / import of the NVM */
+  HW_TS_Create(CFG_TIM_NVM_TRANSFER, &TS_ID_NVM_TRANSFER, hw_ts_SingleShot, App_NVM_Transfer_Timer_cb);
+  UTIL_SEQ_RegTask(1U << CFG_TASK_NVM_TRANSFER, UTIL_SEQ_RFU, App_NVM_Transfer_Task);
+#endif /* CFG_NVM_TRANSFER */
+
+  /* Prepare the standby pools before the next pool transfer */
+  UTIL_SEQ_SetTask(1U << CFG_TASK_NVM_CLEAN, CFG_SCH_PRIO_1);
 
 } /* App_NVM_Init */
 
 /**
- * @brief  Read the persistent data from NVM
+ * @brief  Read the persistent data from NVM : newest valid snapshot
  * @param  None
  * @retval true if success , false if failed
  */
 bool App_NVM_Read(void)
+{
+  uint32_t header[2][APP_NVM_SNAPSHOT_HDR_WORDS];
+  bool     valid[2];
+  bool     status = false;
+  uint8_t  slot;
+  uint8_t  i;
+
+  HAL_FLASH_Unlock();
+  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_PGSERR | FLASH_FLAG_WRPERR | FLASH_FLAG_OPTVERR);
+
+  /* Read the header of both snapshots */
+  for (i = 0; i < 2U; i++)
+  {
+    valid[i] = (EE_ReadBlock(0, APP_NVM_SNAPSHOT_ADDR(i), header[i], APP_NVM_SNAPSHOT_HDR_WORDS) == EE_OK) &&
+               (header[i][0] == APP_NVM_SNAPSHOT_MAGIC);
+  }
+
+  /* Try the newest snapshot first, then the previous one */
+  slot = (valid[1] && (!valid[0] || ((int32_t)(header[1][1] - header[0][1]) > 0))) ? 1U : 0U;
+
+  /* Warm reset : the RAM cache may still hold the newest snapshot */
+  persist_load_warm = valid[slot] && App_NVM_CacheIsValid(header[slot][2]);
+  if (persist_load_warm)
+  {
+    nvm_slot       = slot;
+    nvm_generation = header[slot][1];
+    status         = true;
+    APP_ZB_DBG("Persistent data kept in RAM cache, snapshot %c (generation %d)", 'A' + slot, nvm_generation);
+  }
+  else
+  {
+    /* The cache is overwritten by the read from flash */
+    cache_persistent_info.magic = 0U;
+  }
+
+  for (i = 0; (i < 2U) && !status; i++, slot ^= 1U)
+  {
+    if (!valid[slot])
+    {
+      continue;
+    }
+
+    if (App_NVM_ReadImage(APP_NVM_SNAPSHOT_ADDR(slot) + APP_NVM_SNAPSHOT_HDR_WORDS) &&
+        (App_NVM_Crc32(cache_persistent_data.U8_data, ST_PERSIST_FLASH_DATA_OFFSET + cache_persistent_data.U32_data[0]) == header[slot][2]))
+    {
+      nvm_slot       = slot;
+      nvm_generation = header[slot][1];
+      status         = true;
+      App_NVM_CacheSetValid(header[slot][2]);
+      APP_ZB_DBG("Persistent data restored from snapshot %c (generation %d)", 'A' + slot, nvm_generation);
+    }
+    else
+    {
+      APP_ZB_DBG("Snapshot %c corrupted (generation %d)", 'A' + slot, header[slot][1]);
+    }
+  }
+
+  HAL_FLASH_Lock();
+  return status;
+} /* App_NVM_Read */
+
+/**
+ * @brief  Read a persistent data image from NVM to the RAM cache
+ * @param  base virtual address of the image (length word)
+ * @retval true if success , false if failed
+ */
+static bool App_NVM_ReadImage(uint16_t base)
 {
   uint16_t num_words = 0;
   bool status        = true;
   int ee_status      = 0;
-  
-  HAL_FLASH_Unlock();
-  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_PGSERR | FLASH_FLAG_WRPERR | FLASH_FLAG_OPTVERR);
+  uint32_t zlen      = 0;
+  uint32_t start_tick = HAL_GetTick();
 
   /* Read the data length from cache */
-  ee_status = EE_Read(0, ZIGBEE_DB_START_ADDR, &cache_persistent_data.U32_data[0]);
+  ee_status = EE_Read(0, base, &cache_persistent_data.U32_data[0]);
   if (ee_status != EE_OK)
   {
     APP_ZB_DBG("Read -> persistent data length not found ERASE to be done - Read Stopped");
     status = false;
   }
+  /* Compressed image : read the compressed length */
+  else if ((cache_persistent_data.U32_data[0] & APP_NVM_LEN_COMPRESSED) != 0U)
+  {
+    cache_persistent_data.U32_data[0] &= ~APP_NVM_LEN_COMPRESSED;
+    ee_status = EE_Read(0, base + 1U, &zlen);
+    if ((ee_status != EE_OK) || (zlen == 0U) ||
+        (zlen > (ST_PERSIST_MAX_ALLOC_SZ - APP_NVM_ZIMAGE_OFFSET)))
+    {
+      APP_ZB_DBG("No data or too large compressed length : %d", zlen);
+      status = false;
+    }
+  }
+
   /* Check length is not too big nor zero */
-  else if ((cache_persistent_data.U32_data[0] == 0) ||
-           (cache_persistent_data.U32_data[0] > ST_PERSIST_MAX_ALLOC_SZ))
+  if (status &&
+      ((cache_persistent_data.U32_data[0] == 0) ||
+       (cache_persistent_data.U32_data[0] > (ST_PERSIST_MAX_ALLOC_SZ - ST_PERSIST_FLASH_DATA_OFFSET))))
   {
     APP_ZB_DBG("No data or too large length : %d", cache_persistent_data.U32_data[0]);
     status = false;
   }
-  /* Length is within range */
-  else
+  /* Length is within range, uncompressed image */
+  else if (status && (zlen == 0U))
   {
     /* Adjust the length to be U32 aligned */
     num_words = (uint16_t)(cache_persistent_data.U32_data[0] / 4);
@@ -268,27 +630,102 @@ bool App_NVM_Read(void)
       num_words++;
     }
 
-    /* copy the read data from Flash to cache including length */
-    for (uint16_t local_length = 1; local_length <= num_words; local_length++)
+    /* copy the read data from Flash to cache after the length */
+    ee_status = EE_ReadBlock(0, base + 1U, &cache_persistent_data.U32_data[1], num_words);
+    if (ee_status != EE_OK)
     {
-      /* read data from first data in U32 unit */
-      ee_status = EE_Read(0, local_length + ZIGBEE_DB_START_ADDR, &cache_persistent_data.U32_data[local_length]);
-      if (ee_status != EE_OK)
-      {
-        APP_ZB_DBG("Read not found leaving");
-        status = false;
-        break;
-      }
+      APP_ZB_DBG("Read not found leaving");
+      status = false;
+    }
+  }
+  /* Length is within range, compressed image */
+  else if (status)
+  {
+    num_words = (uint16_t)((zlen + 3U) / 4U);
+
+    /* read the compressed data then expand them in cache after the length */
+    ee_status = EE_ReadBlock(0, base + (APP_NVM_ZIMAGE_OFFSET / 4U),
+                             &nvm_image.U32_data[APP_NVM_ZIMAGE_OFFSET / 4U], num_words);
+    if (ee_status != EE_OK)
+    {
+      APP_ZB_DBG("Read not found leaving");
+      status = false;
+    }
+    else if (App_NVM_Decompress(&nvm_image.U8_data[APP_NVM_ZIMAGE_OFFSET], zlen,
+                                &cache_persistent_data.U8_data[ST_PERSIST_FLASH_DATA_OFFSET],
+                                ST_PERSIST_MAX_ALLOC_SZ - ST_PERSIST_FLASH_DATA_OFFSET)
+             != cache_persistent_data.U32_data[0])
+    {
+      APP_ZB_DBG("Read -> corrupted compressed data");
+      status = false;
     }
   }
 
-  HAL_FLASH_Lock();
   if (status)
   {
-    APP_ZB_DBG("Read persistent data length = %d", cache_persistent_data.U32_data[0]);
+    APP_ZB_DBG("Read persistent data length = %d (%d words in %d ms)",
+                cache_persistent_data.U32_data[0], num_words + ((zlen != 0U) ? 2U : 1U), HAL_GetTick() - start_tick);
   }
   return status;
-} /* App_NVM_Read */
+} /* App_NVM_ReadImage */
+
+/**
+ * @brief  Check that the RAM cache kept over a warm reset holds a snapshot
+ * @param  crc CRC32 of the snapshot in NVM
+ * @retval true if the cache holds this snapshot, false otherwise
+ */
+static bool App_NVM_CacheIsValid(uint32_t crc)
+{
+#if (CFG_PERSIST_WARM_BOOT != 0)
+  uint32_t len = cache_persistent_data.U32_data[0];
+
+  /* RAM is not kept by a cold reset : the cache info is garbage */
+  if (!nvm_warm_reset || (cache_persistent_info.magic != APP_NVM_CACHE_MAGIC) ||
+      (cache_persistent_info.crc != crc))
+  {
+    return false;
+  }
+
+  /* Same image length, then same content */
+  if ((len == 0U) || (len > (ST_PERSIST_MAX_ALLOC_SZ - ST_PERSIST_FLASH_DATA_OFFSET)) ||
+      (cache_persistent_info.len != (ST_PERSIST_FLASH_DATA_OFFSET + len)))
+  {
+    return false;
+  }
+  return (App_NVM_Crc32(cache_persistent_data.U8_data, ST_PERSIST_FLASH_DATA_OFFSET + len) == crc);
+#else
+  (void)crc;
+  return false;
+#endif /* CFG_PERSIST_WARM_BOOT */
+} /* App_NVM_CacheIsValid */
+
+/**
+ * @brief  Mark the RAM cache as holding the snapshot stored in NVM
+ * @param  crc CRC32 of the snapshot
+ * @retval None
+ */
+static void App_NVM_CacheSetValid(uint32_t crc)
+{
+  cache_persistent_info.len   = ST_PERSIST_FLASH_DATA_OFFSET + cache_persistent_data.U32_data[0];
+  cache_persistent_info.crc   = crc;
+  cache_persistent_info.magic = APP_NVM_CACHE_MAGIC;
+} /* App_NVM_CacheSetValid */
+
+/**
+ * @brief  Get the DWT cycle counter, enabled on first use (as by the flash driver)
+ * @param  None
+ * @retval cycle counter
+ */
+static uint32_t App_NVM_GetCycles(void)
+{
+  if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0U)
+  {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0U;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+  return DWT->CYCCNT;
+} /* App_NVM_GetCycles */
 
 
 /**
@@ -298,66 +735,1279 @@ bool App_NVM_Read(void)
  */
 bool App_NVM_Write(void)
 {
-  int ee_status = 0;
-
+  const uint32_t *image = cache_persistent_data.U32_data;
+  uint32_t image_len;
+  uint32_t header[APP_NVM_SNAPSHOT_HDR_WORDS];
+  uint8_t  slot = nvm_slot ^ 1U;
+  uint16_t base = APP_NVM_SNAPSHOT_ADDR(slot) + APP_NVM_SNAPSHOT_HDR_WORDS;
   uint16_t num_words;
-  uint16_t local_current_size;
+  uint16_t index;
+  uint16_t run_start;
+  uint16_t run_end;
+  uint16_t nb_written = 0;
+  uint32_t start_tick = HAL_GetTick();
+  FD_Statistics_t fd_start;
+  FD_Statistics_t fd_end;
 
-  num_words = 1U; /* 1 words for the length */
-  num_words += (uint16_t)(cache_persistent_data.U32_data[0] / 4);
+  FD_GetStatistics(&fd_start);
 
-  /* Adjust the length to be U32 aligned */
-  if (cache_persistent_data.U32_data[0] % 4 != 0)
-  {
-    num_words++;
-  }
+  /* Image to store : length word then data */
+  image_len = ST_PERSIST_FLASH_DATA_OFFSET + cache_persistent_data.U32_data[0];
 
-  // save data in flash
-  for (local_current_size = 0; local_current_size < num_words; local_current_size++)
+  /* Snapshot header, written once the data are stored */
+  header[0] = APP_NVM_SNAPSHOT_MAGIC;
+  header[1] = nvm_generation + 1U;
+  header[2] = App_NVM_Crc32(cache_persistent_data.U8_data, image_len);
+
+#if (CFG_PERSIST_COMPRESS != 0)
   {
-    ee_status = EE_Write(0, (uint16_t)local_current_size + ZIGBEE_DB_START_ADDR, cache_persistent_data.U32_data[local_current_size]);
-    if (ee_status != EE_OK)
+    uint32_t zlen;
+
+    /* Store the compressed image if smaller */
+    zlen = App_NVM_Compress(&cache_persistent_data.U8_data[ST_PERSIST_FLASH_DATA_OFFSET], cache_persistent_data.U32_data[0],
+                            &nvm_image.U8_data[APP_NVM_ZIMAGE_OFFSET], ST_PERSIST_MAX_ALLOC_SZ - APP_NVM_ZIMAGE_OFFSET);
+    if ((zlen != 0U) && ((APP_NVM_ZIMAGE_OFFSET + zlen) < image_len))
     {
-      if (ee_status == EE_CLEAN_NEEDED) /* Shall not be there if CFG_EE_AUTO_CLEAN = 1*/
+      APP_ZB_DBG("Persistent data compressed : %d -> %d bytes", image_len, APP_NVM_ZIMAGE_OFFSET + zlen);
+      nvm_image.U32_data[0] = cache_persistent_data.U32_data[0] | APP_NVM_LEN_COMPRESSED;
+      nvm_image.U32_data[1] = zlen;
+      image_len = APP_NVM_ZIMAGE_OFFSET + zlen;
+      image = nvm_image.U32_data;
+
+      /* Clear the padding bytes of the last word */
+      while ((image_len % 4U) != 0U)
       {
-        APP_ZB_DBG("CLEAN NEEDED, CLEANING");
-        EE_Clean(0, 0);
+        nvm_image.U8_data[image_len++] = 0U;
       }
-      else
+    }
+  }
+#endif /* CFG_PERSIST_COMPRESS */
+
+  /* Adjust the length to be U32 aligned */
+  num_words = (uint16_t)((image_len + 3U) / 4U);
+
+  // save in the other snapshot only the words changed since its last save, length included
+  for (index = 0; index < num_words; index = run_end)
+  {
+    /* Skip the words already stored with the same value */
+    run_start = index;
+    while ((run_start < num_words) && App_NVM_IsStored(base, image, run_start))
+    {
+      run_start++;
+    }
+
+    /* Then look for the end of the changed words */
+    run_end = run_start;
+    while ((run_end < num_words) && !App_NVM_IsStored(base, image, run_end))
+    {
+      run_end++;
+    }
+
+    if (run_end > run_start)
+    {
+      if (!App_NVM_WriteBlock(base + run_start, &image[run_start], run_end - run_start))
       {
-        /* Failed to write , an Erase shall be done */
-        APP_ZB_DBG("App_NVM_Write failed @ %d status %d", local_current_size, ee_status);
-        break;
+        return false;
       }
+      nb_written += run_end - run_start;
     }
   }
 
-  if (ee_status != EE_OK)
+  /* Commit the snapshot : a save interrupted before this point leaves
+     the previous snapshot as the newest valid one */
+  if (!App_NVM_WriteBlock(APP_NVM_SNAPSHOT_ADDR(slot), header, APP_NVM_SNAPSHOT_HDR_WORDS))
   {
-    APP_ZB_DBG("Write Stopped, need a FLASH ERASE");
     return false;
   }
+  nvm_slot       = slot;
+  nvm_generation = header[1];
+  App_NVM_CacheSetValid(header[2]);
 
-  APP_ZB_DBG("Written persistent data length = %d", cache_persistent_data.U32_data[0]);
+  persistNumWordsWritten += nb_written;
+  persistNumWordsSkipped += num_words - nb_written;
+
+  FD_GetStatistics(&fd_end);
+  persistNumFlashBytes += (fd_end.NbrOfWrites - fd_start.NbrOfWrites) * 8U;
+  persistProgramTime   += fd_end.WriteTimeTotal - fd_start.WriteTimeTotal;
+  APP_ZB_DBG("Written persistent data length = %d in snapshot %c generation %d (%d/%d words in %d ms)",
+              cache_persistent_data.U32_data[0], 'A' + slot, nvm_generation, nb_written, num_words, HAL_GetTick() - start_tick);
+  APP_ZB_DBG("Flash operations : %d writes (%d bytes in %d us), %d erases, %d not executed",
+              fd_end.NbrOfWrites - fd_start.NbrOfWrites, (fd_end.NbrOfWrites - fd_start.NbrOfWrites) * 8U,
+              fd_end.WriteTimeTotal - fd_start.WriteTimeTotal, fd_end.NbrOfErases - fd_start.NbrOfErases,
+              fd_end.NbrOfNotExecuted - fd_start.NbrOfNotExecuted);
   return true;
 
 } /* App_NVM_Write */
 
 /**
- * @brief  Erase the NVM
+ * @brief  Prepare one page of the standby pools (erase or blank check),
+ *         reschedule until both standby pools are ready
  * @param  None
  * @retval None
  */
-void App_NVM_Erase(void)
+static void App_NVM_Clean_Task(void)
 {
-  int ee_status = 0;
+  int ee_status;
+  EE_Status_t ee_info;
 
-  ee_status = EE_Init(1, HW_FLASH_ADDRESS + CFG_NVM_BASE_ADDRESS); /* Erase Flash */
-  if (ee_status != EE_OK)
+  /* Clean the stack bank first, then the application data bank */
+  ee_status = EE_CleanPageAsync(0, App_NVM_Clean_Done);
+  if (ee_status == EE_OK)
   {
-    APP_ZB_DBG("Erase STOPPED, need a FLASH ERASE");
+    ee_status = EE_CleanPageAsync(APP_NVM_DATA_BANK, App_NVM_Clean_Done);
   }
-} /* App_NVM_Erase */
+
+  if (ee_status == EE_CLEAN_NEEDED)
+  {
+    UTIL_SEQ_SetTask(1U << CFG_TASK_NVM_CLEAN, CFG_SCH_PRIO_1);
+  }
+  else if (ee_status == EE_CLEAN_QUEUED)
+  {
+    /* Run again by App_NVM_Clean_Done once the page is erased */
+  }
+  else if (ee_status != EE_OK)
+  {
+    APP_ZB_DBG("NVM clean failed status %d", ee_status);
+  }
+  else
+  {
+    EE_GetStatus(0, &ee_info);
+    APP_ZB_DBG("NVM standby pools ready (%d pool transfers had to prepare them)", ee_info.nb_sync_clean);
+  }
+} /* App_NVM_Clean_Task */
+
+/**
+ * @brief  End of a page erase queued by the clean task : go on with the clean
+ * @param  None
+ * @retval None
+ */
+static void App_NVM_Clean_Done(void)
+{
+  UTIL_SEQ_SetTask(1U << CFG_TASK_NVM_CLEAN, CFG_SCH_PRIO_1);
+} /* App_NVM_Clean_Done */
+
+/**
+ * @brief  Flash operations queued to the flash driver : schedule their processing
+ * @param  None
+ * @retval None
+ */
+void FD_QueueNotify(void)
+{
+  UTIL_SEQ_SetTask(1U << CFG_TASK_FLASH_OPS, CFG_SCH_PRIO_1);
+} /* FD_QueueNotify */
+
+/**
+ * @brief  Queued flash operations deferred by a guard window : processed at its end
+ * @param  DelayMs delay before the end of the guard window in ms
+ * @retval None
+ */
+void FD_QueueDeferred(uint32_t DelayMs)
+{
+  HW_TS_Start(TS_ID_FLASH_OPS, DelayMs * HW_TS_SERVER_1ms_NB_TICKS);
+} /* FD_QueueDeferred */
+
+/**
+ * @brief  End of the flash guard window (called under timer IRQ)
+ * @param  None
+ * @retval None
+ */
+static void App_NVM_Flash_Ops_Timer_cb(void)
+{
+  UTIL_SEQ_SetTask(1U << CFG_TASK_FLASH_OPS, CFG_SCH_PRIO_1);
+} /* App_NVM_Flash_Ops_Timer_cb */
+
+/**
+ * @brief  Keep the background flash operations away from a radio transmission
+ *         to come (command or report requested to the stack)
+ * @param  None
+ * @retval None
+ */
+void App_NVM_Tx_Guard(void)
+{
+  FD_DeferOperations(APP_NVM_TX_GUARD_MS);
+} /* App_NVM_Tx_Guard */
+
+/**
+ * @brief  Prepare the NVM for a software reset : pending persistence save,
+ *         application records and flash operations done, then EE state
+ *         marked as cleanly shut down so that the next EE_Init skips the
+ *         recovery from flash. Shall be called before any NVIC_SystemReset()
+ * @param  None
+ * @retval None
+ */
+void App_NVM_Shutdown(void)
+{
+  /* Coalesced save not done yet (nothing after App_Persist_Delete or an import) */
+  App_Persist_Flush();
+  App_NVM_Record_Flush();
+  (void)FD_FlushQueue();
+  EE_Shutdown();
+} /* App_NVM_Shutdown */
+
+/**
+ * @brief  Check if a word of the RAM cache is already stored in NVM
+ * @param  index word index in the RAM cache
+ * @retval true if the NVM holds the same value , false otherwise
+ */
+static bool App_NVM_IsStored(uint16_t base, const uint32_t *image, uint16_t index)
+{
+  uint32_t stored_word;
+
+  if (EE_Read(0, base + index, &stored_word) != EE_OK)
+  {
+    return false;
+  }
+
+  return (stored_word == image[index]);
+} /* App_NVM_IsStored */
+
+/**
+ * @brief  Write consecutive words of the persistent data in NVM
+ * @param  addr virtual address of the first word
+ * @param  data words to write
+ * @param  size number of words
+ * @retval true if success , false if failed
+ */
+static bool App_NVM_WriteBlock(uint16_t addr, const uint32_t *data, uint16_t size)
+{
+  int ee_status;
+
+  ee_status = EE_WriteBlock(0, addr, data, size);
+  if (ee_status == EE_CLEAN_NEEDED)
+  {
+    /* The obsolete pages are erased later, in background */
+    UTIL_SEQ_SetTask(1U << CFG_TASK_NVM_CLEAN, CFG_SCH_PRIO_1);
+  }
+  else if (ee_status != EE_OK)
+  {
+    /* Failed to write , an Erase shall be done */
+    APP_ZB_DBG("App_NVM_Write failed @ %d status %d", addr, ee_status);
+    APP_ZB_DBG("Write Stopped, need a FLASH ERASE");
+    return false;
+  }
+
+  return true;
+} /* App_NVM_WriteBlock */
+
+/**
+ * @brief  Compute the CRC32 (IEEE 802.3) of the persistent data
+ * @param  data bytes to check
+ * @param  len number of bytes
+ * @retval CRC32 value
+ */
+static uint32_t App_NVM_Crc32(const uint8_t *data, uint32_t len)
+{
+  return ~App_NVM_Crc32_Update(0xFFFFFFFFU, data, len);
+} /* App_NVM_Crc32 */
+
+/**
+ * @brief  Update a running CRC32 (start with 0xFFFFFFFF, invert at the end)
+ * @param  crc running CRC32
+ * @param  data bytes to add
+ * @param  len number of bytes
+ * @retval running CRC32
+ */
+static uint32_t App_NVM_Crc32_Update(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+  static const uint32_t crc_table[16] =
+  {
+    0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU, 0x76DC4190U, 0x6B6B51F4U, 0x4DB26158U, 0x5005713CU,
+    0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU, 0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU
+  };
+
+  while (len-- > 0U)
+  {
+    crc ^= *data++;
+    crc = (crc >> 4) ^ crc_table[crc & 0x0FU];
+    crc = (crc >> 4) ^ crc_table[crc & 0x0FU];
+  }
+
+  return crc;
+} /* App_NVM_Crc32_Update */
+
+/**
+ * @brief  Compress the persistent data (run length encoding of the zero bytes)
+ *         Each block starts with a control byte :
+ *         - 0x80 | (n-1) : n zero bytes (n = 1..128)
+ *         - (n-1)        : n literal bytes follow (n = 1..128)
+ * @param  src data to compress
+ * @param  src_len length of the data in bytes
+ * @param  dst compressed data
+ * @param  dst_size size of the dst buffer in bytes
+ * @retval length of the compressed data in bytes, 0 if dst is too small
+ */
+static uint32_t App_NVM_Compress(const uint8_t *src, uint32_t src_len, uint8_t *dst, uint32_t dst_size)
+{
+  uint32_t in  = 0;
+  uint32_t out = 0;
+  uint32_t run;
+
+  while (in < src_len)
+  {
+    /* Zero run (at least 2 bytes, a single zero is kept as literal) */
+    for (run = 0; ((in + run) < src_len) && (src[in + run] == 0U) && (run < 128U); run++);
+    if ((run >= 2U) || ((in + run) == src_len))
+    {
+      if (out >= dst_size)
+      {
+        return 0U;
+      }
+      dst[out++] = (uint8_t)(0x80U | (run - 1U));
+      in += run;
+      continue;
+    }
+
+    /* Literal run, up to the next zero run */
+    for (run = 1; ((in + run) < src_len) && (run < 128U); run++)
+    {
+      if ((src[in + run] == 0U) && (((in + run + 1U) == src_len) || (src[in + run + 1U] == 0U)))
+      {
+        break;
+      }
+    }
+    if ((out + 1U + run) > dst_size)
+    {
+      return 0U;
+    }
+    dst[out++] = (uint8_t)(run - 1U);
+    memcpy(&dst[out], &src[in], run);
+    out += run;
+    in  += run;
+  }
+
+  return out;
+} /* App_NVM_Compress */
+
+/**
+ * @brief  Expand the persistent data compressed by App_NVM_Compress
+ * @param  src compressed data
+ * @param  src_len length of the compressed data in bytes
+ * @param  dst expanded data
+ * @param  dst_size size of the dst buffer in bytes
+ * @retval length of the expanded data in bytes, 0 if the data are corrupted
+ */
+static uint32_t App_NVM_Decompress(const uint8_t *src, uint32_t src_len, uint8_t *dst, uint32_t dst_size)
+{
+  uint32_t in  = 0;
+  uint32_t out = 0;
+  uint32_t run;
+
+  while (in < src_len)
+  {
+    run = (src[in] & 0x7FU) + 1U;
+    if ((out + run) > dst_size)
+    {
+      return 0U;
+    }
+
+    if ((src[in++] & 0x80U) != 0U)
+    {
+      memset(&dst[out], 0x00, run);
+    }
+    else
+    {
+      if ((in + run) > src_len)
+      {
+        return 0U;
+      }
+      memcpy(&dst[out], &src[in], run);
+      in += run;
+    }
+    out += run;
+  }
+
+  return out;
+} /* App_NVM_Decompress */
+
+/**
+ * @brief  Erase the NVM
+ * @param  None
+ * @retval None
+ */
+void App_NVM_Erase(void)
+{
+  int ee_status = 0;
+  uint8_t index;
+
+  ee_status = EE_Init(1, HW_FLASH_ADDRESS + CFG_NVM_BASE_ADDRESS); /* Erase Flash */
+  cache_persistent_info.magic = 0U;
+  nvm_slot       = 0U;
+  nvm_generation = 0U;
+  if (ee_status != EE_OK)
+  {
+    APP_ZB_DBG("Erase STOPPED, need a FLASH ERASE");
+  }
+  else
+  {
+    /* Keep the registered records allocated, without their data */
+    for (index = 0U; index < nvm_records_nb; index++)
+    {
+      (void)App_NVM_Record_Alloc(&nvm_records[index]);
+    }
+
+
+    /* Check the standby pools in background */
+    UTIL_SEQ_SetTask(1U << CFG_TASK_NVM_CLEAN, CFG_SCH_PRIO_1);
+  }
+} /* App_NVM_Erase */
+
+/* Exported Application data Functions ---------------------------------------*/
+/**
+ * @brief  Read an application data from NVM (application data bank)
+ * @param  addr virtual address of the data
+ * @param  data pointer to the read data
+ * @retval true if found , false otherwise
+ */
+bool App_NVM_Data_Read(uint16_t addr, uint32_t *data)
+{
+  return (EE_Read(APP_NVM_DATA_BANK, addr, data) == EE_OK);
+} /* App_NVM_Data_Read */
+
+/**
+ * @brief  Write an application data in NVM (application data bank)
+ *         The flash is written only if the value has changed
+ * @param  addr virtual address of the data
+ * @param  data value to write
+ * @retval true if success , false if failed
+ */
+bool App_NVM_Data_Write(uint16_t addr, uint32_t data)
+{
+  uint32_t stored_data;
+  int ee_status;
+
+  if ((EE_Read(APP_NVM_DATA_BANK, addr, &stored_data) == EE_OK) && (stored_data == data))
+  {
+    return true;
+  }
+
+  ee_status = EE_Write(APP_NVM_DATA_BANK, addr, data);
+  if (ee_status == EE_CLEAN_NEEDED)
+  {
+    /* The obsolete pages are erased later, in background */
+    UTIL_SEQ_SetTask(1U << CFG_TASK_NVM_CLEAN, CFG_SCH_PRIO_1);
+  }
+  else if (ee_status != EE_OK)
+  {
+    APP_ZB_DBG("App_NVM_Data_Write failed @ %d status %d", addr, ee_status);
+    return false;
+  }
+
+  return true;
+} /* App_NVM_Data_Write */
+
+/* Exported Application records Functions ------------------------------------*/
+/**
+ * @brief  Register the record of an application module : the record keeps its
+ *         place in NVM from one startup to the other, found back from its ID
+ *         (a new place is allocated if its size has changed)
+ * @param  id record ID, unique in the application (not APP_NVM_RECORD_ID_FREE)
+ * @param  version version of the data layout : the data stored by another
+ *         version are not loaded
+ * @param  data record data in RAM, saved from and loaded in this buffer
+ * @param  len size of the data in bytes (up to APP_NVM_RECORD_MAX_SIZE)
+ * @retval true if registered, false if not enough room in NVM or table
+ */
+bool App_NVM_Record_Register(uint16_t id, uint8_t version, void *data, uint8_t len)
+{
+  App_NVM_Record_t *record = App_NVM_Record_Find(id);
+
+  if ((id == APP_NVM_RECORD_ID_FREE) || (len == 0U) || (len > APP_NVM_RECORD_MAX_SIZE))
+  {
+    return false;
+  }
+
+  /* Already registered : new RAM buffer, and new place on a layout change */
+  if (record != NULL)
+  {
+    record->data = data;
+    if ((record->version == version) && (record->len == len))
+    {
+      return true;
+    }
+    record->version = version;
+    record->len     = len;
+    return App_NVM_Record_Alloc(record);
+  }
+
+  if (nvm_records_nb >= APP_NVM_RECORD_MAX_NB)
+  {
+    APP_ZB_DBG("No more room for the record 0x%04x", id);
+    return false;
+  }
+
+  record = &nvm_records[nvm_records_nb];
+  record->data    = data;
+  record->id      = id;
+  record->version = version;
+  record->len     = len;
+  record->dirty   = false;
+  if (!App_NVM_Record_Alloc(record))
+  {
+    APP_ZB_DBG("No more room in NVM for the record 0x%04x", id);
+    return false;
+  }
+  nvm_records_nb++;
+
+  return true;
+} /* App_NVM_Record_Register */
+
+/**
+ * @brief  Load a registered record from NVM in its RAM buffer
+ * @param  id record ID
+ * @retval true if loaded, false if not stored (or by another version)
+ */
+bool App_NVM_Record_Load(uint16_t id)
+{
+  App_NVM_Record_t *record = App_NVM_Record_Find(id);
+  uint32_t words[2][APP_NVM_RECORD_BUF_WORDS];
+  int8_t slot;
+
+  if (record == NULL)
+  {
+    return false;
+  }
+
+  slot = App_NVM_Record_Newest(record, words);
+  if (slot < 0)
+  {
+    return false;
+  }
+  memcpy(record->data, &words[slot][2], record->len);
+
+  return true;
+} /* App_NVM_Record_Load */
+
+/**
+ * @brief  Mark a registered record to be saved : the dirty records are
+ *         written by a task, only their changed words
+ * @param  id record ID
+ * @retval true if marked, false if not registered
+ */
+bool App_NVM_Record_SetDirty(uint16_t id)
+{
+  App_NVM_Record_t *record = App_NVM_Record_Find(id);
+
+  if (record == NULL)
+  {
+    return false;
+  }
+
+  record->dirty = true;
+  UTIL_SEQ_SetTask(1U << CFG_TASK_NVM_RECORDS, CFG_SCH_PRIO_1);
+
+  return true;
+} /* App_NVM_Record_SetDirty */
+
+/**
+ * @brief  Write now the dirty records
+ * @param  None
+ * @retval None
+ */
+void App_NVM_Record_Flush(void)
+{
+  uint8_t index;
+
+  for (index = 0U; index < nvm_records_nb; index++)
+  {
+    if (nvm_records[index].dirty)
+    {
+      nvm_records[index].dirty = false;
+      if (!App_NVM_Record_Write(&nvm_records[index]))
+      {
+        APP_ZB_DBG("Write of the record 0x%04x failed", nvm_records[index].id);
+      }
+    }
+  }
+} /* App_NVM_Record_Flush */
+
+/**
+ * @brief  Find a registered record
+ * @param  id record ID
+ * @retval record, NULL if not registered
+ */
+static App_NVM_Record_t *App_NVM_Record_Find(uint16_t id)
+{
+  uint8_t index;
+
+  for (index = 0U; index < nvm_records_nb; index++)
+  {
+    if (nvm_records[index].id == id)
+    {
+      return &nvm_records[index];
+    }
+  }
+  return NULL;
+} /* App_NVM_Record_Find */
+
+/**
+ * @brief  Allocate a record in NVM : the records are chained from
+ *         APP_NVM_RECORD_BASE, each header giving the size of its place.
+ *         The record is found back from its ID and size, or takes a freed
+ *         place of the same size, or is added at the end of the chain
+ * @param  record record to allocate
+ * @retval true if allocated, false if not enough room
+ */
+static bool App_NVM_Record_Alloc(App_NVM_Record_t *record)
+{
+  uint32_t words = APP_NVM_RECORD_PLACE_WORDS(record->len);
+  uint32_t addr  = APP_NVM_RECORD_BASE;
+  uint32_t free_addr = 0U;
+  uint32_t header;
+  uint32_t seq;
+  uint8_t  slot;
+
+  while ((addr < CFG_EE_BANK1_MAX_NB) && (EE_Read(APP_NVM_DATA_BANK, (uint16_t)addr, &header) == EE_OK))
+  {
+    if (APP_NVM_RECORD_PLACE_WORDS(APP_NVM_RECORD_HDR_LEN(header)) == words)
+    {
+      if (APP_NVM_RECORD_HDR_ID(header) == record->id)
+      {
+        /* Found back : on a version or length change, the new header makes
+           the CRC of both slots wrong (not loaded) */
+        record->addr = (uint16_t)addr;
+        return App_NVM_Data_Write(record->addr, APP_NVM_RECORD_HDR(record->id, record->version, record->len));
+      }
+      if ((APP_NVM_RECORD_HDR_ID(header) == APP_NVM_RECORD_ID_FREE) && (free_addr == 0U))
+      {
+        free_addr = addr;
+      }
+    }
+    else if (APP_NVM_RECORD_HDR_ID(header) == record->id)
+    {
+      /* Size changed : the old place is freed, keeping its size in the chain */
+      (void)App_NVM_Data_Write((uint16_t)addr, APP_NVM_RECORD_HDR(APP_NVM_RECORD_ID_FREE, 0U,
+                                                                  APP_NVM_RECORD_HDR_LEN(header)));
+    }
+    addr += APP_NVM_RECORD_PLACE_WORDS(APP_NVM_RECORD_HDR_LEN(header));
+  }
+
+  if (free_addr != 0U)
+  {
+    /* The slots of a freed place may still hold a valid copy of the same
+       record (freed on a size change, then back to this size) : their
+       sequence number is changed, so that their CRC is wrong */
+    addr = free_addr;
+    for (slot = 0U; slot < 2U; slot++)
+    {
+      if (EE_Read(APP_NVM_DATA_BANK, APP_NVM_RECORD_SLOT_ADDR(addr, record->len, slot), &seq) == EE_OK)
+      {
+        (void)App_NVM_Data_Write(APP_NVM_RECORD_SLOT_ADDR(addr, record->len, slot), seq + 1U);
+      }
+    }
+  }
+  else if ((addr + words) > CFG_EE_BANK1_MAX_NB)
+  {
+    return false;
+  }
+
+  record->addr = (uint16_t)addr;
+  return App_NVM_Data_Write(record->addr, APP_NVM_RECORD_HDR(record->id, record->version, record->len));
+} /* App_NVM_Record_Alloc */
+
+/**
+ * @brief  Write a record in NVM : the slot not holding the newest copy is
+ *         written in one block (sequence number, payload, CRC32), so that a
+ *         reset during the write leaves the newest copy loadable
+ * @param  record record to write
+ * @retval true if success, false if failed
+ */
+static bool App_NVM_Record_Write(App_NVM_Record_t *record)
+{
+  uint32_t words[2][APP_NVM_RECORD_BUF_WORDS];
+  uint32_t block[APP_NVM_RECORD_BUF_WORDS] = { 0U };
+  uint32_t nb = APP_NVM_RECORD_SLOT_WORDS(record->len);
+  int8_t   newest = App_NVM_Record_Newest(record, words);
+  uint8_t  slot = (newest == 0) ? 1U : 0U;
+  int      ee_status;
+
+  memcpy(&block[2], record->data, record->len);
+
+  /* Unchanged since the last write */
+  if ((newest >= 0) &&
+      (memcmp(&block[2], &words[newest][2], 4U * APP_NVM_RECORD_WORDS(record->len)) == 0))
+  {
+    return true;
+  }
+
+  /* CRC of the header, sequence number and payload */
+  block[0]  = APP_NVM_RECORD_HDR(record->id, record->version, record->len);
+  block[1]  = (newest >= 0) ? (words[newest][1] + 1U) : 0U;
+  block[nb] = App_NVM_Crc32((const uint8_t *)block, 4U * nb);
+
+  ee_status = EE_WriteBlock(APP_NVM_DATA_BANK, APP_NVM_RECORD_SLOT_ADDR(record->addr, record->len, slot),
+                            &block[1], (uint16_t)nb);
+  if (ee_status == EE_CLEAN_NEEDED)
+  {
+    /* The obsolete pages are erased later, in background */
+    UTIL_SEQ_SetTask(1U << CFG_TASK_NVM_CLEAN, CFG_SCH_PRIO_1);
+  }
+  else if (ee_status != EE_OK)
+  {
+    APP_ZB_DBG("App_NVM_Record_Write failed @ %d status %d", record->addr, ee_status);
+    return false;
+  }
+
+  return true;
+} /* App_NVM_Record_Write */
+
+/**
+ * @brief  Read a slot of a record, preceded by the record header
+ * @param  record record to read
+ * @param  slot slot index (0 or 1)
+ * @param  words header, sequence number, payload and CRC32 read
+ * @retval true if the slot is written and its CRC is right
+ */
+static bool App_NVM_Record_ReadSlot(const App_NVM_Record_t *record, uint8_t slot, uint32_t *words)
+{
+  uint32_t nb = APP_NVM_RECORD_SLOT_WORDS(record->len);
+
+  words[0] = APP_NVM_RECORD_HDR(record->id, record->version, record->len);
+  if (EE_ReadBlock(APP_NVM_DATA_BANK, APP_NVM_RECORD_SLOT_ADDR(record->addr, record->len, slot),
+                   &words[1], (uint16_t)nb) != EE_OK)
+  {
+    return false;
+  }
+
+  return (App_NVM_Crc32((const uint8_t *)words, 4U * nb) == words[nb]);
+} /* App_NVM_Record_ReadSlot */
+
+/**
+ * @brief  Find the newest valid slot of a record
+ * @param  record record to read
+ * @param  words content of both slots (see App_NVM_Record_ReadSlot)
+ * @retval slot index, -1 if none is valid
+ */
+static int8_t App_NVM_Record_Newest(const App_NVM_Record_t *record, uint32_t words[2][APP_NVM_RECORD_BUF_WORDS])
+{
+  bool valid[2];
+
+  valid[0] = App_NVM_Record_ReadSlot(record, 0U, words[0]);
+  valid[1] = App_NVM_Record_ReadSlot(record, 1U, words[1]);
+
+  if (valid[0] && valid[1])
+  {
+    return ((int32_t)(words[1][1] - words[0][1]) > 0) ? 1 : 0;
+  }
+
+  return valid[0] ? 0 : (valid[1] ? 1 : -1);
+} /* App_NVM_Record_Newest */
+
+/**
+ * @brief  Display the NVM statistics : flash wear and operations, then the
+ *         usage of the stack memory
+ * @param  None
+ * @retval None
+ */
+void App_NVM_Stats_Disp(void)
+{
+  EE_Status_t ee_info;
+  FD_Statistics_t fd_stats;
+  struct ZbIpcCbPoolStatsT cb_pool;
+  struct ZbM0HeapStatsT m0_heap;
+  uint32_t page;
+  uint8_t index;
+  int bank;
+
+  APP_ZB_DBG("**********************************************************");
+  for (bank = 0; bank <= APP_NVM_DATA_BANK; bank++)
+  {
+    EE_GetStatus(bank, &ee_info);
+    APP_ZB_DBG("NVM bank%d : %d pool transfers, page erases min %d max %d",
+                bank, ee_info.nb_transfers, ee_info.erase_min, ee_info.erase_max);
+    for (page = 0; page < (uint32_t)(bank ? CFG_EE_BANK1_NB_OF_PAGE : CFG_EE_BANK0_NB_OF_PAGE); page += 2U)
+    {
+      APP_ZB_DBG("  page %2d : %5d erases | page %2d : %5d erases",
+                  page, EE_GetEraseCount(bank, page), page + 1U, EE_GetEraseCount(bank, page + 1U));
+    }
+    APP_ZB_DBG("  %d valid variables, %d elements written, %d programmed (x%d.%02d)",
+                ee_info.valid_elements, ee_info.user_elements, ee_info.programmed_elements,
+                (ee_info.user_elements != 0U) ? (ee_info.programmed_elements / ee_info.user_elements) : 0U,
+                (ee_info.user_elements != 0U) ? ((ee_info.programmed_elements * 100U / ee_info.user_elements) % 100U) : 0U);
+    APP_ZB_DBG("  standby pool %s (%d pages to prepare), %d free elements, %d sync cleans",
+                ee_info.standby_ready ? "ready" : "not ready", ee_info.standby_pages,
+                ee_info.free_elements, ee_info.nb_sync_clean);
+  }
+
+  FD_GetStatistics(&fd_stats);
+  APP_ZB_DBG("Flash : %d writes, %d erases, %d not executed",
+              fd_stats.NbrOfWrites, fd_stats.NbrOfErases, fd_stats.NbrOfNotExecuted);
+  APP_ZB_DBG("  guard windows : %d deferrals, %d operations forced",
+              fd_stats.NbrOfDeferred, fd_stats.NbrOfForced);
+  APP_ZB_DBG("  write time min/avg/max = %d/%d/%d us",
+              fd_stats.WriteTimeMin, (fd_stats.NbrOfWrites != 0U) ? (fd_stats.WriteTimeTotal / fd_stats.NbrOfWrites) : 0U,
+              fd_stats.WriteTimeMax);
+  APP_ZB_DBG("  erase time min/avg/max = %d/%d/%d us",
+              fd_stats.EraseTimeMin, (fd_stats.NbrOfErases != 0U) ? (fd_stats.EraseTimeTotal / fd_stats.NbrOfErases) : 0U,
+              fd_stats.EraseTimeMax);
+  APP_ZB_DBG("Persistence : %d saves, %d words written, %d skipped",
+              persistNumWrites, persistNumWordsWritten, persistNumWordsSkipped);
+  APP_ZB_DBG("  flash programmed per save : %d bytes in %d us",
+              (persistNumWrites != 0U) ? (persistNumFlashBytes / persistNumWrites) : 0U,
+              (persistNumWrites != 0U) ? (persistProgramTime / persistNumWrites) : 0U);
+  APP_ZB_DBG("  loaded at startup from %s in %d us",
+              persist_load_warm ? "RAM cache (warm reset)" : "FLASH", persist_load_time);
+  APP_ZB_DBG("Application records : %d registered", nvm_records_nb);
+  for (index = 0U; index < nvm_records_nb; index++)
+  {
+    APP_ZB_DBG("  record 0x%04x v%d : %d bytes @ %d", nvm_records[index].id, nvm_records[index].version,
+                nvm_records[index].len, nvm_records[index].addr);
+  }
+  ZbIpcCbPoolStats(&cb_pool);
+  APP_ZB_DBG("Stack memory : callback pool %d/%d in use (max %d), %d exhausted, %d from heap",
+              cb_pool.in_use, cb_pool.size, cb_pool.high_water, cb_pool.exhausted, cb_pool.heap_in_use);
+  ZbM0HeapStats(&m0_heap);
+  APP_ZB_DBG("  M0 heap : %d/%d bytes used (max %d, %d requested), %d free blocks (largest %d bytes)",
+              m0_heap.used, m0_heap.size, m0_heap.used_max, m0_heap.requested, m0_heap.free_blocks, m0_heap.largest_free);
+  APP_ZB_DBG("  M0 heap : %d allocations, %d from malloc (region full), %d failed",
+              m0_heap.alloc_cnt, m0_heap.fallback_cnt, m0_heap.fail_cnt);
+  APP_ZB_DBG("  M4 memory allocated by the M0 :");
+  zb_malloc_report(App_NVM_Stats_Print);
+#ifdef CONFIG_ZB_M0_HEAP_TRACE_SZ
+  /* Memory requests of the M0 since the previous display (Tests/Host/Traces) */
+  APP_ZB_DBG("  M0 heap trace :");
+  ZbM0HeapTraceDump(App_NVM_Stats_Print);
+#endif /* CONFIG_ZB_M0_HEAP_TRACE_SZ */
+  APP_ZB_DBG("**********************************************************");
+} /* App_NVM_Stats_Disp */
+
+/**
+ * @brief  Display a line of a statistics report of the stack
+ * @param  fmt printf format, followed by its arguments
+ * @retval None
+ */
+static void App_NVM_Stats_Print(const char *fmt, ...)
+{
+  char line[96];
+  va_list args;
+
+  va_start(args, fmt);
+  (void)vsnprintf(line, sizeof(line), fmt, args);
+  va_end(args);
+  APP_ZB_DBG("    %s", line);
+} /* App_NVM_Stats_Print */
+
+/**
+ * @brief  Display the time spent by each step of EE_Init
+ * @param  None
+ * @retval None
+ */
+static void App_NVM_Init_Profile_Disp(void)
+{
+  EE_InitProfile_t profile;
+  uint32_t cycles_us = SystemCoreClock / 1000000U;
+  int bank;
+
+  for (bank = 0; bank <= APP_NVM_DATA_BANK; bank++)
+  {
+    EE_GetInitProfile(bank, &profile);
+    if (profile.fast_init != 0U)
+    {
+      APP_ZB_DBG("EE_Init bank%d : state kept from clean shutdown (%d us)", bank, profile.total / cycles_us);
+      continue;
+    }
+    APP_ZB_DBG("EE_Init bank%d : %d us, %s write page, %d dirty standby pages", bank, profile.total / cycles_us,
+                (profile.write_state == 1U) ? "RECEIVE" : "ACTIVE", profile.dirty_pages);
+    APP_ZB_DBG("  search %d us, count %d us, transfer %d us, index %d us, stats %d us",
+                profile.search / cycles_us, profile.count / cycles_us, profile.transfer / cycles_us,
+                profile.index / cycles_us, profile.stats / cycles_us);
+  }
+} /* App_NVM_Init_Profile_Disp */
+
+/* NVM Transfer Functions ----------------------------------------------------*/
+/**
+ * @brief  Export the stack state image over the trace UART (binary frames) :
+ *         current state of the stack, or RAM cache if not known yet
+ * @param  None
+ * @retval None
+ */
+void App_NVM_Export_State(void)
+{
+#if (CFG_NVM_TRANSFER != 0)
+  uint32_t len = 0U;
+
+  if (nvm_transfer_state != APP_NVM_TRANSFER_IDLE)
+  {
+    APP_ZB_DBG("NVM transfer already in progress");
+    return;
+  }
+
+  if (persist_zb != NULL)
+  {
+    len = ZbStateGet(persist_zb, &nvm_transfer.U8_data[ST_PERSIST_FLASH_DATA_OFFSET],
+                     ST_PERSIST_MAX_ALLOC_SZ - ST_PERSIST_FLASH_DATA_OFFSET);
+    nvm_transfer.U32_data[0] = len;
+  }
+  else if (cache_persistent_info.magic == APP_NVM_CACHE_MAGIC)
+  {
+    len = cache_persistent_data.U32_data[0];
+    memcpy(nvm_transfer.U8_data, cache_persistent_data.U8_data, ST_PERSIST_FLASH_DATA_OFFSET + len);
+  }
+
+  if ((len == 0U) || (len > (ST_PERSIST_MAX_ALLOC_SZ - ST_PERSIST_FLASH_DATA_OFFSET)))
+  {
+    APP_ZB_DBG("No stack state to export");
+    return;
+  }
+
+  App_NVM_Export_Start(APP_NVM_SOURCE_STATE, nvm_transfer.U8_data, ST_PERSIST_FLASH_DATA_OFFSET + len);
+#else
+  APP_ZB_DBG("NVM transfer not supported");
+#endif /* CFG_NVM_TRANSFER */
+} /* App_NVM_Export_State */
+
+/**
+ * @brief  Export the raw flash of the EE banks over the trace UART (binary frames)
+ * @param  None
+ * @retval None
+ */
+void App_NVM_Export_Pools(void)
+{
+#if (CFG_NVM_TRANSFER != 0)
+  if (nvm_transfer_state != APP_NVM_TRANSFER_IDLE)
+  {
+    APP_ZB_DBG("NVM transfer already in progress");
+    return;
+  }
+
+  App_NVM_Export_Start(APP_NVM_SOURCE_POOLS, (const uint8_t *)(HW_FLASH_ADDRESS + CFG_NVM_BASE_ADDRESS),
+                       CFG_EE_BANK0_SIZE + CFG_EE_BANK1_SIZE);
+#else
+  APP_ZB_DBG("NVM transfer not supported");
+#endif /* CFG_NVM_TRANSFER */
+} /* App_NVM_Export_Pools */
+
+/**
+ * @brief  Wait for a stack state image sent over the UART (binary frames) :
+ *         the received bytes have then to be given to App_NVM_Import_Rx()
+ * @param  None
+ * @retval None
+ */
+void App_NVM_Import_Start(void)
+{
+#if (CFG_NVM_IMPORT != 0)
+  if (nvm_transfer_state != APP_NVM_TRANSFER_IDLE)
+  {
+    APP_ZB_DBG("NVM transfer already in progress");
+    return;
+  }
+
+  nvm_rx_head        = 0U;
+  nvm_rx_tail        = 0U;
+  nvm_rx_overflow    = false;
+  nvm_rx_index       = 0U;
+  nvm_transfer_len   = 0U;
+  nvm_transfer_state = APP_NVM_TRANSFER_IMPORT;
+  APP_ZB_DBG("NVM import : waiting for the state image frames");
+#else
+  APP_ZB_DBG("NVM import not supported");
+#endif /* CFG_NVM_IMPORT */
+} /* App_NVM_Import_Start */
+
+/**
+ * @brief  Receive one byte of an import (called under interrupt) : only
+ *         buffered, the frames are checked by the transfer task
+ * @param  byte received byte
+ * @retval true while the import is in progress (next bytes to be given too)
+ */
+bool App_NVM_Import_Rx(uint8_t byte)
+{
+#if (CFG_NVM_IMPORT != 0)
+  uint16_t head = nvm_rx_head;
+
+  if (nvm_transfer_state != APP_NVM_TRANSFER_IMPORT)
+  {
+    return false;
+  }
+
+  if ((uint16_t)(head - nvm_rx_tail) < APP_NVM_RX_BUFFER_SIZE)
+  {
+    nvm_rx_buffer[head & (APP_NVM_RX_BUFFER_SIZE - 1U)] = byte;
+    nvm_rx_head = head + 1U;
+  }
+  else
+  {
+    nvm_rx_overflow = true;
+  }
+  UTIL_SEQ_SetTask(1U << CFG_TASK_NVM_TRANSFER, CFG_SCH_PRIO_1);
+
+  return true;
+#else
+  (void)byte;
+  return false;
+#endif /* CFG_NVM_IMPORT */
+} /* App_NVM_Import_Rx */
+
+#if (CFG_NVM_TRANSFER != 0)
+/**
+ * @brief  Start the export of an image : frames sent by the transfer task
+ * @param  source image source (APP_NVM_SOURCE_xxx)
+ * @param  image image to export, unchanged up to the end of the export
+ * @param  len image length in bytes
+ * @retval None
+ */
+static void App_NVM_Export_Start(uint8_t source, const uint8_t *image, uint32_t len)
+{
+  nvm_transfer_source = source;
+  nvm_transfer_src    = image;
+  nvm_transfer_len    = len;
+  nvm_transfer_offset = 0U;
+  nvm_transfer_crc    = 0xFFFFFFFFU;
+  nvm_transfer_seq    = 0U;
+  nvm_transfer_state  = APP_NVM_TRANSFER_EXPORT;
+
+  APP_ZB_DBG("NVM export : %s, %d bytes in %d frames", (source == APP_NVM_SOURCE_STATE) ? "stack state" : "EE pools",
+              len, (len + APP_NVM_FRAME_DATA_SIZE - 1U) / APP_NVM_FRAME_DATA_SIZE + 2U);
+
+  /* START frame */
+  memset(&nvm_frame[APP_NVM_FRAME_HDR_SIZE], 0, 4U);
+  nvm_frame[APP_NVM_FRAME_HDR_SIZE] = source;
+  memcpy(&nvm_frame[APP_NVM_FRAME_HDR_SIZE + 4U], &len, 4U);
+  App_NVM_Frame_Send(APP_NVM_FRAME_START, 8U);
+
+  HW_TS_Start(TS_ID_NVM_TRANSFER, HW_TS_NVM_FRAME_PERIOD);
+} /* App_NVM_Export_Start */
+
+/**
+ * @brief  Send a frame over the trace UART, its payload being already in nvm_frame
+ * @param  type frame type (APP_NVM_FRAME_xxx)
+ * @param  len payload length
+ * @retval None
+ */
+static void App_NVM_Frame_Send(uint8_t type, uint16_t len)
+{
+  uint32_t crc;
+
+  nvm_frame[0] = APP_NVM_FRAME_SOF0;
+  nvm_frame[1] = APP_NVM_FRAME_SOF1;
+  nvm_frame[2] = type;
+  nvm_frame[3] = nvm_transfer_seq++;
+  nvm_frame[4] = (uint8_t)len;
+  nvm_frame[5] = (uint8_t)(len >> 8);
+  crc = App_NVM_Crc32(&nvm_frame[2], (APP_NVM_FRAME_HDR_SIZE - 2U) + len);
+  memcpy(&nvm_frame[APP_NVM_FRAME_HDR_SIZE + len], &crc, APP_NVM_FRAME_CRC_SIZE);
+
+  /* Queued with the traces (the trace queue copies the frame) */
+  (void)DbgTraceWrite(1U, nvm_frame, APP_NVM_FRAME_HDR_SIZE + len + APP_NVM_FRAME_CRC_SIZE);
+} /* App_NVM_Frame_Send */
+
+#if (CFG_NVM_IMPORT != 0)
+/**
+ * @brief  Store a byte received during an import : look for the start of
+ *         frame, then store the frame up to its CRC
+ * @param  byte received byte
+ * @retval None
+ */
+static void App_NVM_Import_Parse(uint8_t byte)
+{
+  if (((nvm_rx_index == 0U) && (byte != APP_NVM_FRAME_SOF0)) ||
+      ((nvm_rx_index == 1U) && (byte != APP_NVM_FRAME_SOF1)))
+  {
+    nvm_rx_index = 0U;
+    return;
+  }
+  nvm_frame[nvm_rx_index++] = byte;
+
+  if (nvm_rx_index == APP_NVM_FRAME_HDR_SIZE)
+  {
+    nvm_rx_len = (uint16_t)(nvm_frame[4] | (nvm_frame[5] << 8));
+    if (nvm_rx_len > APP_NVM_FRAME_MAX_PAYLOAD)
+    {
+      nvm_rx_index = 0U;
+    }
+  }
+  else if (nvm_rx_index == (APP_NVM_FRAME_HDR_SIZE + nvm_rx_len + APP_NVM_FRAME_CRC_SIZE))
+  {
+    App_NVM_Frame_Rx();
+    nvm_rx_index = 0U;
+  }
+} /* App_NVM_Import_Parse */
+
+/**
+ * @brief  Process a complete frame received during an import
+ * @param  None
+ * @retval None
+ */
+static void App_NVM_Frame_Rx(void)
+{
+  const uint8_t *payload = &nvm_frame[APP_NVM_FRAME_HDR_SIZE];
+  uint32_t crc;
+  uint32_t value;
+  uint32_t len;
+
+  memcpy(&crc, &payload[nvm_rx_len], APP_NVM_FRAME_CRC_SIZE);
+  if (App_NVM_Crc32(&nvm_frame[2], (APP_NVM_FRAME_HDR_SIZE - 2U) + nvm_rx_len) != crc)
+  {
+    APP_ZB_DBG("NVM import : bad frame CRC, import aborted");
+    nvm_transfer_state = APP_NVM_TRANSFER_IDLE;
+    return;
+  }
+
+  /* START : only a stack state image can be imported */
+  if (nvm_frame[2] == APP_NVM_FRAME_START)
+  {
+    memcpy(&len, &payload[4], 4U);
+    if ((nvm_rx_len != 8U) || (payload[0] != APP_NVM_SOURCE_STATE) ||
+        (len <= ST_PERSIST_FLASH_DATA_OFFSET) || (len > ST_PERSIST_MAX_ALLOC_SZ))
+    {
+      APP_ZB_DBG("NVM import : bad image, import aborted");
+      nvm_transfer_state = APP_NVM_TRANSFER_IDLE;
+      return;
+    }
+    nvm_transfer_len    = len;
+    nvm_transfer_offset = 0U;
+    nvm_transfer_crc    = 0xFFFFFFFFU;
+    nvm_transfer_seq    = nvm_frame[3] + 1U;
+    return;
+  }
+
+  /* DATA and END : in sequence after the START */
+  if ((nvm_transfer_len == 0U) || (nvm_frame[3] != nvm_transfer_seq))
+  {
+    APP_ZB_DBG("NVM import : frame lost, import aborted");
+    nvm_transfer_state = APP_NVM_TRANSFER_IDLE;
+    return;
+  }
+  nvm_transfer_seq++;
+
+  if (nvm_frame[2] == APP_NVM_FRAME_DATA)
+  {
+    memcpy(&value, payload, 4U);
+    len = nvm_rx_len - 4U;
+    if ((nvm_rx_len < 4U) || (value != nvm_transfer_offset) || ((value + len) > nvm_transfer_len))
+    {
+      APP_ZB_DBG("NVM import : bad data frame, import aborted");
+      nvm_transfer_state = APP_NVM_TRANSFER_IDLE;
+      return;
+    }
+    memcpy(&nvm_transfer.U8_data[value], &payload[4], len);
+    nvm_transfer_crc     = App_NVM_Crc32_Update(nvm_transfer_crc, &payload[4], len);
+    nvm_transfer_offset += len;
+  }
+  else if (nvm_frame[2] == APP_NVM_FRAME_END)
+  {
+    memcpy(&value, payload, 4U);
+    if ((nvm_rx_len != 4U) || (nvm_transfer_offset != nvm_transfer_len) || (~nvm_transfer_crc != value) ||
+        ((ST_PERSIST_FLASH_DATA_OFFSET + nvm_transfer.U32_data[0]) != nvm_transfer_len))
+    {
+      APP_ZB_DBG("NVM import : bad image CRC or length, import aborted");
+      nvm_transfer_state = APP_NVM_TRANSFER_IDLE;
+      return;
+    }
+
+    /* Image complete : stored by the transfer task */
+    nvm_transfer_state = APP_NVM_TRANSFER_IMPORT_DONE;
+  }
+} /* App_NVM_Frame_Rx */
+
+/**
+ * @brief  Store the imported image as the newest snapshot, then restart from it
+ * @param  None
+ * @retval None
+ */
+static void App_NVM_Import_Done(void)
+{
+  HW_TS_Stop(TS_ID_PERSIST_SAVE);
+  persist_dirty = false;
+  cache_persistent_info.magic = 0U;
+  memcpy(cache_persistent_data.U8_data, nvm_transfer.U8_data, nvm_transfer_len);
+  nvm_transfer_state = APP_NVM_TRANSFER_IDLE;
+
+  if (App_NVM_Write())
+  {
+    /* Restart by the transfer task once the trace is sent, the NVM being
+       kept unchanged until then */
+    APP_ZB_DBG("NVM import : %d bytes stored, restarting", nvm_transfer_len);
+    nvm_transfer_state = APP_NVM_TRANSFER_RESTART;
+    HW_TS_Start(TS_ID_NVM_TRANSFER, HW_TS_NVM_RESTART_DELAY);
+  }
+  else
+  {
+    APP_ZB_DBG("NVM import : write failed");
+  }
+} /* App_NVM_Import_Done */
+#endif /* CFG_NVM_IMPORT */
+
+/**
+ * @brief  NVM transfer task : send the next export frame, or check the
+ *         received import frames, store the imported image and restart
+ * @param  None
+ * @retval None
+ */
+static void App_NVM_Transfer_Task(void)
+{
+  uint32_t len;
+
+  if (nvm_transfer_state == APP_NVM_TRANSFER_EXPORT)
+  {
+    len = nvm_transfer_len - nvm_transfer_offset;
+    if (len != 0U)
+    {
+      /* DATA frame : offset then data */
+      if (len > APP_NVM_FRAME_DATA_SIZE)
+      {
+        len = APP_NVM_FRAME_DATA_SIZE;
+      }
+      memcpy(&nvm_frame[APP_NVM_FRAME_HDR_SIZE], &nvm_transfer_offset, 4U);
+      memcpy(&nvm_frame[APP_NVM_FRAME_HDR_SIZE + 4U], &nvm_transfer_src[nvm_transfer_offset], len);
+      nvm_transfer_crc     = App_NVM_Crc32_Update(nvm_transfer_crc, &nvm_frame[APP_NVM_FRAME_HDR_SIZE + 4U], len);
+      nvm_transfer_offset += len;
+      App_NVM_Frame_Send(APP_NVM_FRAME_DATA, (uint16_t)(4U + len));
+      HW_TS_Start(TS_ID_NVM_TRANSFER, HW_TS_NVM_FRAME_PERIOD);
+    }
+    else
+    {
+      /* END frame : CRC32 of the data sent */
+      nvm_transfer_crc = ~nvm_transfer_crc;
+      memcpy(&nvm_frame[APP_NVM_FRAME_HDR_SIZE], &nvm_transfer_crc, 4U);
+      App_NVM_Frame_Send(APP_NVM_FRAME_END, 4U);
+      nvm_transfer_state = APP_NVM_TRANSFER_IDLE;
+      APP_ZB_DBG("NVM export done (CRC32 0x%08x)", nvm_transfer_crc);
+
+      /* Save the persistent data notified during the export */
+      if (persist_dirty)
+      {
+        UTIL_SEQ_SetTask(1U << CFG_TASK_PERSIST_SAVE, CFG_SCH_PRIO_1);
+      }
+    }
+  }
+#if (CFG_NVM_IMPORT != 0)
+  else if (nvm_transfer_state == APP_NVM_TRANSFER_IMPORT)
+  {
+    /* Frames of the bytes buffered by the UART interrupt */
+    while ((nvm_transfer_state == APP_NVM_TRANSFER_IMPORT) && (nvm_rx_tail != nvm_rx_head))
+    {
+      App_NVM_Import_Parse(nvm_rx_buffer[nvm_rx_tail & (APP_NVM_RX_BUFFER_SIZE - 1U)]);
+      nvm_rx_tail++;
+    }
+    if ((nvm_transfer_state == APP_NVM_TRANSFER_IMPORT) && nvm_rx_overflow)
+    {
+      APP_ZB_DBG("NVM import : receive buffer overflow, import aborted");
+      nvm_transfer_state = APP_NVM_TRANSFER_IDLE;
+    }
+    if (nvm_transfer_state == APP_NVM_TRANSFER_IMPORT_DONE)
+    {
+      App_NVM_Import_Done();
+    }
+  }
+  else if (nvm_transfer_state == APP_NVM_TRANSFER_RESTART)
+  {
+    App_NVM_Shutdown();
+    NVIC_SystemReset();
+  }
+#endif /* CFG_NVM_IMPORT */
+} /* App_NVM_Transfer_Task */
+
+/**
+ * @brief  NVM transfer timer callback (under interrupt) : next export frame,
+ *         or restart after an import
+ * @param  None
+ * @retval None
+ */
+static void App_NVM_Transfer_Timer_cb(void)
+{
+  UTIL_SEQ_SetTask(1U << CFG_TASK_NVM_TRANSFER, CFG_SCH_PRIO_1);
+} /* App_NVM_Transfer_Timer_cb */
+#endif /* CFG_NVM_TRANSFER */
 
 /**
  * @brief  Simple function to see the content of NVM table
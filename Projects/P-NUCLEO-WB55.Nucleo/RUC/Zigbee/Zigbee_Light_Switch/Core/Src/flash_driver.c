@@ -36,14 +36,47 @@ typedef enum
   FLASH_WRITE,
 }FlashOperationType_t;
 
+typedef struct
+{
+  FlashOperationType_t FlashOperationType;
+  uint32_t SectorNumberOrDestAddress;   /* Next sector to erase or next address to write */
+  uint64_t *pSrcBuffer;                 /* Next 64bits data to write */
+  uint32_t NbrOfOperations;             /* Single operations left */
+  FD_Callback_t Callback;
+  void *pArg;
+}FlashQueuedOperation_t;
+
 /* Private defines -----------------------------------------------------------*/
 /* Private macros ------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
+static FD_Statistics_t FD_Statistics;
+static FlashQueuedOperation_t FD_Queue[CFG_FD_QUEUE_SIZE];
+static uint32_t FD_QueueHead = 0;
+static uint32_t FD_QueueCount = 0;
+static uint32_t FD_GuardStartTick = 0;
+static uint32_t FD_GuardDuration = 0;     /* Guard window in ms from FD_GuardStartTick, 0 when none */
+static uint32_t FD_DeferStartTick = 0;
+static uint32_t FD_DeferActive = 0;       /* The next queued operation has been deferred since FD_DeferStartTick */
+static uint32_t FD_DeferDelay = 0;        /* Delay in ms before retrying the deferred queued operations */
+static uint32_t FD_QueueNotExecuted = 0;  /* The last queued operation has not been executed due to timing protection */
+#if (CFG_FD_POWER_LOSS_TEST != 0)
+static uint32_t FD_PowerLossCountdown = 0;
+#endif
 /* Global variables ----------------------------------------------------------*/
 /* Private function prototypes -----------------------------------------------*/
 static SingleFlashOperationStatus_t ProcessSingleFlashOperation(FlashOperationType_t FlashOperationType,
                                                                 uint32_t SectorNumberOrDestAddress,
                                                                 uint64_t Data);
+static void UpdateTimeStatistics(uint32_t Duration, uint32_t NbrOfOperations,
+                                 uint32_t *pMin, uint32_t *pMax, uint32_t *pTotal);
+static uint32_t SubmitFlashOperation(FlashOperationType_t FlashOperationType,
+                                     uint32_t SectorNumberOrDestAddress, uint64_t * pSrcBuffer,
+                                     uint32_t NbrOfOperations, FD_Callback_t Callback, void *pArg);
+static uint32_t ProcessQueuedFlashOperations(uint32_t MaxNbrOfOperations, uint32_t Deferrable);
+static uint32_t FlushQueueDependencies(uint32_t FirstSector, uint32_t NbrOfSectors);
+static uint32_t GetNbrOfDependencies(uint32_t FirstSector, uint32_t NbrOfSectors);
+static uint32_t GetGuardTimeLeft(void);
+static uint32_t CheckGuard(void);
 /* Public functions ----------------------------------------------------------*/
 uint32_t FD_EraseSectors(uint32_t FirstSector, uint32_t NbrOfSectors)
 {
@@ -53,6 +86,14 @@ uint32_t FD_EraseSectors(uint32_t FirstSector, uint32_t NbrOfSectors)
 
   single_flash_operation_status = SINGLE_FLASH_OPERATION_DONE;
 
+  /**
+   *  The queued operations on these sectors are requested before this one
+   */
+  if(FlushQueueDependencies(FirstSector, NbrOfSectors) != 0)
+  {
+    return (NbrOfSectors | FD_QUEUE_NOT_FLUSHED);
+  }
+
   /**
    *  Take the semaphore to take ownership of the Flash IP
    */
@@ -107,6 +148,17 @@ uint32_t FD_WriteData(uint32_t DestAddress, uint64_t * pSrcBuffer, uint32_t NbrO
 
   single_flash_operation_status = SINGLE_FLASH_OPERATION_DONE;
 
+  /**
+   *  The queued operations on the sectors written are requested before this one
+   */
+  if((NbrOfData != 0) &&
+     (FlushQueueDependencies((DestAddress - FLASH_BASE) / FLASH_PAGE_SIZE,
+                             ((DestAddress + (8 * NbrOfData) - 1 - FLASH_BASE) / FLASH_PAGE_SIZE)
+                             - ((DestAddress - FLASH_BASE) / FLASH_PAGE_SIZE) + 1) != 0))
+  {
+    return (NbrOfData | FD_QUEUE_NOT_FLUSHED);
+  }
+
   /**
    *  Take the semaphore to take ownership of the Flash IP
    */
@@ -157,6 +209,124 @@ SingleFlashOperationStatus_t FD_WriteSingleData(uint32_t DestAddress, uint64_t D
   return return_value;
 }
 
+void FD_GetStatistics(FD_Statistics_t * pStatistics)
+{
+  *pStatistics = FD_Statistics;
+
+  return;
+}
+
+uint32_t FD_SubmitErase(uint32_t FirstSector, uint32_t NbrOfSectors, FD_Callback_t Callback, void *pArg)
+{
+  return SubmitFlashOperation(FLASH_ERASE, FirstSector, 0, NbrOfSectors, Callback, pArg);
+}
+
+uint32_t FD_SubmitWrite(uint32_t DestAddress, uint64_t * pSrcBuffer, uint32_t NbrOfData,
+                        FD_Callback_t Callback, void *pArg)
+{
+  return SubmitFlashOperation(FLASH_WRITE, DestAddress, pSrcBuffer, NbrOfData, Callback, pArg);
+}
+
+void FD_ProcessQueue(void)
+{
+  if(ProcessQueuedFlashOperations(CFG_FD_QUEUE_BATCH_SIZE, 1) != 0)
+  {
+    if(FD_DeferDelay != 0)
+    {
+      /**
+       *  Retry at the end of the guard window
+       */
+      FD_Statistics.NbrOfDeferred++;
+      FD_QueueDeferred(FD_DeferDelay);
+    }
+    else if(FD_QueueNotExecuted != 0)
+    {
+      /**
+       *  The flash is blocked by the CPU2 (or CPU1) timing protection: retry later, not at once,
+       *  which would keep the scheduler busy as long as the protection is active
+       */
+      FD_QueueDeferred(CFG_FD_QUEUE_RETRY_MS);
+    }
+    else
+    {
+      /**
+       *  Give the hand back to the scheduler before the next batch
+       */
+      FD_QueueNotify();
+    }
+  }
+
+  return;
+}
+
+uint32_t FD_FlushQueue(void)
+{
+  uint32_t return_value = FD_QueueCount;
+
+  /**
+   *  Stop when the operations are not executed due to timing protection
+   */
+  while(return_value != 0)
+  {
+    return_value = ProcessQueuedFlashOperations(0xFFFFFFFFUL, 0);
+    if((return_value != 0) && (FD_WaitForSemAvailable(WAIT_FOR_SEM_BLOCK_FLASH_REQ_BY_CPU2) == WAITED_SEM_BUSY))
+    {
+      break;
+    }
+  }
+
+  return return_value;
+}
+
+void FD_DeferOperations(uint32_t DelayMs)
+{
+  UTILS_ENTER_CRITICAL_SECTION();
+
+  /**
+   *  Extend the current guard window only
+   */
+  if(DelayMs > GetGuardTimeLeft())
+  {
+    FD_GuardStartTick = HAL_GetTick();
+    FD_GuardDuration = DelayMs;
+  }
+
+  UTILS_EXIT_CRITICAL_SECTION();
+
+  return;
+}
+
+uint32_t FD_GetGuardTimeLeft(void)
+{
+  return GetGuardTimeLeft();
+}
+
+void FD_ResetStatistics(void)
+{
+  FD_Statistics.NbrOfWrites = 0;
+  FD_Statistics.NbrOfErases = 0;
+  FD_Statistics.NbrOfNotExecuted = 0;
+  FD_Statistics.NbrOfDeferred = 0;
+  FD_Statistics.NbrOfForced = 0;
+  FD_Statistics.WriteTimeMin = 0;
+  FD_Statistics.WriteTimeMax = 0;
+  FD_Statistics.WriteTimeTotal = 0;
+  FD_Statistics.EraseTimeMin = 0;
+  FD_Statistics.EraseTimeMax = 0;
+  FD_Statistics.EraseTimeTotal = 0;
+
+  return;
+}
+
+#if (CFG_FD_POWER_LOSS_TEST != 0)
+void FD_SetPowerLoss(uint32_t NbrOfOperations)
+{
+  FD_PowerLossCountdown = NbrOfOperations;
+
+  return;
+}
+#endif
+
 /*************************************************************
  *
  * LOCAL FUNCTIONS
@@ -173,9 +343,34 @@ static SingleFlashOperationStatus_t ProcessSingleFlashOperation(FlashOperationTy
 
   uint32_t page_error;
   FLASH_EraseInitTypeDef p_erase_init;
+  uint32_t start_cycles;
+  uint32_t duration;
+  uint32_t guard_window;
 
   waited_sem_status = WAITED_SEM_FREE;
 
+#if (CFG_FD_POWER_LOSS_TEST != 0)
+  if((FD_PowerLossCountdown != 0) && (--FD_PowerLossCountdown == 0))
+  {
+    /**
+     * Power loss simulation: the flash operation is not done
+     */
+    NVIC_SystemReset();
+  }
+#endif
+
+  /**
+   * The duration of the operation is measured with the DWT cycle counter, enabled on first use
+   */
+  if((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0)
+  {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+  start_cycles = DWT->CYCCNT;
+  guard_window = GetGuardTimeLeft();
+
   p_erase_init.TypeErase = FLASH_TYPEERASE_PAGES;
   p_erase_init.NbPages = 1;
   p_erase_init.Page = SectorNumberOrDestAddress;
@@ -285,6 +480,26 @@ static SingleFlashOperationStatus_t ProcessSingleFlashOperation(FlashOperationTy
      * The only commitment is that it is possible to request a new flash processing
      */
     return_status = SINGLE_FLASH_OPERATION_DONE;
+
+    duration = (DWT->CYCCNT - start_cycles) / (SystemCoreClock / 1000000U);
+
+    if(guard_window != 0)
+    {
+      FD_Statistics.NbrOfForced++;
+    }
+
+    if(FlashOperationType == FLASH_ERASE)
+    {
+      UpdateTimeStatistics(duration, FD_Statistics.NbrOfErases,
+                           &FD_Statistics.EraseTimeMin, &FD_Statistics.EraseTimeMax, &FD_Statistics.EraseTimeTotal);
+      FD_Statistics.NbrOfErases++;
+    }
+    else
+    {
+      UpdateTimeStatistics(duration, FD_Statistics.NbrOfWrites,
+                           &FD_Statistics.WriteTimeMin, &FD_Statistics.WriteTimeMax, &FD_Statistics.WriteTimeTotal);
+      FD_Statistics.NbrOfWrites++;
+    }
   }
   else
   {
@@ -294,11 +509,344 @@ static SingleFlashOperationStatus_t ProcessSingleFlashOperation(FlashOperationTy
      * protect its timing anymore.
      */
     return_status = SINGLE_FLASH_OPERATION_NOT_EXECUTED;
+
+    FD_Statistics.NbrOfNotExecuted++;
   }
 
   return return_status;
 }
 
+static uint32_t SubmitFlashOperation(FlashOperationType_t FlashOperationType,
+                                     uint32_t SectorNumberOrDestAddress, uint64_t * pSrcBuffer,
+                                     uint32_t NbrOfOperations, FD_Callback_t Callback, void *pArg)
+{
+  FlashQueuedOperation_t *p_op;
+
+  if(NbrOfOperations == 0)
+  {
+    return 0;
+  }
+
+  /**
+   *  Merge with the last queued operation when it is followed by this one
+   */
+  if(FD_QueueCount != 0)
+  {
+    p_op = &FD_Queue[(FD_QueueHead + FD_QueueCount - 1) % CFG_FD_QUEUE_SIZE];
+
+    if((p_op->FlashOperationType == FlashOperationType) && (p_op->Callback == Callback) && (p_op->pArg == pArg))
+    {
+      if((FlashOperationType == FLASH_ERASE) &&
+         ((p_op->SectorNumberOrDestAddress + p_op->NbrOfOperations) == SectorNumberOrDestAddress))
+      {
+        p_op->NbrOfOperations += NbrOfOperations;
+        return 0;
+      }
+      if((FlashOperationType == FLASH_WRITE) &&
+         ((p_op->SectorNumberOrDestAddress + (8 * p_op->NbrOfOperations)) == SectorNumberOrDestAddress) &&
+         ((p_op->pSrcBuffer + p_op->NbrOfOperations) == pSrcBuffer))
+      {
+        p_op->NbrOfOperations += NbrOfOperations;
+        return 0;
+      }
+    }
+  }
+
+  if(FD_QueueCount == CFG_FD_QUEUE_SIZE)
+  {
+    return 1;
+  }
+
+  p_op = &FD_Queue[(FD_QueueHead + FD_QueueCount) % CFG_FD_QUEUE_SIZE];
+  p_op->FlashOperationType = FlashOperationType;
+  p_op->SectorNumberOrDestAddress = SectorNumberOrDestAddress;
+  p_op->pSrcBuffer = pSrcBuffer;
+  p_op->NbrOfOperations = NbrOfOperations;
+  p_op->Callback = Callback;
+  p_op->pArg = pArg;
+  FD_QueueCount++;
+
+  FD_QueueNotify();
+
+  return 0;
+}
+
+static uint32_t ProcessQueuedFlashOperations(uint32_t MaxNbrOfOperations, uint32_t Deferrable)
+{
+  FlashQueuedOperation_t *p_op;
+  FD_Callback_t callback[CFG_FD_QUEUE_SIZE];
+  void *p_arg[CFG_FD_QUEUE_SIZE];
+  uint32_t nbr_of_callbacks;
+  uint32_t loop;
+  uint32_t erase_activity;
+  SingleFlashOperationStatus_t single_flash_operation_status;
+
+  if(FD_QueueCount == 0)
+  {
+    return 0;
+  }
+
+  nbr_of_callbacks = 0;
+  erase_activity = 0;
+  single_flash_operation_status = SINGLE_FLASH_OPERATION_DONE;
+  FD_DeferDelay = 0;
+  FD_QueueNotExecuted = 0;
+
+  /**
+   *  Nothing is started within a guard window
+   */
+  if(Deferrable != 0)
+  {
+    FD_DeferDelay = CheckGuard();
+    if(FD_DeferDelay != 0)
+    {
+      return FD_QueueCount;
+    }
+  }
+
+  /**
+   *  Take the semaphore to take ownership of the Flash IP, once for the batch
+   */
+  while(LL_HSEM_1StepLock(HSEM, CFG_HW_FLASH_SEMID));
+
+  HAL_FLASH_Unlock();
+
+  while((FD_QueueCount != 0) && (MaxNbrOfOperations != 0) && (single_flash_operation_status == SINGLE_FLASH_OPERATION_DONE))
+  {
+    p_op = &FD_Queue[FD_QueueHead];
+
+    /**
+     *  Notify the CPU2 of the erase activity once for the batch (see FD_EraseSectors())
+     */
+    if((p_op->FlashOperationType == FLASH_ERASE) && (erase_activity == 0))
+    {
+      SHCI_C2_FLASH_EraseActivity(ERASE_ACTIVITY_ON);
+      erase_activity = 1;
+    }
+
+    while((p_op->NbrOfOperations != 0) && (MaxNbrOfOperations != 0))
+    {
+      /**
+       *  A guard window may have been requested under interrupt during the batch
+       */
+      if(Deferrable != 0)
+      {
+        FD_DeferDelay = CheckGuard();
+        if(FD_DeferDelay != 0)
+        {
+          break;
+        }
+      }
+
+      if(p_op->FlashOperationType == FLASH_ERASE)
+      {
+        single_flash_operation_status = FD_EraseSingleSector(p_op->SectorNumberOrDestAddress);
+      }
+      else
+      {
+        single_flash_operation_status = FD_WriteSingleData(p_op->SectorNumberOrDestAddress, *p_op->pSrcBuffer);
+      }
+
+      if(single_flash_operation_status != SINGLE_FLASH_OPERATION_DONE)
+      {
+        FD_QueueNotExecuted = 1;
+        break;
+      }
+      FD_DeferActive = 0;
+
+      if(p_op->FlashOperationType == FLASH_ERASE)
+      {
+        p_op->SectorNumberOrDestAddress++;
+      }
+      else
+      {
+        p_op->SectorNumberOrDestAddress += 8;
+        p_op->pSrcBuffer++;
+      }
+      p_op->NbrOfOperations--;
+      MaxNbrOfOperations--;
+    }
+
+    if(p_op->NbrOfOperations == 0)
+    {
+      /**
+       *  The callbacks are called once the flash is released, so that they can request new operations
+       */
+      callback[nbr_of_callbacks] = p_op->Callback;
+      p_arg[nbr_of_callbacks] = p_op->pArg;
+      nbr_of_callbacks++;
+
+      FD_QueueHead = (FD_QueueHead + 1) % CFG_FD_QUEUE_SIZE;
+      FD_QueueCount--;
+    }
+    else if(FD_DeferDelay != 0)
+    {
+      break;
+    }
+  }
+
+  if(erase_activity != 0)
+  {
+    SHCI_C2_FLASH_EraseActivity(ERASE_ACTIVITY_OFF);
+  }
+
+  HAL_FLASH_Lock();
+
+  /**
+   *  Release the ownership of the Flash IP
+   */
+  LL_HSEM_ReleaseLock(HSEM, CFG_HW_FLASH_SEMID, 0);
+
+  for(loop = 0; loop < nbr_of_callbacks; loop++)
+  {
+    if(callback[loop] != 0)
+    {
+      callback[loop](p_arg[loop]);
+    }
+  }
+
+  return FD_QueueCount;
+}
+
+static uint32_t FlushQueueDependencies(uint32_t FirstSector, uint32_t NbrOfSectors)
+{
+  uint32_t nbr_of_dependencies;
+
+  /**
+   *  Processed in order, not deferred: stop when the operations are not executed due to timing protection.
+   *  The other queued operations are left to FD_ProcessQueue()
+   */
+  nbr_of_dependencies = GetNbrOfDependencies(FirstSector, NbrOfSectors);
+  while(nbr_of_dependencies != 0)
+  {
+    (void)ProcessQueuedFlashOperations(nbr_of_dependencies, 0);
+    nbr_of_dependencies = GetNbrOfDependencies(FirstSector, NbrOfSectors);
+
+    if((nbr_of_dependencies != 0) && (FD_QueueNotExecuted != 0) &&
+       (FD_WaitForSemAvailable(WAIT_FOR_SEM_BLOCK_FLASH_REQ_BY_CPU2) == WAITED_SEM_BUSY))
+    {
+      break;
+    }
+  }
+
+  return nbr_of_dependencies;
+}
+
+static uint32_t GetNbrOfDependencies(uint32_t FirstSector, uint32_t NbrOfSectors)
+{
+  FlashQueuedOperation_t *p_op;
+  uint32_t loop;
+  uint32_t first;
+  uint32_t last;
+  uint32_t nbr_of_operations;
+  uint32_t return_value;
+
+  /**
+   *  Single operations to process from the head of the queue, up to the last queued request on one of these sectors
+   */
+  nbr_of_operations = 0;
+  return_value = 0;
+  for(loop = 0; loop < FD_QueueCount; loop++)
+  {
+    p_op = &FD_Queue[(FD_QueueHead + loop) % CFG_FD_QUEUE_SIZE];
+    nbr_of_operations += p_op->NbrOfOperations;
+
+    if(p_op->FlashOperationType == FLASH_ERASE)
+    {
+      first = p_op->SectorNumberOrDestAddress;
+      last = first + p_op->NbrOfOperations - 1;
+    }
+    else
+    {
+      first = (p_op->SectorNumberOrDestAddress - FLASH_BASE) / FLASH_PAGE_SIZE;
+      last = (p_op->SectorNumberOrDestAddress + (8 * p_op->NbrOfOperations) - 1 - FLASH_BASE) / FLASH_PAGE_SIZE;
+    }
+
+    if((first < (FirstSector + NbrOfSectors)) && (last >= FirstSector))
+    {
+      return_value = nbr_of_operations;
+    }
+  }
+
+  return return_value;
+}
+
+static uint32_t GetGuardTimeLeft(void)
+{
+  uint32_t elapsed;
+  uint32_t return_value;
+
+  return_value = 0;
+
+  UTILS_ENTER_CRITICAL_SECTION();
+
+  if(FD_GuardDuration != 0)
+  {
+    elapsed = HAL_GetTick() - FD_GuardStartTick;
+    if(elapsed < FD_GuardDuration)
+    {
+      return_value = FD_GuardDuration - elapsed;
+    }
+    else
+    {
+      FD_GuardDuration = 0;
+    }
+  }
+
+  UTILS_EXIT_CRITICAL_SECTION();
+
+  return return_value;
+}
+
+static uint32_t CheckGuard(void)
+{
+  uint32_t time_left;
+  uint32_t deferred;
+
+  time_left = GetGuardTimeLeft();
+  if(time_left == 0)
+  {
+    return 0;
+  }
+
+  /**
+   *  The next queued operation is deferred up to CFG_FD_GUARD_MAX_DEFER_MS, then forced
+   */
+  if(FD_DeferActive == 0)
+  {
+    FD_DeferActive = 1;
+    FD_DeferStartTick = HAL_GetTick();
+  }
+
+  deferred = HAL_GetTick() - FD_DeferStartTick;
+  if(deferred >= CFG_FD_GUARD_MAX_DEFER_MS)
+  {
+    return 0;
+  }
+  if(time_left > (CFG_FD_GUARD_MAX_DEFER_MS - deferred))
+  {
+    time_left = CFG_FD_GUARD_MAX_DEFER_MS - deferred;
+  }
+
+  return time_left;
+}
+
+static void UpdateTimeStatistics(uint32_t Duration, uint32_t NbrOfOperations,
+                                 uint32_t *pMin, uint32_t *pMax, uint32_t *pTotal)
+{
+  if((NbrOfOperations == 0) || (Duration < *pMin))
+  {
+    *pMin = Duration;
+  }
+  if(Duration > *pMax)
+  {
+    *pMax = Duration;
+  }
+  *pTotal += Duration;
+
+  return;
+}
+
 /*************************************************************
  *
  * WEAK FUNCTIONS
@@ -319,3 +867,22 @@ __WEAK WaitedSemStatus_t FD_WaitForSemAvailable(WaitedSemId_t WaitedSemId)
   return WAITED_SEM_BUSY;
 }
 
+__WEAK void FD_QueueNotify(void)
+{
+  /**
+   * The application shall schedule the call of FD_ProcessQueue()
+   */
+  return;
+}
+
+__WEAK void FD_QueueDeferred(uint32_t DelayMs)
+{
+  /**
+   * By default, FD_ProcessQueue() is scheduled again at once and checks again the guard window or the
+   * timing protection: the application should rather schedule it after DelayMs ms
+   */
+  FD_QueueNotify();
+
+  return;
+}
+
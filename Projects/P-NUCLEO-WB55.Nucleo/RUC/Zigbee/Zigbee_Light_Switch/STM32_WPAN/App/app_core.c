@@ -141,6 +141,17 @@ void App_Core_Restore_State(void)
   App_LightSwitch_Restore_State();  
 } /* App_Core_Restore_State */
 
+/**
+ * @brief  Restore the application outputs from the application data saved in NVM,
+ *         at startup before the Zigbee stack start-up
+ * @param  None
+ * @retval None
+ */
+void App_Core_Fast_Restore(void)
+{
+  // Nothing to do
+} /* App_Core_Fast_Restore */
+
 
 /* Informations functions -------------------------------------------------- */
 /**
@@ -247,9 +258,11 @@ void App_Core_Factory_Reset(void)
     App_Zigbee_Unbind_All();
     ZbLeaveReq(app_zb_info.zb, &App_Core_Leave_cb, NULL);
   }
+  /* Data deleted and pending coalesced save cancelled (not to be written back) */
   App_Persist_Delete();
   /* Wait 2 sec before clear display */
   HAL_Delay(2000);
+  App_NVM_Shutdown();
   NVIC_SystemReset();
 } /* App_Core_Factory_Reset */
 
@@ -99,6 +99,8 @@ void App_LightSwitch_ConfigGroupAddr(void)
 
 /**
  * @brief  Restore the ONOFF state after persitance data loaded
+ *         Nothing kept in an application record (app_nvm.h) : the OnOff and
+ *         Level values are the ones of the bound lights, read back from them
  * 
  * @param  None
  * @retval None
@@ -19,6 +19,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "stm32_seq.h"
 #include "app_light_switch_cfg.h"
+#include "app_nvm.h"
 
 /* Application Variable-------------------------------------------------------*/
 static Level_Control_T app_Level_Control =
@@ -311,6 +312,9 @@ void App_Light_Switch_Level_Cmd(struct ZbApsAddrT * dst)
   uint64_t epid = 0U;
   enum ZclStatusCodeT cmd_status;
   struct ZbZclLevelClientMoveToLevelReqT req;
+  struct ZbZclClusterCommandReqT cluster_req;
+  uint8_t payload[8];
+  int len;
   
   /* Check that the Zigbee stack initialised */
   if( app_Level_Control.levelControl_client->zb == NULL)
@@ -328,6 +332,9 @@ void App_Light_Switch_Level_Cmd(struct ZbApsAddrT * dst)
   {
     return;
   }
+
+  /* Keep the flash operations away from the command transmission */
+  App_NVM_Tx_Guard();
   
   req.with_onoff = false;
   req.transition_time = 0;   
@@ -392,10 +399,27 @@ void App_Light_Switch_Level_Cmd(struct ZbApsAddrT * dst)
       
       app_Level_Control.cmd_send = req.level;
       
-      /* Browse binding table to find target */
+      /* Browse binding table to find target: the commands are queued to the
+         M0 without waiting for each of them, the ones not queued are sent by
+         the blocking request */
+      memset(&cluster_req, 0, sizeof(cluster_req));
+      cluster_req.cmdId = ZCL_LEVEL_COMMAND_MOVELEVEL;
+      cluster_req.noDefaultResp = ZCL_NO_DEFAULT_RESPONSE_FALSE;
+      cluster_req.payload = payload;
+      len = ZbZclLevelClientMoveToLevelBuild(payload, sizeof(payload), &req);
       for (uint8_t i = 0; i < app_Level_Control.bind_nb; i++)
       {
-        cmd_status = ZbZclLevelClientMoveToLevelReq( app_Level_Control.levelControl_client, &app_Level_Control.bind_table[i], &req, &App_Light_Switch_Level_Cmd_cb, NULL);    
+        cmd_status = ZCL_STATUS_FAILURE;
+        if (len > 0)
+        {
+          cluster_req.dst = app_Level_Control.bind_table[i];
+          cluster_req.length = (unsigned int)len;
+          cmd_status = ZbZclClusterCommandReqAsync(app_Level_Control.levelControl_client, &cluster_req, &App_Light_Switch_Level_Cmd_cb, NULL);
+        }
+        if (cmd_status != ZCL_STATUS_SUCCESS)
+        {
+          cmd_status = ZbZclLevelClientMoveToLevelReq( app_Level_Control.levelControl_client, &app_Level_Control.bind_table[i], &req, &App_Light_Switch_Level_Cmd_cb, NULL);    
+        }
 
         /* Take the semaphore */
         app_LightSwitch_Ctrl.is_rdy_for_next_cmd ++;               
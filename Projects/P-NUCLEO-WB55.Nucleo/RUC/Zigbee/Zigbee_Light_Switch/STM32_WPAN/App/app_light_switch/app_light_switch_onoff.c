@@ -19,6 +19,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "stm32_seq.h"
 #include "app_light_switch_cfg.h"
+#include "app_nvm.h"
 
 /* Application Variable-------------------------------------------------------*/
 OnOff_Control_T app_OnOff_Control =
@@ -308,6 +309,7 @@ void App_Light_Switch_OnOff_Cmd(struct ZbApsAddrT * dst)
 {
   uint64_t epid = 0U;
   enum ZclStatusCodeT cmd_status;
+  struct ZbZclClusterCommandReqT req;
   
   /* Check that the Zigbee stack initialised */
   if(app_OnOff_Control.onoff_client->zb == NULL)
@@ -325,6 +327,9 @@ void App_Light_Switch_OnOff_Cmd(struct ZbApsAddrT * dst)
   {
     return;
   }
+
+  /* Keep the flash operations away from the command transmission */
+  App_NVM_Tx_Guard();
   
   /* No target specified, send cmd to all server binded */
   if ( dst == NULL )
@@ -341,20 +346,36 @@ void App_Light_Switch_OnOff_Cmd(struct ZbApsAddrT * dst)
         return;
       }      
       
-      /* Browse binding table to find target */
+      /* Browse binding table to find target: the commands are queued to the
+         M0 without waiting for each of them, the ones not queued are sent by
+         the blocking request */
+      memset(&req, 0, sizeof(req));
+      req.noDefaultResp = ZCL_NO_DEFAULT_RESPONSE_FALSE;
       for (uint8_t i = 0; i < app_OnOff_Control.bind_nb; i++)
       {
+        req.dst = app_OnOff_Control.bind_table[i];
+        
         /* Check value to send the correct command and not only Toggle */
         if  (app_OnOff_Control.On)
         {
           APP_ZB_DBG("CMD SENDING LED OFF");
-          cmd_status = ZbZclOnOffClientOffReq(app_OnOff_Control.onoff_client, &app_OnOff_Control.bind_table[i] , &App_Light_Switch_OnOff_Cmd_cb, NULL);
+          req.cmdId = ZCL_ONOFF_COMMAND_OFF;
+          cmd_status = ZbZclClusterCommandReqAsync(app_OnOff_Control.onoff_client, &req, &App_Light_Switch_OnOff_Cmd_cb, NULL);
+          if (cmd_status != ZCL_STATUS_SUCCESS)
+          {
+            cmd_status = ZbZclOnOffClientOffReq(app_OnOff_Control.onoff_client, &app_OnOff_Control.bind_table[i] , &App_Light_Switch_OnOff_Cmd_cb, NULL);
+          }
           app_OnOff_Control.cmd_send = 0;
         }
         else
         {
           APP_ZB_DBG("CMD SENDING LED ON");
-          cmd_status = ZbZclOnOffClientOnReq(app_OnOff_Control.onoff_client, &app_OnOff_Control.bind_table[i], &App_Light_Switch_OnOff_Cmd_cb, NULL);
+          req.cmdId = ZCL_ONOFF_COMMAND_ON;
+          cmd_status = ZbZclClusterCommandReqAsync(app_OnOff_Control.onoff_client, &req, &App_Light_Switch_OnOff_Cmd_cb, NULL);
+          if (cmd_status != ZCL_STATUS_SUCCESS)
+          {
+            cmd_status = ZbZclOnOffClientOnReq(app_OnOff_Control.onoff_client, &app_OnOff_Control.bind_table[i], &App_Light_Switch_OnOff_Cmd_cb, NULL);
+          }
           app_OnOff_Control.cmd_send = 1;
         }
        
@@ -21,6 +21,7 @@
 
 #include "app_zigbee.h"
 #include "app_core.h"
+#include "app_nvm.h"
 #include "app_light_switch_cfg.h"
 
 /* External variables ------------------------------------------------------- */
@@ -42,6 +43,7 @@ bool Menu_Config(void)
   // 1st level of menu
   Menu_Item_T * menu_reset= Create_Menu_Item();
   Menu_Item_T * menu_info = Create_Menu_Item();
+  Menu_Item_T * menu_nvm  = Create_Menu_Item();
 
   // Network Menu
   Menu_Item_T * menu_ntw            = Create_Menu_Item();
@@ -57,6 +59,11 @@ bool Menu_Config(void)
   Menu_Item_T * menu_light_toggle   = Create_Menu_Item();
   Menu_Item_T * menu_light_up       = Create_Menu_Item();  
   Menu_Item_T * menu_light_down     = Create_Menu_Item();  
+
+  // NVM Menu
+  Menu_Item_T * menu_nvm_stats        = Create_Menu_Item();
+  Menu_Item_T * menu_nvm_export_state = Create_Menu_Item();
+  Menu_Item_T * menu_nvm_export_pools = Create_Menu_Item();
   
   
   /* Menu link --------------------------------------------------------------*/
@@ -64,7 +71,8 @@ bool Menu_Config(void)
   Add_Menu_Item((char *) "Network"      , menu_ntw           , menu_light         , menu_ntw_join    , NULL);
   Add_Menu_Item((char *) "Light Ctrl"   , menu_light         , menu_reset         , menu_light_toggle, NULL);
   Add_Menu_Item((char *) "Factory Reset", menu_reset         , menu_info          , NULL             , &App_Core_Factory_Reset);
-  Add_Menu_Item((char *) "Global Infos" , menu_info          , menu_ntw           , NULL             , &App_Core_Infos_Disp);
+  Add_Menu_Item((char *) "Global Infos" , menu_info          , menu_nvm           , NULL             , &App_Core_Infos_Disp);
+  Add_Menu_Item((char *) "NVM"          , menu_nvm           , menu_ntw           , menu_nvm_stats   , NULL);
 
   // Network Menu
   Add_Menu_Item((char *) "Join Network" , menu_ntw_join      , menu_ntw_findbind  , NULL             , &App_Core_Ntw_Join);
@@ -79,6 +87,11 @@ bool Menu_Config(void)
   Add_Menu_Item((char *) "Level +"      , menu_light_up      , menu_light_down    , NULL             , &App_LightSwitch_Level_Up);
   Add_Menu_Item((char *) "Level -"      , menu_light_down    , menu_light_toggle  , NULL             , &App_LightSwitch_Level_Down);
 
+  // NVM Menu
+  Add_Menu_Item((char *) "NVM Stats"    , menu_nvm_stats       , menu_nvm_export_state, NULL, &App_NVM_Stats_Disp);
+  Add_Menu_Item((char *) "Export State" , menu_nvm_export_state, menu_nvm_export_pools, NULL, &App_NVM_Export_State);
+  Add_Menu_Item((char *) "Export Pools" , menu_nvm_export_pools, menu_nvm_stats       , NULL, &App_NVM_Export_Pools);
+
   return Def_Start_Menu_Item(menu_ntw);
 } /* Menu_config */
 
@@ -32,6 +32,7 @@ extern "C" {
 
 /* Exported functions ---------------------------------------------*/
 void APPE_Init( void );
+uint32_t APPE_GetResetFlags( void );
 
 #ifdef __cplusplus
 } /* extern "C" */
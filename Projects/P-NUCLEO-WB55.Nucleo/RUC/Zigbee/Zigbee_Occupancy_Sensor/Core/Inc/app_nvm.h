@@ -27,12 +27,13 @@ extern "C" {
 /* Includes ------------------------------------------------------------------*/
 #include "app_common.h"
 #include "zigbee_interface.h"
+#include "ee_cfg.h"
 
 /* Defines -----------------------------------------------------------*/
 
   /* 
-    CFG_EE_BANK0_SIZE is the size allocated for the EE bank0 it should be
-    the considered as the max Flash size for all computation and <= of the
+    The EE banks configuration (CFG_EE_BANKx_SIZE, CFG_EE_BANKx_MAX_NB) is
+    defined in ee_cfg.h. The total size of the banks shall be <= of the
     allocated size within the scatterfile in bytes
     
     CFG_NVM_BASE_ADDRESS : offset to add to the base flash address to get the 
@@ -44,23 +45,126 @@ extern "C" {
     ST_PERSIST_FLASH_DATA_OFFSET : offset in bytes of zigbee data
     (U8[4] for length  - 1st data[]...)
 
-    CFG_NB_OF_PAGE : Number of page of flash to use
-    
-    CFG_NVM_MAX_SIZE : Max allocable size in byte for NVM
-                    Flash size/8 * (number of element by page in byte)
+    ZIGBEE_DB_START_ADDR: beginning of zigbee NVM (in bank0)
+
+    APP_NVM_SNAPSHOT_xxx : the persistent data are saved alternately in two
+                    snapshots (A/B) of APP_NVM_SNAPSHOT_WORDS words. Each one
+                    starts with a header (APP_NVM_SNAPSHOT_MAGIC, generation
+                    number, CRC32 of the persistent data) written after the
+                    data. At startup, the valid snapshot with the highest
+                    generation is restored.
+                    The layout of the banks (bank0 of 14 pages, bank1) and of
+                    the snapshots is not compatible with the single 2-page
+                    bank of older firmwares, and their data are not migrated:
+                    the first EE_Init after such an update fails and formats
+                    the NVM, and the device has to join the network again
+
+    CFG_PERSIST_COMPRESS : when set, the persistent data are stored with a
+                    run length encoding of the zero bytes (if smaller). The
+                    stored length word then has APP_NVM_LEN_COMPRESSED set
+                    and is followed by the compressed length in bytes.
+                    Uncompressed images remain readable
+
+    APP_NVM_DATA_BANK : EE bank of the application data, each application
+                    defines the virtual addresses of its data in this bank,
+                    below APP_NVM_RECORD_BASE
+
+    APP_NVM_RECORD_xxx : keyed records of the application modules, stored in
+                    the application data bank from APP_NVM_RECORD_BASE. A
+                    record is a header word (ID, version, length in bytes)
+                    followed by two slots, each one a sequence number, the
+                    payload words and the CRC32 of the header, sequence
+                    number and payload. It is allocated at its first
+                    registration and found back from its ID at the next ones
+                    (a new place is allocated when its size changes). When
+                    dirty, the slot not holding the newest copy is written in
+                    one block (EE_WriteBlock) : a reset during the write
+                    leaves the previous copy loadable. A version change makes
+                    the stored copies not loadable.
+                    Up to APP_NVM_RECORD_MAX_NB records of at most
+                    APP_NVM_RECORD_MAX_SIZE bytes
+
+    CFG_PERSIST_SAVE_WINDOW_MS : the persistent data notifications from the
+                    stack are coalesced: the save is done when no other
+                    notification is received during this window (in ms)
+
+    CFG_PERSIST_SAVE_MAX_DELAY_MS : max delay (in ms) between a notification
+                    and the save of the persistent data
+
+    CFG_PERSIST_WARM_BOOT : after a software or watchdog reset, the persistent
+                    data are taken back from the RAM cache (.noinit) instead
+                    of flash when the cache is still valid: magic, length and
+                    CRC32 of the cache matching the newest snapshot
+
+    APP_NVM_TX_GUARD_MS : guard window (in ms) requested to the flash driver
+                    by App_NVM_Tx_Guard() before a command or report, so that
+                    no background flash erase or write delays its transmission.
+                    The coalesced save of the persistent data is postponed
+                    too, up to CFG_FD_GUARD_MAX_DEFER_MS after its max delay
 
-    ZIGBEE_DB_START_ADDR: beginning of zigbee NVM
+    CFG_NVM_TRANSFER : binary export and import of the NVM over the trace UART
+                    (needs CFG_DEBUG_TRACE), in frames of
+                    APP_NVM_FRAME_DATA_SIZE data bytes at most, sent every
+                    APP_NVM_FRAME_PERIOD_MS. Frame format (little endian) :
+                    0xA5 0x5A | type | sequence | payload length (16 bits) |
+                    payload | CRC32 of type to payload
+                    - START : source, 3 reserved bytes, image length (32 bits)
+                    - DATA  : offset in the image (32 bits), data bytes
+                    - END   : CRC32 of the whole image
+                    The sources are the stack state image (length word then
+                    ZbStateGet() data, the only one which can be imported)
+                    and the raw flash of the EE banks
 
-    CFG_EE_AUTO_CLEAN : Clean the flash automatically when needed
+    CFG_NVM_IMPORT : import of a stack state image (needs CFG_NVM_TRANSFER),
+                    for the applications giving the bytes received on the
+                    trace UART to App_NVM_Import_Rx(). The bytes are only
+                    buffered under interrupt (APP_NVM_RX_BUFFER_SIZE bytes, a
+                    power of 2), the frames being checked by the transfer task
   */ 
-#define CFG_NB_OF_PAGE                          (16U)
-#define CFG_EE_BANK0_SIZE                       (CFG_NB_OF_PAGE * HW_FLASH_PAGE_SIZE) 
 #define CFG_NVM_BASE_ADDRESS                    ( 0x70000U )
-#define CFG_EE_BANK0_MAX_NB                     (1000U)                  // In U32 words
-#define ST_PERSIST_MAX_ALLOC_SZ                 (4U*CFG_EE_BANK0_MAX_NB) // Max data in bytes
+#define ST_PERSIST_MAX_ALLOC_SZ                 (4000U)                  // Max data in bytes
 #define ST_PERSIST_FLASH_DATA_OFFSET            (4U)
 #define ZIGBEE_DB_START_ADDR                    (0U)
-#define CFG_EE_AUTO_CLEAN                       (1U)
+#define APP_NVM_SNAPSHOT_HDR_WORDS              (3U)
+#define APP_NVM_SNAPSHOT_MAGIC                  (0x5A42534EU)            // "ZBSN"
+#define APP_NVM_SNAPSHOT_WORDS                  (APP_NVM_SNAPSHOT_HDR_WORDS + (ST_PERSIST_MAX_ALLOC_SZ / 4U))
+#define APP_NVM_SNAPSHOT_ADDR(slot)             (ZIGBEE_DB_START_ADDR + ((slot) * APP_NVM_SNAPSHOT_WORDS))
+#define APP_NVM_DATA_BANK                       (1)
+#define APP_NVM_RECORD_BASE                     (16U)
+#define APP_NVM_RECORD_MAX_NB                   (8U)
+#define APP_NVM_RECORD_MAX_SIZE                 (64U)                    // in bytes
+#define APP_NVM_RECORD_ID_FREE                  (0xFFFFU)
+#define CFG_PERSIST_COMPRESS                    (1U)
+#define APP_NVM_LEN_COMPRESSED                  (0x80000000U)
+#define APP_NVM_ZIMAGE_OFFSET                   (8U)
+#define CFG_PERSIST_SAVE_WINDOW_MS              (500U)
+#define CFG_PERSIST_SAVE_MAX_DELAY_MS           (3000U)
+#define CFG_PERSIST_WARM_BOOT                   (1U)
+#define APP_NVM_CACHE_MAGIC                     (0x5A424348U)            // "ZBCH"
+#define APP_NVM_TX_GUARD_MS                     (100U)
+#define CFG_NVM_TRANSFER                        (1U)
+#ifndef CFG_NVM_IMPORT
+#define CFG_NVM_IMPORT                          (1U)
+#endif
+#define APP_NVM_RX_BUFFER_SIZE                  (512U)
+#define APP_NVM_FRAME_DATA_SIZE                 (128U)
+#define APP_NVM_FRAME_PERIOD_MS                 (20U)
+#define APP_NVM_FRAME_SOF0                      (0xA5U)
+#define APP_NVM_FRAME_SOF1                      (0x5AU)
+#define APP_NVM_FRAME_START                     (1U)
+#define APP_NVM_FRAME_DATA                      (2U)
+#define APP_NVM_FRAME_END                       (3U)
+#define APP_NVM_SOURCE_STATE                    (0U)
+#define APP_NVM_SOURCE_POOLS                    (1U)
+#define HW_TS_PERSIST_SAVE_WINDOW               (CFG_PERSIST_SAVE_WINDOW_MS * HW_TS_SERVER_1ms_NB_TICKS)
+
+#if ((ZIGBEE_DB_START_ADDR + (2U * APP_NVM_SNAPSHOT_WORDS)) > CFG_EE_BANK0_MAX_NB)
+#error "CFG_EE_BANK0_MAX_NB too small for the two persistence snapshots"
+#endif
+
+#if (APP_NVM_RECORD_BASE >= CFG_EE_BANK1_MAX_NB)
+#error "CFG_EE_BANK1_MAX_NB too small for the application records"
+#endif
 
 /* Exported Persistent Prototypes --------------------------------------------*/
 enum ZbStatusCodeT App_Startup_Persist(struct ZigBeeT *zb);
@@ -69,12 +173,32 @@ bool App_Persist_Save        (struct ZigBeeT *zb);
 void App_Persist_Delete      (void);
 void App_Persist_Completed_cb(enum ZbStatusCodeT status, void *arg);
 void App_Persist_Notify_cb   (struct ZigBeeT *zb, void *arg);
+void App_Persist_Flush       (void);
 
 /* Exported NVM Prototypes ---------------------------------------------------*/
-void App_NVM_Init (void);
+void App_NVM_Init (uint32_t reset_flags);
 bool App_NVM_Read (void);
 bool App_NVM_Write(void);
 void App_NVM_Erase(void);
+void App_NVM_Stats_Disp(void);
+void App_NVM_Tx_Guard  (void);
+void App_NVM_Shutdown  (void);
+
+/* Exported NVM Transfer Prototypes ------------------------------------------*/
+void App_NVM_Export_State(void);
+void App_NVM_Export_Pools(void);
+void App_NVM_Import_Start(void);
+bool App_NVM_Import_Rx   (uint8_t byte);
+
+/* Exported Application data Prototypes --------------------------------------*/
+bool App_NVM_Data_Read (uint16_t addr, uint32_t *data);
+bool App_NVM_Data_Write(uint16_t addr, uint32_t data);
+
+/* Exported Application records Prototypes -----------------------------------*/
+bool App_NVM_Record_Register(uint16_t id, uint8_t version, void *data, uint8_t len);
+bool App_NVM_Record_Load    (uint16_t id);
+bool App_NVM_Record_SetDirty(uint16_t id);
+void App_NVM_Record_Flush   (void);
 
 #ifdef __cplusplus
 } /* extern "C" */
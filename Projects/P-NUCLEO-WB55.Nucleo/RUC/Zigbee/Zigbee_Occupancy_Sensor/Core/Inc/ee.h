@@ -26,6 +26,8 @@
  * Its interface is defined below in this file ("ee.h").
  * Up to two independent banks can be configured.
  * Data granularity for store and read is one 32-bit word.
+ * Each word is stored with its virtual address and a CRC in a 64-bit flash
+ * element, or packed with consecutive ones in a wide element.
  * 
  * Configuration and dependencies
  * ------------------------------
@@ -69,6 +71,74 @@
  *       When set to 1, this setting forces EE_Clean to be called at end of
  *       EE_Write when needed.
  *
+ *     * CFG_EE_INDEX
+ *       When set to 1 (default), a RAM index giving the flash location of
+ *       the last value of each variable is built by EE_Init and kept up to
+ *       date by EE_Write, so that EE_Read does not need to search the flash.
+ *       It costs 2 bytes of RAM per variable (CFG_EE_BANKx_MAX_NB variables
+ *       per bank when defined, otherwise the maximum number of elements of
+ *       a pool).
+ *
+ *     * CFG_EE_STATS
+ *       When set to 1 (default), the erase count of each page and the number
+ *       of pool transfers of a bank are saved in the bank, in nb_pages + 1
+ *       reserved variables following the CFG_EE_BANKx_MAX_NB user variables
+ *       (or at the end of the pool if not defined). A page is counted when
+ *       it is set to ERASING state by a pool transfer, so that the counts are
+ *       saved by the same transfer. A format keeps them: when they were not
+ *       loaded since the reset, the highest values found in the pages of
+ *       the bank are taken before the erase.
+ *
+ *     * CFG_EE_CRC
+ *       Selection of the CRC computation of the elements:
+ *       0 (default): bitwise computation (reference implementation)
+ *       1: table lookup (512 bytes of constant data)
+ *       2: STM32 CRC peripheral (reserved to the EE module)
+ *       The CRC value is the same whatever the selection.
+ *
+ *     * CFG_EE_WIDE_NB
+ *       Maximum number of consecutive variables packed in a wide element
+ *       by EE_WriteBlock and the pool transfers (0 by default, at most 32).
+ *       A wide element is a header word (first virtual address, number of
+ *       variables and CRC) followed by the data, two per 64-bit flash word,
+ *       and by a trailer word (copy of the header, so that the pages can be
+ *       searched backward), instead of one 64-bit element per variable.
+ *       The wide elements are always read, whatever this setting: pages
+ *       written without them remain readable and the other way round.
+ *
+ *     * CFG_EE_FAST_INIT
+ *       When set to 1 (0 by default), the state of the banks (RAM index and
+ *       statistics included) is kept in a .noinit RAM section. After a call
+ *       to EE_Shutdown() and a reset, EE_Init() takes it back instead of
+ *       recovering it from flash, if it has not changed since and if the
+ *       pages around the write position of each bank still match it.
+ *
+ *     * CFG_EE_TIME()
+ *       Time stamp (e.g. a cycle counter) used to profile EE_Init() (see
+ *       EE_GetInitProfile). 0 by default: no profiling.
+ *
+ *
+ * Recovery time
+ * -------------
+ * The recovery of a bank by EE_Init() (no fast init) is bounded by:
+ * - search of the write page: 2 * nb_pages state reads (+ 1 state write
+ *   if a reset occurred between the state updates of a page change)
+ * - count of the write page: one pass on the page
+ * - RECEIVE write page (reset during a pool transfer): the transfer is
+ *   resumed, i.e. two passes on the pages of the other pool (highest
+ *   virtual address and RAM index), one search in the new pool per
+ *   variable present in the old one (without CFG_EE_INDEX: one search in
+ *   each pool per virtual address up to the highest one), and the writes
+ *   of the variables not transferred yet
+ * - RAM index and statistics: one pass on the pages of the active pool
+ *   (CFG_EE_INDEX), or one read per statistics variable otherwise
+ * - standby pool: each page not in ERASED or ERASING state (reset during
+ *   a transfer, before its old pages were set in ERASING state) is set in
+ *   ERASING state, one flash word write per page. No page is erased by
+ *   EE_Init(): the ERASING pages are erased by EE_CleanPage() or
+ *   EE_CleanPageAsync() (or by the next pool transfer)
+ * The time of each step is given by EE_GetInitProfile().
+ *
  *
  * Notes
  * -----
@@ -89,14 +159,52 @@ enum
   EE_CLEAN_NEEDED,  /* data is written but a "clean" is needed */
   EE_ERASE_ERROR,   /* an error occurs during flash erase */
   EE_WRITE_ERROR,   /* an error occurs during flash write */
-  EE_STATE_ERROR    /* state of flash is incoherent (needs clean or format) */
+  EE_STATE_ERROR,   /* state of flash is incoherent (needs clean or format) */
+  EE_CLEAN_QUEUED   /* a page erase is queued to the flash driver */
 };
 
+/* Status of a bank (see EE_GetStatus) */
+typedef struct
+{
+  uint8_t  standby_ready;   /* 1 if the standby pool is erased and checked */
+  uint8_t  standby_pages;   /* number of standby pool pages to prepare */
+  uint16_t free_elements;   /* flash words left before the next pool
+                               transfer */
+  uint16_t nb_sync_clean;   /* pool transfers which prepared the standby
+                               pool themselves */
+  uint16_t valid_elements;  /* user variables stored (RAM index only) */
+  uint16_t erase_min;       /* min erase count of the pages */
+  uint16_t erase_max;       /* max erase count of the pages */
+  uint32_t nb_transfers;    /* pool transfers (kept by a format) */
+  uint32_t user_elements;   /* elements written by the user since EE_Init */
+  uint32_t programmed_elements; /* flash words programmed since EE_Init
+                                   (pool transfers included) */
+} EE_Status_t;
+
+/* Profile of the last EE_Init of a bank (see EE_GetInitProfile), times in
+   CFG_EE_TIME() units */
+typedef struct
+{
+  uint8_t  fast_init;       /* 1 if the state has been taken back from RAM */
+  uint8_t  write_state;     /* state of the write page found (ACTIVE: 2,
+                               RECEIVE: 1) */
+  uint16_t dirty_pages;     /* standby pool pages found not erased */
+  uint32_t search;          /* search of the write page */
+  uint32_t count;           /* count of the elements of the pool */
+  uint32_t transfer;        /* resumed pool transfer (RECEIVE page) */
+  uint32_t index;           /* build of the RAM index */
+  uint32_t stats;           /* load of the statistics */
+  uint32_t total;           /* recovery of the bank (format or fast init
+                               of both banks: given for bank 0) */
+} EE_InitProfile_t;
+
 
 /*
  * EE_Init
  *
  * Initialization of EEPROM emulation module. It must be called once at reset.
+ * The standby pool of each bank is then not checked yet: it should be
+ * prepared in background with EE_CleanPage().
  *
  * format: 0 -> recover EE state from flash and restore the pages
  *              to a known good state in case of power loss.
@@ -115,6 +223,20 @@ enum
 extern int EE_Init( int format,
                     uint32_t base_address );
 
+/*
+ * EE_Shutdown
+ *
+ * Marks the state of the banks as cleanly shut down, so that the next
+ * EE_Init (after a reset, without power loss) takes it back from RAM
+ * instead of recovering it from flash (if CFG_EE_FAST_INIT is set).
+ * It must be called just before the reset, no write or clean pending: any
+ * later change of the state makes the next EE_Init do the full recovery.
+ *
+ * return: none
+ */
+
+extern void EE_Shutdown( void );
+
 /*
  * EE_Read
  *
@@ -139,7 +261,10 @@ extern int EE_Read( int bank, uint16_t addr, uint32_t* data );
  * EE_Write
  *
  * Writes/updates variable data in EEPROM emulator.
- * Triggers internal pages transfer if flash pool is full.
+ * Triggers internal pages transfer if flash pool is full. If the pool to be
+ * used for this transfer (the standby pool) is not ready yet (see
+ * EE_CleanPage), its erase and blank check are finished first (in polling
+ * mode).
  *
  * bank:   index of the bank (0 or 1)
  *
@@ -155,6 +280,58 @@ extern int EE_Read( int bank, uint16_t addr, uint32_t* data );
 
 extern int EE_Write( int bank, uint16_t addr, uint32_t data );
 
+/*
+ * EE_ReadBlock
+ *
+ * Returns the last stored data of a range of consecutive virtual addresses.
+ *
+ * bank:   index of the bank (0 or 1)
+ *
+ * addr:   virtual address of the first variable
+ *
+ * data:   pointer to a 32-bit buffer (allocated by the caller) where the
+ *         variables are written: variable from virtual address (addr+i) is
+ *         stored in data[i].
+ *
+ * size:   number of consecutive variables to read
+ *
+ * return: EE_OK in case of success
+ *         EE_NOT_FOUND in case one virtual address of the range has never
+ *                      been written to (reading is stopped)
+ *         EE..._ERROR in case of error
+ */
+
+extern int EE_ReadBlock( int bank, uint16_t addr, uint32_t* data,
+                         uint16_t size );
+
+/*
+ * EE_WriteBlock
+ *
+ * Writes/updates the data of a range of consecutive virtual addresses.
+ * The elements are programmed in flash by groups, each group with only one
+ * flash driver call (one semaphore take and one flash unlock).
+ * Triggers internal pages transfer if flash pool is full. As a block can
+ * fill the pool more than once, the obsolete pool is then cleaned (in
+ * polling mode) before being used again.
+ *
+ * bank:   index of the bank (0 or 1)
+ *
+ * addr:   virtual address of the first variable
+ *
+ * data:   pointer to the 32-bit data words to be written: data[i] is written
+ *         at virtual address (addr+i).
+ *
+ * size:   number of consecutive variables to write
+ *
+ * return: EE_OK in case of success
+ *         EE_CLEAN_NEEDED if success but user must trigger flash cleanup
+ *                         by calling EE_Clean() or EE_CleanPage()
+ *         EE..._ERROR in case of error
+ */
+
+extern int EE_WriteBlock( int bank, uint16_t addr,
+                          const uint32_t* data, uint16_t size );
+
 /*
  * EE_Clean
  *
@@ -177,6 +354,98 @@ extern int EE_Write( int bank, uint16_t addr, uint32_t data );
 
 extern int EE_Clean( int bank, int interrupt );
 
+/*
+ * EE_CleanPage
+ *
+ * Prepare one page of the obsolete pool of pages, the standby pool, for
+ * the next pool transfer (in polling mode).
+ * This function allows to split the clean requested by EE_Init(),
+ * EE_Write() or EE_WriteBlock() in smaller steps, e.g. run from a low
+ * priority task: it has to be called again as long as it returns
+ * EE_CLEAN_NEEDED.
+ * The pages are erased in descending order: the pool remains in ERASING
+ * state until its first page is erased. Then each page is checked to be
+ * fully blank (and erased again if not). If the pool is needed by a write
+ * before the end, the remaining steps are done by this write.
+ *
+ * bank:   index of the bank (0 or 1)
+ *
+ * return: EE_OK when the pool is fully erased and checked
+ *         EE_CLEAN_NEEDED if some pages of the pool remain to be prepared
+ *         EE..._ERROR in case of error
+ */
+
+extern int EE_CleanPage( int bank );
+
+/*
+ * EE_CleanPageAsync
+ *
+ * Same as EE_CleanPage() except that the erase of a page is not done in
+ * polling mode: it is queued to the flash driver (see FD_SubmitErase) and
+ * the function returns at once. The callback is called from the flash
+ * driver queue processing when the erase is done: EE_CleanPageAsync() has
+ * then to be called again. The blank check of a page is still done in
+ * polling mode.
+ * A write or an EE_CleanPage() needing the page before first processes the
+ * flash driver queue.
+ *
+ * bank:     index of the bank (0 or 1)
+ *
+ * callback: function called when the queued erase is done
+ *
+ * return: EE_OK when the pool is fully erased and checked
+ *         EE_CLEAN_NEEDED if some pages of the pool remain to be prepared
+ *         EE_CLEAN_QUEUED if a page erase is queued (wait for the callback)
+ *         EE..._ERROR in case of error
+ */
+
+extern int EE_CleanPageAsync( int bank, void (*callback)( void ) );
+
+/*
+ * EE_GetStatus
+ *
+ * Returns the status of the standby pool of a bank and its statistics.
+ * The write amplification of the bank is given by the ratio between the
+ * programmed elements and the user elements.
+ *
+ * bank:   index of the bank (0 or 1)
+ *
+ * status: pointer to a status structure (allocated by the caller)
+ *
+ * return: none
+ */
+
+extern void EE_GetStatus( int bank, EE_Status_t* status );
+
+/*
+ * EE_GetEraseCount
+ *
+ * Returns the erase count of a page of a bank (0 if CFG_EE_STATS is 0).
+ *
+ * bank:   index of the bank (0 or 1)
+ *
+ * page:   index of the page in the bank (0 to 2 * nb_pages - 1)
+ *
+ * return: number of erases of the page
+ */
+
+extern uint16_t EE_GetEraseCount( int bank, uint32_t page );
+
+/*
+ * EE_GetInitProfile
+ *
+ * Returns the time spent by each step of the last EE_Init for a bank
+ * (see CFG_EE_TIME).
+ *
+ * bank:    index of the bank (0 or 1)
+ *
+ * profile: pointer to a profile structure (allocated by the caller)
+ *
+ * return: none
+ */
+
+extern void EE_GetInitProfile( int bank, EE_InitProfile_t* profile );
+
 /*
  * EE_Dump
  *
@@ -23,5 +23,43 @@
 #include "hw_flash.h"
 #include "flash_driver.h"
 
+/*
+  EEPROM emulation configuration (see ee.h)
+
+  CFG_EE_BANK0_NB_OF_PAGE : Number of flash pages of bank0, used for the
+                  Zigbee stack persistence (ZbStateGet image)
+
+  CFG_EE_BANK1_NB_OF_PAGE : Number of flash pages of bank1, used for the
+                  application data (small values changing often). Bank1
+                  is located just after bank0 in flash
+
+  CFG_EE_BANKx_MAX_NB : Max number of U32 words stored in the bank
+ */
+#define CFG_EE_BANK0_NB_OF_PAGE    (14U)
+#define CFG_EE_BANK0_SIZE          (CFG_EE_BANK0_NB_OF_PAGE * HW_FLASH_PAGE_SIZE)
+#define CFG_EE_BANK0_MAX_NB        (2006U)    /* 2 snapshots of 1003 words */
+#define CFG_EE_BANK1_NB_OF_PAGE    (2U)
+#define CFG_EE_BANK1_SIZE          (CFG_EE_BANK1_NB_OF_PAGE * HW_FLASH_PAGE_SIZE)
+#define CFG_EE_BANK1_MAX_NB        (128U)     /* records stored twice (app_nvm.h) */
+
+/* Obsolete pages erased by a background task (see App_NVM_Clean_Task) */
+#define CFG_EE_AUTO_CLEAN          0
+
+/* Element CRC computed by the STM32 CRC peripheral */
+#ifndef CFG_EE_CRC
+#define CFG_EE_CRC                 2
+#endif
+
+/* Up to 32 consecutive words stored in one wide element (18 flash words
+   instead of 32) */
+#define CFG_EE_WIDE_NB             32
+
+/* State of the banks kept through a reset after EE_Shutdown (see
+   App_NVM_Shutdown) */
+#define CFG_EE_FAST_INIT           1
+
+/* EE_Init profiled with the cycle counter (enabled before EE_Init) */
+#define CFG_EE_TIME()              (DWT->CYCCNT)
+
 
 #endif /* EE_CFG_H__ */
@@ -33,6 +33,54 @@ extern "C" {
 
 /* USER CODE END Includes */
 
+/* Exported constants --------------------------------------------------------*/
+/**
+ * When set to 1, FD_SetPowerLoss() allows to reset the device just before a given flash operation,
+ * to check on target the recovery of the flash users (EEPROM emulation) after a power loss.
+ * It shall be kept to 0 in a product.
+ */
+#ifndef CFG_FD_POWER_LOSS_TEST
+#define CFG_FD_POWER_LOSS_TEST    0
+#endif
+
+/**
+ * Number of flash operations which can be queued with FD_SubmitErase() and FD_SubmitWrite()
+ */
+#ifndef CFG_FD_QUEUE_SIZE
+#define CFG_FD_QUEUE_SIZE         8
+#endif
+
+/**
+ * Max number of single flash operations (erase of one sector or write of one 64bits data)
+ * processed by one call of FD_ProcessQueue()
+ */
+#ifndef CFG_FD_QUEUE_BATCH_SIZE
+#define CFG_FD_QUEUE_BATCH_SIZE   32
+#endif
+
+/**
+ * Max delay in ms a queued single flash operation may be deferred by the guard windows requested
+ * with FD_DeferOperations(). Once elapsed, the operation is done even within a guard window (forced)
+ */
+#ifndef CFG_FD_GUARD_MAX_DEFER_MS
+#define CFG_FD_GUARD_MAX_DEFER_MS 1000
+#endif
+
+/**
+ * Delay in ms before FD_ProcessQueue() retries the queued operations not executed due to timing protection
+ * from either CPU1 or CPU2 (see FD_QueueDeferred())
+ */
+#ifndef CFG_FD_QUEUE_RETRY_MS
+#define CFG_FD_QUEUE_RETRY_MS     5
+#endif
+
+/**
+ * Flag set in the value returned by FD_EraseSectors() and FD_WriteData() when the queued operations on the same
+ * sectors, which shall be done first, have not been executed due to timing protection. In that case, none of the
+ * requested operations has been done, the Sem2 is released and the FLASH is locked
+ */
+#define FD_QUEUE_NOT_FLUSHED      0x80000000UL
+
 /* Exported types ------------------------------------------------------------*/
 typedef enum
 {
@@ -52,11 +100,34 @@ typedef enum
   WAIT_FOR_SEM_BLOCK_FLASH_REQ_BY_CPU2,
 }WaitedSemId_t;
 
+typedef struct
+{
+  uint32_t NbrOfWrites;         /* Number of 64bits data written */
+  uint32_t NbrOfErases;         /* Number of sectors erased */
+  uint32_t NbrOfNotExecuted;    /* Number of single operations not executed due to timing protection */
+  uint32_t NbrOfDeferred;       /* Number of times the queue processing has been deferred by a guard window */
+  uint32_t NbrOfForced;         /* Number of single operations done within a guard window (max defer delay
+                                   elapsed, or synchronous operation) */
+  uint32_t WriteTimeMin;        /* Min duration of a 64bits data write in us (waiting for the flash included) */
+  uint32_t WriteTimeMax;        /* Max duration of a 64bits data write in us */
+  uint32_t WriteTimeTotal;      /* Total duration of the 64bits data writes in us (average = total / NbrOfWrites) */
+  uint32_t EraseTimeMin;        /* Min duration of a sector erase in us (waiting for the flash included) */
+  uint32_t EraseTimeMax;        /* Max duration of a sector erase in us */
+  uint32_t EraseTimeTotal;      /* Total duration of the sector erases in us (average = total / NbrOfErases) */
+}FD_Statistics_t;
+
+/**
+ * Completion callback of a queued flash operation, called from FD_ProcessQueue() (or FD_FlushQueue())
+ * once all the single operations of the request have been processed
+ */
+typedef void (*FD_Callback_t)(void *pArg);
+
 /* Exported functions ------------------------------------------------------- */
 
   /**
    * @brief  Implements the Dual core algorithm to erase multiple sectors in flash with CPU1
    *         It calls for each sector to be erased the API FD_EraseSingleSector()
+   *         The queued operations on these sectors (and the ones queued before them) are processed first
    *
    * @param  FirstSector:   The first sector to be erased
    *                        This parameter must be a value between 0 and (SFSA - 1)
@@ -73,6 +144,9 @@ typedef enum
    *                        - The FLASH is NOT locked
    *                        - SHCI_C2_FLASH_EraseActivity(ERASE_ACTIVITY_OFF) is NOT called
    *                        It is expected that the user will call one more time this function to finish the process
+   *
+   *                        NbrOfSectors | FD_QUEUE_NOT_FLUSHED when the queued operations on these sectors
+   *                        could not be processed first: nothing has been done
    */
 uint32_t FD_EraseSectors(uint32_t FirstSector, uint32_t NbrOfSectors);
 
@@ -82,6 +156,7 @@ uint32_t FD_EraseSectors(uint32_t FirstSector, uint32_t NbrOfSectors);
    *         Otherwise, the API will loop for ever as it will be not able to write in flash
    *         The only value that can be written even though the destination is not erased is 0.
    *         It calls for each 64bits to be written the API FD_WriteSingleData()
+   *         The queued operations on the sectors written (and the ones queued before them) are processed first
    *
    * @param  DestAddress: Address of the flash to write the first data. It shall be 64bits aligned
    * @param  pSrcBuffer:  Address of the buffer holding the 64bits data to be written in flash
@@ -96,6 +171,9 @@ uint32_t FD_EraseSectors(uint32_t FirstSector, uint32_t NbrOfSectors);
    *                        - The Sem2 is NOT released
    *                        - The FLASH is NOT locked
    *                        It is expected that the user will call one more time this function to finish the process
+   *
+   *                      NbrOfData | FD_QUEUE_NOT_FLUSHED when the queued operations on the sectors written
+   *                      could not be processed first: nothing has been done
    */
   uint32_t FD_WriteData(uint32_t DestAddress, uint64_t * pSrcBuffer, uint32_t NbrOfData);
 
@@ -168,6 +246,134 @@ uint32_t FD_EraseSectors(uint32_t FirstSector, uint32_t NbrOfSectors);
    */
   WaitedSemStatus_t FD_WaitForSemAvailable(WaitedSemId_t WaitedSemId);
 
+  /**
+   * @brief  Returns the number and the durations of the flash operations processed since reset
+   *         (or since FD_ResetStatistics()). The durations are measured with the DWT cycle counter
+   *
+   * @param  pStatistics: Address of the structure filled with the counters
+   * @retval None
+   */
+  void FD_GetStatistics(FD_Statistics_t * pStatistics);
+
+  /**
+   * @brief  Queues the erase of multiple sectors, processed later by FD_ProcessQueue()
+   *         The erase of sectors following the last queued erase (same callback and argument) is merged with it.
+   *         FD_EraseSectors() and FD_WriteData() first process the queued operations up to the last one on the
+   *         same sectors, so that the operations on a sector are always done in the order of the requests.
+   *         The other queued operations are left to FD_ProcessQueue(), out of the synchronous operation.
+   *         This API shall be called from the application context (not under interrupt).
+   *
+   * @param  FirstSector:   The first sector to be erased
+   * @param  NbrOfSectors:  The number of sectors to erase
+   * @param  Callback:      Function called when the sectors are erased (may be NULL)
+   * @param  pArg:          Argument of the callback
+   * @retval 0 when the request is queued, 1 when the queue is full
+   */
+  uint32_t FD_SubmitErase(uint32_t FirstSector, uint32_t NbrOfSectors, FD_Callback_t Callback, void *pArg);
+
+  /**
+   * @brief  Queues the write of multiple 64bits data, processed later by FD_ProcessQueue()
+   *         The write following the last queued write in flash and in the source buffer (same callback and argument)
+   *         is merged with it.
+   *         The source buffer shall remain valid until the callback is called.
+   *         This API shall be called from the application context (not under interrupt).
+   *
+   * @param  DestAddress: Address of the flash to write the first data. It shall be 64bits aligned
+   * @param  pSrcBuffer:  Address of the buffer holding the 64bits data to be written in flash
+   * @param  NbrOfData:   Number of 64bits data to be written
+   * @param  Callback:    Function called when the data are written (may be NULL)
+   * @param  pArg:        Argument of the callback
+   * @retval 0 when the request is queued, 1 when the queue is full
+   */
+  uint32_t FD_SubmitWrite(uint32_t DestAddress, uint64_t * pSrcBuffer, uint32_t NbrOfData,
+                          FD_Callback_t Callback, void *pArg);
+
+  /**
+   * @brief  Processes a batch of the queued flash operations (up to CFG_FD_QUEUE_BATCH_SIZE single operations)
+   *         The semaphore, the flash unlock and the erase activity notification to the CPU2 are done once
+   *         for the whole batch. The callbacks of the completed requests are called at the end of the batch.
+   *         When operations remain in the queue, FD_QueueNotify() is called again. When they are deferred by a
+   *         guard window or not executed due to timing protection, FD_QueueDeferred() is called instead
+   *         (with CFG_FD_QUEUE_RETRY_MS in the latter case).
+   *         This API is intended to be run by a sequencer task, scheduled from FD_QueueNotify().
+   *
+   * @param  None
+   * @retval None
+   */
+  void FD_ProcessQueue(void);
+
+  /**
+   * @brief  Processes all the queued flash operations in polling mode
+   *
+   * @param  None
+   * @retval Number of requests left in the queue (not executed due to timing protection)
+   */
+  uint32_t FD_FlushQueue(void);
+
+  /**
+   * By default, this function is implemented weakly in flash_driver.c to do nothing.
+   * It is called when flash operations are queued and shall be implemented by the application
+   * to schedule the call of FD_ProcessQueue() (e.g. with UTIL_SEQ_SetTask()).
+   * It may be called under FD_SubmitErase(), FD_SubmitWrite() and FD_ProcessQueue().
+   *
+   * @param  None
+   * @retval None
+   */
+  void FD_QueueNotify(void);
+
+  /**
+   * @brief  Requests a guard window: no queued flash operation is started during the next DelayMs ms,
+   *         e.g. before a radio transmission or poll which should not be delayed by a flash erase.
+   *         The queued operations are deferred up to CFG_FD_GUARD_MAX_DEFER_MS, then forced.
+   *         The synchronous operations (FD_EraseSectors(), FD_WriteData(), FD_FlushQueue()) are not deferred:
+   *         their callers may check FD_GetGuardTimeLeft() to postpone them.
+   *         A new request extends the current window, never shortens it.
+   *         This API may be called under interrupt.
+   *
+   * @param  DelayMs: Duration of the guard window in ms from now
+   * @retval None
+   */
+  void FD_DeferOperations(uint32_t DelayMs);
+
+  /**
+   * @brief  Returns the time left in the current guard window requested by FD_DeferOperations().
+   *         This API may be called under interrupt.
+   *
+   * @param  None
+   * @retval Time left in ms, 0 when no guard window is open
+   */
+  uint32_t FD_GetGuardTimeLeft(void);
+
+  /**
+   * By default, this function is implemented weakly in flash_driver.c to call FD_QueueNotify().
+   * It is called by FD_ProcessQueue() when the queued operations are deferred by a guard window or not executed
+   * due to timing protection, and should be implemented by the application to schedule the call of
+   * FD_ProcessQueue() only after DelayMs ms (e.g. with a timer) instead of retrying at once.
+   *
+   * @param  DelayMs: Delay in ms before the queued operations can be processed
+   * @retval None
+   */
+  void FD_QueueDeferred(uint32_t DelayMs);
+
+  /**
+   * @brief  Resets the counters of flash operations
+   *
+   * @param  None
+   * @retval None
+   */
+  void FD_ResetStatistics(void);
+
+#if (CFG_FD_POWER_LOSS_TEST != 0)
+  /**
+   * @brief  Simulates a power loss: the device is reset just before the Nth next single flash operation
+   *         (erase of one sector or write of one 64bits data)
+   *
+   * @param  NbrOfOperations: Number of single flash operations before the reset (0 to cancel)
+   * @retval None
+   */
+  void FD_SetPowerLoss(uint32_t NbrOfOperations);
+#endif /* CFG_FD_POWER_LOSS_TEST != 0 */
+
 
 #ifdef __cplusplus
 }
@@ -30,6 +30,7 @@
 #include "app_entry.h"
 #include "app_zigbee.h"
 #include "app_core.h"
+#include "app_nvm.h"
 #include "pir_parallax.h"
 
 /* Private includes -----------------------------------------------------------*/
@@ -45,6 +46,9 @@ PLACE_IN_SECTION("MB_MEM2") ALIGN(4) static uint8_t EvtPool[POOL_SIZE];
 PLACE_IN_SECTION("MB_MEM2") ALIGN(4) static TL_CmdPacket_t SystemCmdBuffer;
 PLACE_IN_SECTION("MB_MEM2") ALIGN(4) static uint8_t SystemSpareEvtBuffer[sizeof(TL_PacketHeader_t) + TL_EVT_HDR_SIZE + 255U];
 
+/* Reset cause (RCC_CSR reset flags), read once at startup */
+static uint32_t ResetFlags;
+
 /* Global function prototypes -----------------------------------------------*/
 size_t __write(int handle, const unsigned char *buf, size_t bufSize);
 
@@ -84,6 +88,14 @@ EXTI_HandleTypeDef exti_handle;
 /* Functions Definition ------------------------------------------------------*/
 void APPE_Init( void )
 {
+  /**
+   * Reset cause kept for the application, the flags being cleared to get
+   * only the cause of the next reset
+   */
+  ResetFlags = READ_BIT(RCC->CSR, RCC_CSR_LPWRRSTF | RCC_CSR_WWDGRSTF | RCC_CSR_IWDGRSTF | RCC_CSR_SFTRSTF |
+                                  RCC_CSR_BORRSTF | RCC_CSR_PINRSTF | RCC_CSR_OBLRSTF);
+  __HAL_RCC_CLEAR_RESET_FLAGS();
+
   SystemPower_Config(); /**< Configure the system Power Mode */
 
   HW_TS_Init(hw_ts_InitMode_Full, &hrtc); /**< Initialize the TimerServer */
@@ -107,6 +119,16 @@ void APPE_Init( void )
   return;
 }
 
+/**
+ * @brief  Reset cause, read at startup
+ * @param  None
+ * @retval RCC_CSR reset flags (RCC_CSR_xxxRSTF)
+ */
+uint32_t APPE_GetResetFlags( void )
+{
+  return ResetFlags;
+}
+
 
 /*************************************************************
  *
@@ -461,6 +483,13 @@ static void RxUART_Init(void)
 
 static void RxCpltCallback(void)
 {
+  /* Binary frames of an NVM import */
+  if (App_NVM_Import_Rx(aRxBuffer[0]))
+  {
+    HW_UART_Receive_IT(CFG_DEBUG_TRACE_UART, aRxBuffer, 1U, RxCpltCallback);
+    return;
+  }
+
   /* Filling buffer and wait for '\r' char */
   if (indexReceiveChar < C_SIZE_CMD_STRING)
   {
@@ -505,6 +534,11 @@ static void UartCmdExecute(void)
     exti_handle.Line = EXTI_LINE_1;
     HAL_EXTI_GenerateSWI(&exti_handle);
   }
+  else if (strcmp((char const*)CommandString, "NVMIMPORT") == 0)
+  {
+    APP_ZB_DBG("NVMIMPORT OK");
+    App_NVM_Import_Start();
+  }
   else
   {
     APP_ZB_DBG("NOT RECOGNIZED COMMAND : %s", CommandString);
@@ -19,6 +19,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "pir_parallax.h"
 #include "app_occupancy_sensor.h"
+#include "app_nvm.h"
 
 #include "stm32_seq.h"
 
@@ -104,6 +105,8 @@ void App_Occupancy_Sensor_ConfigGroupAddr(void)
 
 /**
  * @brief Restore the state after persitance data loaded
+ *        Nothing kept in an application record (app_nvm.h) : the occupancy
+ *        is sensed again by the PIR and the other attributes are constants
  * 
  */
 void App_Occupancy_Sensor_Restore_State(void)
@@ -153,6 +156,8 @@ void App_Occupancy_Sensor_detect(void)
   
   APP_ZB_DBG("PIR detection start");
   app_Occupancy.Occupancy = 1;
+  /* Keep the flash operations away from the occupancy report */
+  App_NVM_Tx_Guard();
   status = ZbZclAttrIntegerWrite(app_Occupancy.occupancy_server, ZCL_OCC_ATTR_OCCUPANCY, 1);
   if (status != ZCL_STATUS_SUCCESS)
     APP_ZB_DBG("Error during writing ATTRIBUTE ZCL_OCC_ATTR_OCCUPANCY");
@@ -174,6 +179,7 @@ void App_Occupancy_Sensor_Refresh(void)
   {
     APP_ZB_DBG("PIR detection end");
     app_Occupancy.Occupancy = 0;
+    App_NVM_Tx_Guard();
     status = ZbZclAttrIntegerWrite(app_Occupancy.occupancy_server, ZCL_OCC_ATTR_OCCUPANCY, 0);
     if (status != ZCL_STATUS_SUCCESS)
       APP_ZB_DBG("Error during writing ATTRIBUTE ZCL_OCC_ATTR_OCCUPANCY");
@@ -21,6 +21,7 @@
 
 #include "app_zigbee.h"
 #include "app_core.h"
+#include "app_nvm.h"
 #include "app_onoff_sensor.h"
 
 /* External variables ------------------------------------------------------- */
@@ -45,6 +46,7 @@ bool Menu_Config(void)
   // 1st level of menu
   Menu_Item_T * menu_reset= Create_Menu_Item();
   Menu_Item_T * menu_info = Create_Menu_Item();
+  Menu_Item_T * menu_nvm  = Create_Menu_Item();
 
   // Network Menu
   Menu_Item_T * menu_ntw            = Create_Menu_Item();
@@ -57,13 +59,19 @@ bool Menu_Config(void)
 
   // Occupancy control Menu
   Menu_Item_T * menu_PIR            = Create_Menu_Item();
+
+  // NVM Menu
+  Menu_Item_T * menu_nvm_stats        = Create_Menu_Item();
+  Menu_Item_T * menu_nvm_export_state = Create_Menu_Item();
+  Menu_Item_T * menu_nvm_export_pools = Create_Menu_Item();
   
   /* Menu link --------------------------------------------------------------*/
   // Main menu --------|  Menu name     | Current Item       | Next Item          | Sub-Menu         | Action to launch        |
   Add_Menu_Item((char *) "Network"      , menu_ntw           , menu_PIR           , menu_ntw_join    , NULL);
   Add_Menu_Item((char *) "Light detect" , menu_PIR           , menu_reset         , NULL             , &App_OnOff_Sensor_Toggle_Cmd);
   Add_Menu_Item((char *) "Factory Reset", menu_reset         , menu_info          , NULL             , &App_Core_Factory_Reset);
-  Add_Menu_Item((char *) "Global Infos" , menu_info          , menu_ntw           , NULL             , &App_Core_Infos_Disp);
+  Add_Menu_Item((char *) "Global Infos" , menu_info          , menu_nvm           , NULL             , &App_Core_Infos_Disp);
+  Add_Menu_Item((char *) "NVM"          , menu_nvm           , menu_ntw           , menu_nvm_stats   , NULL);
 
   // Network Menu
   Add_Menu_Item((char *) "Join Network" , menu_ntw_join      , menu_ntw_findbind  , NULL             , &App_Core_Ntw_Join);
@@ -72,6 +80,11 @@ bool Menu_Config(void)
   Add_Menu_Item((char *) "Tx Power Disp", menu_ntw_txpwr_disp, menu_ntw_txpwr_up  , NULL             , &App_Zigbee_TxPwr_Disp);
   Add_Menu_Item((char *) "Tx Power +"   , menu_ntw_txpwr_up  , menu_ntw_txpwr_down, NULL             , &App_Zigbee_TxPwr_Up);
   Add_Menu_Item((char *) "Tx Power -"   , menu_ntw_txpwr_down, menu_ntw_join      , NULL             , &App_Zigbee_TxPwr_Down);
+
+  // NVM Menu
+  Add_Menu_Item((char *) "NVM Stats"    , menu_nvm_stats       , menu_nvm_export_state, NULL, &App_NVM_Stats_Disp);
+  Add_Menu_Item((char *) "Export State" , menu_nvm_export_state, menu_nvm_export_pools, NULL, &App_NVM_Export_State);
+  Add_Menu_Item((char *) "Export Pools" , menu_nvm_export_pools, menu_nvm_stats       , NULL, &App_NVM_Export_Pools);
   
   return Def_Start_Menu_Item(menu_ntw);
 } /* Menu_config */
@@ -19,6 +19,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "pir_parallax.h"
 #include "app_onoff_sensor.h"
+#include "app_nvm.h"
 
 #include "stm32_seq.h"
 
@@ -493,6 +494,9 @@ void App_OnOff_Sensor_Toggle_Cmd(void)
   {
     return;
   }
+
+  /* Keep the flash operations away from the command transmission */
+  App_NVM_Tx_Guard();
   
   /* Browse binding table to find target */
   for (uint8_t i = 0; i < app_OnOff_Control.bind_nb; i++)
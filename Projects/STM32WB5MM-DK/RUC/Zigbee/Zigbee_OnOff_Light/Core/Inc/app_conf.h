@@ -68,6 +68,11 @@
  */
 #define CFG_DEBUG_TRACE_UART    hw_uart1
 #define CFG_CONSOLE_MENU      0
+
+/**
+ * No reception on the trace UART : no NVM import (see app_nvm.h)
+ */
+#define CFG_NVM_IMPORT        0
 /******************************************************************************
  * USB interface
  ******************************************************************************/
@@ -191,6 +196,9 @@ typedef enum
 {
   CFG_TIM_PROC_ID_ISR,
   CFG_TIM_WAIT_BEFORE_READ_ATTR,
+  CFG_TIM_PERSIST_SAVE,
+  CFG_TIM_NVM_TRANSFER,
+  CFG_TIM_FLASH_OPS,
   CFG_TIM_SAMPLE_TOUCHKEY_STATUS,
   CFG_TIM_TOUCHKEY_BRIGHTNESS_LEVEL,
   CFG_TIM_MENU_REFRESH,
@@ -310,6 +318,12 @@ typedef enum
   CFG_TASK_BUTTON_SW2,
   CFG_TASK_LIGHT_UPDATE,
   CFG_TASK_LCD_CLEAN_STATUS,
+  CFG_TASK_PERSIST_SAVE,
+  CFG_TASK_NVM_CLEAN,
+  CFG_TASK_FLASH_OPS,
+  CFG_TASK_NVM_TRANSFER,
+  CFG_TASK_NVM_RECORDS,
+  CFG_TASK_ZIGBEE_CMD_DONE,
 #if (CFG_USB_INTERFACE_ENABLE != 0)
   CFG_TASK_VCP_SEND_DATA,
 #endif /* (CFG_USB_INTERFACE_ENABLE != 0) */
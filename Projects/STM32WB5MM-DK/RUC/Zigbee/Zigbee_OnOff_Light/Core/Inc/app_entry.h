@@ -36,6 +36,7 @@ extern "C" {
 void MX_APPE_Config( void );
 void MX_APPE_Init( void );
 void MX_APPE_Process( void );
+uint32_t APPE_GetResetFlags( void );
 void Init_Exti( void );
 void Init_Smps( void );
 
@@ -55,6 +55,9 @@ PLACE_IN_SECTION("MB_MEM2") ALIGN(4) static uint8_t EvtPool[POOL_SIZE];
 PLACE_IN_SECTION("MB_MEM2") ALIGN(4) static TL_CmdPacket_t SystemCmdBuffer;
 PLACE_IN_SECTION("MB_MEM2") ALIGN(4) static uint8_t SystemSpareEvtBuffer[sizeof(TL_PacketHeader_t) + TL_EVT_HDR_SIZE + 255U];
 
+/* Reset cause (RCC_CSR reset flags), read once at startup */
+static uint32_t ResetFlags;
+
 /* Global function prototypes -----------------------------------------------*/
 #if(CFG_DEBUG_TRACE != 0)
 size_t DbgTraceWrite(int handle, const unsigned char * buf, size_t bufSize);
@@ -90,6 +93,14 @@ static void LCD_DisplayInit(void);
 /* Functions Definition ------------------------------------------------------*/
 void MX_APPE_Config( void )
 {
+  /**
+   * Reset cause kept for the application, the flags being cleared to get
+   * only the cause of the next reset
+   */
+  ResetFlags = READ_BIT(RCC->CSR, RCC_CSR_LPWRRSTF | RCC_CSR_WWDGRSTF | RCC_CSR_IWDGRSTF | RCC_CSR_SFTRSTF |
+                                  RCC_CSR_BORRSTF | RCC_CSR_PINRSTF | RCC_CSR_OBLRSTF);
+  __HAL_RCC_CLEAR_RESET_FLAGS();
+
   /**
    * The OPTVERR flag is wrongly set at power on
    * It shall be cleared before using any HAL_FLASH_xxx() api
@@ -141,6 +152,16 @@ void MX_APPE_Init( void )
   return;
 }
 
+/**
+ * @brief  Reset cause, read at startup
+ * @param  None
+ * @retval RCC_CSR reset flags (RCC_CSR_xxxRSTF)
+ */
+uint32_t APPE_GetResetFlags( void )
+{
+  return ResetFlags;
+}
+
 void Init_Smps(void)
 {
 #if (CFG_USE_SMPS != 0)
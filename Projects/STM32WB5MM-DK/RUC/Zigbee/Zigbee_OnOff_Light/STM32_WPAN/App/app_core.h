@@ -59,6 +59,7 @@ void App_Core_Init           (void);
 void App_Core_ConfigEndpoints(void);
 void App_Core_ConfigGroupAddr(void);
 void App_Core_Restore_State  (void);
+void App_Core_Fast_Restore   (void);
 
 /* Action from menu */
 void App_Core_Infos_Disp     (void);
@@ -37,9 +37,20 @@ Light_Control_T app_Light_Control;
 /* Timer definitions */
 // static uint8_t TS_ID_IDENTIFY_MODE;
 
+/* First correct light output since reset */
+static bool     light_output_done;
+static uint32_t light_output_tick;
+
+/* Light state saved in NVM */
+static App_Light_Record_T light_record;
+static bool               light_record_init;
+static bool               light_record_valid;
+
 /* Finding&Binding function Declaration --------------------------------------*/
 static void App_Light_Identify_cb(struct ZbZclClusterT *cluster, enum ZbZclIdentifyServerStateT state, void *arg);
 static void App_Light_FindBind_cb(enum ZbStatusCodeT status, void *arg);
+static void App_Light_Output_Done(const char *source);
+static void App_Light_Record_Init(void);
 
 /* Clusters CFG ------------------------------------------------------------ */
 /**
@@ -272,7 +283,7 @@ enum ZclStatusCodeT App_Light_Restore_State(void)
     return ZCL_STATUS_FAILURE;
   if (App_Light_Level_Restore_State() != ZCL_STATUS_SUCCESS)
     return ZCL_STATUS_FAILURE;
-  APP_ZB_DBG("Read back cluster information : SUCCESS");  
+  APP_ZB_DBG("Read back cluster information : SUCCESS (%d ms from reset)", HAL_GetTick());  
   
   App_Light_Refresh();
   App_Zigbee_Bind_Disp();
@@ -280,6 +291,90 @@ enum ZclStatusCodeT App_Light_Restore_State(void)
   return ZCL_STATUS_SUCCESS;
 } /* App_Light_Restore_State */
 
+/**
+ * @brief  Restore the light output at startup from the application record
+ *         (on/off, level and colour), before the Zigbee stack start-up.
+ *         The clusters are restored later from the stack persistence.
+ * @param  None
+ * @retval None
+ */
+void App_Light_Fast_Restore(void)
+{
+  const App_Light_Record_T *record = App_Light_Record_Get();
+
+  if (record == NULL)
+  {
+    APP_ZB_DBG("No light record to restore");
+    return;
+  }
+
+  if (record->on != 0U)
+  {
+    LED_Set_rgb(record->red, record->green, record->blue);
+    APP_ZB_DBG("Light record : ON - Level 0x%02x - Colour 0x%02x%02x%02x",
+                record->level, record->blue, record->green, record->red);
+  }
+  else
+  {
+    LED_Off();
+    APP_ZB_DBG("Light record : OFF");
+  }
+
+  App_Light_Output_Done("light record");
+} /* App_Light_Fast_Restore */
+
+/**
+ * @brief  Get the light state saved in NVM
+ * @param  None
+ * @retval light record, NULL if none saved
+ */
+const App_Light_Record_T * App_Light_Record_Get(void)
+{
+  App_Light_Record_Init();
+  return (light_record_valid ? &light_record : NULL);
+} /* App_Light_Record_Get */
+
+/**
+ * @brief  Register and load the light record, once. Without record (first
+ *         start-up), the light is restored from the persistent attributes at
+ *         the stack start-up only
+ * @param  None
+ * @retval None
+ */
+static void App_Light_Record_Init(void)
+{
+  if (light_record_init)
+  {
+    return;
+  }
+  light_record_init = true;
+
+  if (App_NVM_Record_Register(APP_NVM_LIGHT_RECORD_ID, APP_NVM_LIGHT_RECORD_VERSION,
+                              &light_record, sizeof(light_record)) == false)
+  {
+    APP_ZB_DBG("Light record not registered");
+    return;
+  }
+
+  light_record_valid = App_NVM_Record_Load(APP_NVM_LIGHT_RECORD_ID);
+} /* App_Light_Record_Init */
+
+/**
+ * @brief  Trace the time of the first correct light output from reset
+ * @param  source origin of the output
+ * @retval None
+ */
+static void App_Light_Output_Done(const char *source)
+{
+  if (light_output_done == false)
+  {
+    /* HAL tick counts the ms from HAL_Init, just after reset */
+    light_output_done = true;
+    light_output_tick = HAL_GetTick();
+    APP_ZB_DBG("First light output from %s : %d ms from reset", source, light_output_tick);
+  }
+} /* App_Light_Output_Done */
+
 /* Light Device Application ------------------------------------------------- */
 /**
  * @brief Refresh the Light status from the attribut of the clusters
@@ -299,6 +394,20 @@ void App_Light_Refresh(void)
     HAL_Delay(10);
     LED_Off();
   }
+  App_Light_Output_Done("clusters");
+
+  /* Save the light state in its application record */
+  App_Light_Record_Init();
+  light_record.on    = app_Light_Control.app_OnOff->On;
+  light_record.level = app_Light_Control.app_Level->level;
+  if (app_Light_Control.app_OnOff->On)
+  {
+    light_record.red   = app_Light_Control.app_Level->level;
+    light_record.green = app_Light_Control.app_Level->level;
+    light_record.blue  = app_Light_Control.app_Level->level;
+  }
+  light_record_valid = true;
+  (void) App_NVM_Record_SetDirty(APP_NVM_LIGHT_RECORD_ID);
 } /* App_Light_Refresh */
 
 /**
@@ -29,12 +29,25 @@ extern "C" {
 #define LIGHT_ENDPOINT          0x0001U
 #define LIGHT_GROUP_ADDR        0x0001U
 
+/* Types ------------------------------------------------------------------- */
+/* Light state saved in the application record */
+typedef struct
+{
+  uint8_t on;
+  uint8_t level;
+  uint8_t red;
+  uint8_t green;
+  uint8_t blue;
+} App_Light_Record_T;
+
 /* Exported Prototypes -------------------------------------------------------*/
 void App_Light_Cfg_Endpoint   (struct ZigBeeT *zb);
 void App_Light_ConfigGroupAddr(void);
 void App_Light_IdentifyMode   (void);
 void App_Light_FindBind       (void);
 enum ZclStatusCodeT App_Light_Restore_State(void);
+void App_Light_Fast_Restore   (void);
+const App_Light_Record_T * App_Light_Record_Get(void);
 void App_Light_Refresh        (void);
 void App_Light_Toggle         (void);
 void App_Light_Up             (void);
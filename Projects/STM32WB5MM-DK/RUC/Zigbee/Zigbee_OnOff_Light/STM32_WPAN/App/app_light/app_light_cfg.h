@@ -28,6 +28,7 @@ extern "C" {
 #include "app_common.h"
 #include "app_entry.h"
 #include "zigbee_interface.h"
+#include "app_nvm.h"
 
 /* Debug Part */
 #include "stm_logging.h"
@@ -47,6 +48,11 @@ extern "C" {
 #include "app_light_level.h"
 #include "app_light_occupancy.h"
 
+/* Defines ----------------------------------------------------------------- */
+/* Application record of the light (App_Light_Record_T) */
+#define APP_NVM_LIGHT_RECORD_ID         (0x4C01U)
+#define APP_NVM_LIGHT_RECORD_VERSION    (1U)
+
 /* Types ------------------------------------------------------------------- */
 typedef struct
 {
@@ -48,12 +48,12 @@ enum ZclStatusCodeT light_level_server_stop_cb(
   struct ZbZclClusterT *clusterPtr, struct ZbZclLevelClientStopReqT *req, struct ZbZclAddrInfoT *srcInfo, void *arg);
 
 /* Application Variable------------------------------------------------------ */
-/* Level Attributes persistent flag set */
+/* Level Attributes (saved by the application in NVM, not in the stack persistence) */
 static const struct ZbZclAttrT zcl_levelcontrol_server_attr_list[] =
 {
   {
     ZCL_LEVEL_ATTR_CURRLEVEL, ZCL_DATATYPE_UNSIGNED_8BIT,
-    ZCL_ATTR_FLAG_REPORTABLE | ZCL_ATTR_FLAG_PERSISTABLE, 0, NULL, {0, 0}, {0, 0}
+    ZCL_ATTR_FLAG_REPORTABLE, 0, NULL, {0, 0}, {0, 0}
   },
 };
 
@@ -96,27 +96,28 @@ Level_Control_T * App_Light_Level_Cfg(struct ZigBeeT *zb)
  */
 enum ZclStatusCodeT App_Light_Level_Restore_State(void)
 {
-  enum ZclStatusCodeT status = ZCL_STATUS_FAILURE;
+  const App_Light_Record_T *record = App_Light_Record_Get();
+  enum ZclStatusCodeT status;
 
-  status = ZbZclAttrRead(app_Level.level_server, ZCL_LEVEL_ATTR_CURRLEVEL, NULL,
-                       &(app_Level.level), sizeof(app_Level.level), false);
-  
-  /* Locally manage error if possible */
-  switch(status)
+  /* Read back the level saved by the application. None yet (first start-up
+     or NVM formatted) : the cluster keeps its default level, saved with the
+     next refresh */
+  if (record == NULL)
   {
-    case ZCL_STATUS_UNSUPP_ATTRIBUTE :
-    case ZCL_STATUS_UNREPORTABLE_ATTRIBUTE :
-    case ZCL_STATUS_INSUFFICIENT_SPACE :
-    case ZCL_STATUS_FAILURE :
-      APP_ZB_DBG("Read back cluster information : FAILED");
-      status = ZCL_STATUS_FAILURE;
-      break;
-    default :
-      status = ZCL_STATUS_SUCCESS;
-      break;
+    long long value = ZbZclAttrIntegerRead(app_Level.level_server, ZCL_LEVEL_ATTR_CURRLEVEL, NULL, &status);
+
+    if (status == ZCL_STATUS_SUCCESS)
+    {
+      app_Level.level = (uint8_t)value;
+    }
+    APP_ZB_DBG("No Level saved : default 0x%02x", app_Level.level);
+    return ZCL_STATUS_SUCCESS;
   }
 
-  return status;
+  app_Level.level = record->level;
+  (void) ZbZclAttrIntegerWrite(app_Level.level_server, ZCL_LEVEL_ATTR_CURRLEVEL, app_Level.level);
+
+  return ZCL_STATUS_SUCCESS;
 }/* App_Light_Level_Restore_State */
 
 /* Level callbacks Definition ----------------------------------------------- */
@@ -33,12 +33,12 @@ OnOff_Control_T app_OnOff =
   .On = 0U,
 };
 
-/* On Off  Attributes persistent flag set */
+/* On Off  Attributes (saved by the application in NVM, not in the stack persistence) */
 const struct ZbZclAttrT zcl_onoff_server_attr_list[] = 
 {
   {
     ZCL_ONOFF_ATTR_ONOFF, ZCL_DATATYPE_BOOLEAN,
-    ZCL_ATTR_FLAG_REPORTABLE|ZCL_ATTR_FLAG_PERSISTABLE, 0, NULL, {0, 0}, {0, 0}
+    ZCL_ATTR_FLAG_REPORTABLE, 0, NULL, {0, 0}, {0, 0}
   },
 };
 
@@ -80,27 +80,28 @@ OnOff_Control_T * App_Light_OnOff_Cfg(struct ZigBeeT *zb)
  */
 enum ZclStatusCodeT App_Light_OnOff_Restore_State(void)
 {
-  enum ZclStatusCodeT status = ZCL_STATUS_FAILURE;
+  const App_Light_Record_T *record = App_Light_Record_Get();
+  enum ZclStatusCodeT status;
 
-  status = ZbZclAttrRead(app_OnOff.onoff_server, ZCL_ONOFF_ATTR_ONOFF, NULL, 
-                        &(app_OnOff.On), sizeof(app_OnOff.On), true);
-
-  /* Locally manage error if possible */
-  switch(status)
+  /* Read back the state saved by the application. None yet (first start-up
+     or NVM formatted) : the cluster keeps its default value, saved with the
+     next refresh */
+  if (record == NULL)
   {
-    case ZCL_STATUS_UNSUPP_ATTRIBUTE :
-    case ZCL_STATUS_UNREPORTABLE_ATTRIBUTE :
-    case ZCL_STATUS_INSUFFICIENT_SPACE :
-    case ZCL_STATUS_FAILURE :
-      APP_ZB_DBG("Read back cluster information : FAILED");
-      status = ZCL_STATUS_FAILURE;
-      break;
-    default :
-      status = ZCL_STATUS_SUCCESS;
-      break;
+    long long value = ZbZclAttrIntegerRead(app_OnOff.onoff_server, ZCL_ONOFF_ATTR_ONOFF, NULL, &status);
+
+    if (status == ZCL_STATUS_SUCCESS)
+    {
+      app_OnOff.On = (value != 0);
+    }
+    APP_ZB_DBG("No OnOff state saved : default %s", app_OnOff.On ? "ON" : "OFF");
+    return ZCL_STATUS_SUCCESS;
   }
 
-  return status;
+  app_OnOff.On = (record->on != 0U);
+  (void) ZbZclAttrIntegerWrite(app_OnOff.onoff_server, ZCL_ONOFF_ATTR_ONOFF, app_OnOff.On);
+
+  return ZCL_STATUS_SUCCESS;
 }/* App_Light_OnOff_Restore_State */
 
 /* OnOff callbacks Definition ---------------------------------------------- */
@@ -0,0 +1,39 @@
+/**
+  ******************************************************************************
+  * @file    app_common.h
+  * @author  MCD Application Team
+  * @brief   Host version of the common application header
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#ifndef APP_COMMON_H
+#define APP_COMMON_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include "host.h"
+#include "app_conf.h"
+
+#define PLACE_IN_SECTION( __x__ )  __attribute__((section (__x__)))
+
+#undef MIN
+#define MIN( x, y )          (((x)<(y))?(x):(y))
+#undef MAX
+#define MAX( x, y )          (((x)>(y))?(x):(y))
+
+#endif /* APP_COMMON_H */
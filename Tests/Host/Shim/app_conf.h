@@ -0,0 +1,55 @@
+/**
+  ******************************************************************************
+  * @file    app_conf.h
+  * @author  MCD Application Team
+  * @brief   Host version of the application configuration (tasks, timers, semaphores)
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#ifndef APP_CONF_H
+#define APP_CONF_H
+
+#include "hw_if.h"
+
+#define CFG_HW_FLASH_SEMID                      2
+#define CFG_HW_BLOCK_FLASH_REQ_BY_CPU1_SEMID    6
+#define CFG_HW_BLOCK_FLASH_REQ_BY_CPU2_SEMID    7
+
+#define CFG_DEBUG_TRACE                         1
+
+typedef enum
+{
+  CFG_TIM_PERSIST_SAVE,
+  CFG_TIM_NVM_TRANSFER,
+  CFG_TIM_FLASH_OPS,
+  CFG_TIM_NBR
+} CFG_TimProcID_t;
+
+typedef enum
+{
+  CFG_TASK_PERSIST_SAVE,
+  CFG_TASK_NVM_CLEAN,
+  CFG_TASK_FLASH_OPS,
+  CFG_TASK_NVM_TRANSFER,
+  CFG_TASK_NVM_RECORDS,
+  CFG_TASK_NBR  /**< Shall be last in the list */
+} CFG_Task_Id_t;
+
+typedef enum
+{
+  CFG_SCH_PRIO_0,
+  CFG_SCH_PRIO_1,
+  CFG_SCH_PRIO_NBR
+} CFG_SCH_Prio_Id_t;
+
+#endif /* APP_CONF_H */
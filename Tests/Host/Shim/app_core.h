@@ -0,0 +1,27 @@
+/**
+  ******************************************************************************
+  * @file    app_core.h
+  * @author  MCD Application Team
+  * @brief   Host version of the core application interface
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#ifndef APP_CORE_H
+#define APP_CORE_H
+
+/* Restore of the application state after the persistence restore, provided
+   by the test */
+void App_Core_Restore_State(void);
+void App_Core_Fast_Restore(void);
+
+#endif /* APP_CORE_H */
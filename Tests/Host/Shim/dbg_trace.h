@@ -0,0 +1,31 @@
+/**
+  ******************************************************************************
+  * @file    dbg_trace.h
+  * @author  MCD Application Team
+  * @brief   Host version of the trace output
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#ifndef DBG_TRACE_H
+#define DBG_TRACE_H
+
+#include <stddef.h>
+
+/* Output of the trace, captured by the test (see HOST_TraceCapture) */
+int DbgTraceWrite( int fd, const unsigned char *buf, size_t bufSize );
+
+/* Captures the trace output into buf (NULL: dropped), returns the number of
+   bytes captured since the previous call */
+size_t HOST_TraceCapture( unsigned char *buf, size_t size );
+
+#endif /* DBG_TRACE_H */
@@ -0,0 +1,615 @@
+/**
+  ******************************************************************************
+  * @file    host.c
+  * @author  MCD Application Team
+  * @brief   Host model of the STM32WB resources used by the NVM modules
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "host.h"
+#include "app_conf.h"
+#include "hw_if.h"
+#include "shci.h"
+#include "stm32_seq.h"
+#include "stm_logging.h"
+#include "dbg_trace.h"
+
+/* Private defines -----------------------------------------------------------*/
+
+#define HOST_RETAINED_MAX          (64U * 1024U)
+#define HOST_TIMER_NB              8U
+#define HOST_NS_PER_MS             1000000ULL
+
+/* Exit codes of the boot process */
+#define HOST_EXIT_RETURNED         0
+#define HOST_EXIT_FAILED           1
+#define HOST_EXIT_SOFTWARE_RESET   2
+#define HOST_EXIT_POWER_LOSS       3
+
+/* Private types -------------------------------------------------------------*/
+
+/* State shared by the boot processes and the test */
+typedef struct
+{
+  HOST_FlashStats_t stats;
+  int64_t cut_at;
+  int32_t erase_activity;
+  uint32_t retained_size;
+  uint8_t retained[HOST_RETAINED_MAX];
+} HOST_Shared_t;
+
+typedef struct
+{
+  HW_TS_pTimerCb_t cb;
+  HW_TS_Mode_t mode;
+  bool created;
+  bool running;
+  uint64_t period_ns;
+  uint64_t expiry_ns;
+} HOST_Timer_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+uint32_t SystemCoreClock = 32000000UL;
+uint32_t HOST_ResetFlags;
+HOST_CoreDebug_t HOST_CoreDebug;
+
+static HOST_DWT_t host_dwt;
+static HOST_Shared_t *host_shared;
+static uint64_t host_boot_ns;
+static bool host_in_boot;
+static bool host_flash_locked = true;
+static bool host_cpu2_busy;
+static void (*host_flash_hook)(void);
+static HOST_Timer_t host_timers[HOST_TIMER_NB];
+static uint64_t host_run_end_ns;
+static bool host_idle;
+static unsigned char *host_trace_buf;
+static size_t host_trace_size;
+static size_t host_trace_len;
+
+/* .noinit section, placed by host_noinit.ld */
+extern uint8_t __host_noinit_start[];
+extern uint8_t __host_noinit_end[];
+
+/* Private functions ---------------------------------------------------------*/
+
+static void HOST_Fatal(const char *fmt, ...) __attribute__((noreturn, format(printf, 1, 2)));
+static void HOST_Exit(int code) __attribute__((noreturn));
+
+static void HOST_Fatal(const char *fmt, ...)
+{
+  va_list args;
+
+  va_start(args, fmt);
+  fprintf(stderr, "host: ");
+  vfprintf(stderr, fmt, args);
+  fprintf(stderr, "\n");
+  va_end(args);
+  fflush(stdout);
+  abort();
+}
+
+static void HOST_Exit(int code)
+{
+  fflush(stdout);
+  fflush(stderr);
+  _exit(code);
+}
+
+static void HOST_PowerLoss(void)
+{
+  if (!host_in_boot)
+  {
+    HOST_Fatal("power cut outside of HOST_Boot");
+  }
+  host_shared->cut_at = -1;
+  host_shared->retained_size = 0U;
+  HOST_Exit(HOST_EXIT_POWER_LOSS);
+}
+
+/* Returns true if the current flash operation is the one to be cut */
+static bool HOST_CutNow(void)
+{
+  if (host_shared->cut_at < 0)
+  {
+    return false;
+  }
+  return (host_shared->cut_at-- == 0);
+}
+
+static uint8_t *HOST_FlashCheck(uint32_t address, uint32_t size)
+{
+  if ((address < FLASH_BASE) || ((address - FLASH_BASE) + size > FLASH_SIZE))
+  {
+    HOST_Fatal("flash access out of range at 0x%08x", (unsigned)address);
+  }
+  return (uint8_t *)(uintptr_t)address;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+void HOST_Init(void)
+{
+  static bool mapped = false;
+
+  if (!mapped)
+  {
+    void *flash = mmap((void *)(uintptr_t)FLASH_BASE, FLASH_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (flash != (void *)(uintptr_t)FLASH_BASE)
+    {
+      HOST_Fatal("cannot map the flash at 0x%08lx", FLASH_BASE);
+    }
+    host_shared = mmap(NULL, sizeof(HOST_Shared_t), PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (host_shared == MAP_FAILED)
+    {
+      HOST_Fatal("cannot map the shared state");
+    }
+    if ((size_t)(__host_noinit_end - __host_noinit_start) > HOST_RETAINED_MAX)
+    {
+      HOST_Fatal(".noinit section too big");
+    }
+    mapped = true;
+  }
+
+  memset(host_shared, 0, sizeof(HOST_Shared_t));
+  host_shared->cut_at = -1;
+  host_boot_ns = 0U;
+  HOST_FlashErase();
+}
+
+HOST_BootResult_t HOST_Boot(HOST_Reset_t reset, int (*fn)(void *arg), void *arg)
+{
+  int status;
+  pid_t pid;
+
+  fflush(stdout);
+  fflush(stderr);
+  pid = fork();
+  if (pid < 0)
+  {
+    HOST_Fatal("fork failed");
+  }
+
+  if (pid == 0)
+  {
+    size_t size = (size_t)(__host_noinit_end - __host_noinit_start);
+
+    host_in_boot = true;
+    host_boot_ns = host_shared->stats.time_ns;
+
+    if ((reset == HOST_RESET_SOFTWARE) && (host_shared->retained_size == size))
+    {
+      memcpy(__host_noinit_start, host_shared->retained, size);
+      HOST_ResetFlags = RCC_CSR_SFTRSTF | RCC_CSR_PINRSTF;
+    }
+    else
+    {
+      /* RAM content after a power up */
+      for (size_t i = 0; i < size; i++)
+      {
+        __host_noinit_start[i] = (uint8_t)rand();
+      }
+      HOST_ResetFlags = RCC_CSR_BORRSTF | RCC_CSR_PINRSTF;
+    }
+    host_shared->retained_size = 0U;
+
+    HOST_Exit((fn(arg) == 0) ? HOST_EXIT_RETURNED : HOST_EXIT_FAILED);
+  }
+
+  /* Keep the boots of the parent different (RAM content) */
+  (void)rand();
+
+  if (waitpid(pid, &status, 0) != pid)
+  {
+    HOST_Fatal("waitpid failed");
+  }
+  if (!WIFEXITED(status))
+  {
+    return HOST_BOOT_FAILED;
+  }
+  switch (WEXITSTATUS(status))
+  {
+    case HOST_EXIT_RETURNED:
+      return HOST_BOOT_RETURNED;
+    case HOST_EXIT_SOFTWARE_RESET:
+      return HOST_BOOT_SOFTWARE_RESET;
+    case HOST_EXIT_POWER_LOSS:
+      return HOST_BOOT_POWER_LOSS;
+    default:
+      return HOST_BOOT_FAILED;
+  }
+}
+
+void *HOST_SharedAlloc(size_t size)
+{
+  void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+  if (p == MAP_FAILED)
+  {
+    HOST_Fatal("cannot map %u shared bytes", (unsigned)size);
+  }
+  return p;
+}
+
+void HOST_FlashErase(void)
+{
+  memset((void *)(uintptr_t)FLASH_BASE, 0xFF, FLASH_SIZE);
+}
+
+void HOST_FlashCutAt(int64_t n)
+{
+  host_shared->cut_at = n;
+}
+
+void HOST_FlashGetStats(HOST_FlashStats_t *stats)
+{
+  *stats = host_shared->stats;
+}
+
+uint64_t HOST_TimeNs(void)
+{
+  return host_shared->stats.time_ns;
+}
+
+void HOST_Advance(uint64_t ns)
+{
+  uint64_t end = host_shared->stats.time_ns + ns;
+
+  for (;;)
+  {
+    HOST_Timer_t *next = NULL;
+
+    for (uint32_t i = 0; i < HOST_TIMER_NB; i++)
+    {
+      HOST_Timer_t *t = &host_timers[i];
+
+      if (t->running && (t->expiry_ns <= end) && ((next == NULL) || (t->expiry_ns < next->expiry_ns)))
+      {
+        next = t;
+      }
+    }
+    if (next == NULL)
+    {
+      break;
+    }
+    if (next->expiry_ns > host_shared->stats.time_ns)
+    {
+      host_shared->stats.time_ns = next->expiry_ns;
+    }
+    if (next->mode == hw_ts_Repeated)
+    {
+      next->expiry_ns += next->period_ns;
+    }
+    else
+    {
+      next->running = false;
+    }
+    next->cb();
+  }
+  if (host_shared->stats.time_ns < end)
+  {
+    host_shared->stats.time_ns = end;
+  }
+}
+
+void HOST_RunFor(uint32_t ms)
+{
+  host_run_end_ns = host_shared->stats.time_ns + ms * HOST_NS_PER_MS;
+  while (host_shared->stats.time_ns < host_run_end_ns)
+  {
+    host_idle = false;
+    UTIL_SEQ_Run(UTIL_SEQ_DEFAULT);
+    if (host_idle)
+    {
+      HOST_Advance(host_run_end_ns - host_shared->stats.time_ns);
+    }
+  }
+}
+
+bool HOST_RunUntilIdle(uint32_t max_ms)
+{
+  host_run_end_ns = host_shared->stats.time_ns + max_ms * HOST_NS_PER_MS;
+  for (;;)
+  {
+    host_idle = false;
+    UTIL_SEQ_Run(UTIL_SEQ_DEFAULT);
+    if (host_idle)
+    {
+      return true;
+    }
+    if (host_shared->stats.time_ns >= host_run_end_ns)
+    {
+      return false;
+    }
+  }
+}
+
+void HOST_SetCpu2Busy(bool busy)
+{
+  host_cpu2_busy = busy;
+}
+
+void HOST_SetFlashHook(void (*hook)(void))
+{
+  host_flash_hook = hook;
+}
+
+int32_t HOST_GetEraseActivity(void)
+{
+  return host_shared->erase_activity;
+}
+
+void HOST_Log(const char *fmt, ...)
+{
+  static int verbose = -1;
+  va_list args;
+
+  if (verbose < 0)
+  {
+    verbose = (getenv("HOST_VERBOSE") != NULL);
+  }
+  if (verbose != 0)
+  {
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    printf("\n");
+    va_end(args);
+  }
+}
+
+/* Core ----------------------------------------------------------------------*/
+
+HOST_DWT_t *HOST_Dwt(void)
+{
+  if ((host_dwt.CTRL & DWT_CTRL_CYCCNTENA_Msk) != 0U)
+  {
+    host_dwt.CYCCNT = (uint32_t)(host_shared->stats.time_ns * (SystemCoreClock / 1000000U) / 1000U);
+  }
+  return &host_dwt;
+}
+
+void NVIC_SystemReset(void)
+{
+  size_t size = (size_t)(__host_noinit_end - __host_noinit_start);
+
+  if (!host_in_boot)
+  {
+    HOST_Fatal("reset outside of HOST_Boot");
+  }
+  memcpy(host_shared->retained, __host_noinit_start, size);
+  host_shared->retained_size = size;
+  HOST_Exit(HOST_EXIT_SOFTWARE_RESET);
+}
+
+/* HAL -----------------------------------------------------------------------*/
+
+uint32_t HAL_GetTick(void)
+{
+  return (uint32_t)((host_shared->stats.time_ns - host_boot_ns) / HOST_NS_PER_MS);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+  HOST_Advance(Delay * HOST_NS_PER_MS);
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+  host_flash_locked = false;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+  host_flash_locked = true;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+  uint64_t *word;
+
+  if (host_flash_locked || (TypeProgram != FLASH_TYPEPROGRAM_DOUBLEWORD) || ((Address & 7U) != 0U))
+  {
+    HOST_Fatal("program error at 0x%08x", (unsigned)Address);
+  }
+  word = (uint64_t *)HOST_FlashCheck(Address, 8U);
+
+  /* Only all zeros can be programmed over a programmed word (PROGERR) */
+  if ((*word != UINT64_MAX) && (Data != 0U))
+  {
+    HOST_Fatal("programming a non erased word at 0x%08x", (unsigned)Address);
+  }
+
+  if (HOST_CutNow())
+  {
+    HOST_PowerLoss();
+  }
+  *word = Data;
+  host_shared->stats.programs++;
+  host_shared->stats.time_ns += HOST_FLASH_PROG_NS;
+
+  if (host_flash_hook != NULL)
+  {
+    host_flash_hook();
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError)
+{
+  if (host_flash_locked || (pEraseInit->TypeErase != FLASH_TYPEERASE_PAGES))
+  {
+    HOST_Fatal("erase error");
+  }
+  *PageError = UINT32_MAX;
+
+  for (uint32_t i = 0; i < pEraseInit->NbPages; i++)
+  {
+    uint8_t *page = HOST_FlashCheck(FLASH_BASE + (pEraseInit->Page + i) * FLASH_PAGE_SIZE, FLASH_PAGE_SIZE);
+
+    if (HOST_CutNow())
+    {
+      memset(page + FLASH_PAGE_SIZE / 2U, 0xFF, FLASH_PAGE_SIZE / 2U);
+      HOST_PowerLoss();
+    }
+    memset(page, 0xFF, FLASH_PAGE_SIZE);
+    host_shared->stats.erases++;
+    host_shared->stats.time_ns += HOST_FLASH_ERASE_NS;
+
+    if (host_flash_hook != NULL)
+    {
+      host_flash_hook();
+    }
+  }
+  return HAL_OK;
+}
+
+const volatile uint64_t *HOST_FlashRead(uint32_t address)
+{
+  host_shared->stats.reads++;
+  host_shared->stats.time_ns += HOST_FLASH_READ_NS;
+  return (const volatile uint64_t *)HOST_FlashCheck(address, 8U);
+}
+
+uint32_t LL_HSEM_1StepLock(void *HSEMx, uint32_t Semaphore)
+{
+  (void)HSEMx;
+  return ((Semaphore == CFG_HW_BLOCK_FLASH_REQ_BY_CPU2_SEMID) && host_cpu2_busy) ? 1U : 0U;
+}
+
+void LL_HSEM_ReleaseLock(void *HSEMx, uint32_t Semaphore, uint32_t process)
+{
+  (void)HSEMx;
+  (void)Semaphore;
+  (void)process;
+}
+
+uint32_t LL_HSEM_GetStatus(void *HSEMx, uint32_t Semaphore)
+{
+  (void)HSEMx;
+  (void)Semaphore;
+  return 0U;
+}
+
+SHCI_CmdStatus_t SHCI_C2_FLASH_EraseActivity(SHCI_EraseActivity_t erase_activity)
+{
+  host_shared->erase_activity += (erase_activity == ERASE_ACTIVITY_ON) ? 1 : -1;
+  return 0U;
+}
+
+/* Timer server --------------------------------------------------------------*/
+
+HW_TS_ReturnStatus_t HW_TS_Create(uint32_t TimerProcessID, uint8_t *pTimerId, HW_TS_Mode_t TimerMode, HW_TS_pTimerCb_t pTimerCallBack)
+{
+  (void)TimerProcessID;
+
+  for (uint8_t i = 0; i < HOST_TIMER_NB; i++)
+  {
+    if (!host_timers[i].created)
+    {
+      host_timers[i].created = true;
+      host_timers[i].running = false;
+      host_timers[i].mode = TimerMode;
+      host_timers[i].cb = pTimerCallBack;
+      *pTimerId = i;
+      return hw_ts_Successful;
+    }
+  }
+  return hw_ts_Failed;
+}
+
+void HW_TS_Delete(uint8_t TimerID)
+{
+  host_timers[TimerID].created = false;
+  host_timers[TimerID].running = false;
+}
+
+void HW_TS_Stop(uint8_t TimerID)
+{
+  host_timers[TimerID].running = false;
+}
+
+void HW_TS_Start(uint8_t TimerID, uint32_t timeout_ticks)
+{
+  HOST_Timer_t *t = &host_timers[TimerID];
+
+  t->period_ns = (uint64_t)timeout_ticks * HOST_NS_PER_MS / HW_TS_SERVER_1ms_NB_TICKS;
+  t->expiry_ns = host_shared->stats.time_ns + t->period_ns;
+  t->running = true;
+}
+
+/* Sequencer -----------------------------------------------------------------*/
+
+/* No task pending: wait for the next timer, within the run time */
+void UTIL_SEQ_Idle(void)
+{
+  uint64_t next = host_run_end_ns;
+  bool timer = false;
+
+  for (uint32_t i = 0; i < HOST_TIMER_NB; i++)
+  {
+    if (host_timers[i].running)
+    {
+      timer = true;
+      if (host_timers[i].expiry_ns < next)
+      {
+        next = host_timers[i].expiry_ns;
+      }
+    }
+  }
+
+  if (!timer || (next <= host_shared->stats.time_ns) || (host_shared->stats.time_ns >= host_run_end_ns))
+  {
+    host_idle = !timer;
+    HOST_Advance(0U);
+    return;
+  }
+  HOST_Advance(next - host_shared->stats.time_ns);
+}
+
+/* Trace ---------------------------------------------------------------------*/
+
+int DbgTraceWrite(int fd, const unsigned char *buf, size_t bufSize)
+{
+  (void)fd;
+
+  if ((host_trace_buf != NULL) && (host_trace_len + bufSize <= host_trace_size))
+  {
+    memcpy(&host_trace_buf[host_trace_len], buf, bufSize);
+  }
+  host_trace_len += bufSize;
+  return (int)bufSize;
+}
+
+size_t HOST_TraceCapture(unsigned char *buf, size_t size)
+{
+  size_t len = host_trace_len;
+
+  host_trace_buf = buf;
+  host_trace_size = size;
+  host_trace_len = 0U;
+  return len;
+}
@@ -0,0 +1,224 @@
+/**
+  ******************************************************************************
+  * @file    host.h
+  * @author  MCD Application Team
+  * @brief   Host model of the STM32WB resources used by the NVM modules
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/*
+  The modules under test (ee.c, flash_driver.c, app_nvm.c) are built without
+  change against this header, which replaces the CMSIS device header and the
+  part of the HAL/LL they use:
+
+  - flash: 512 KB at FLASH_BASE (mapped at the same address as on the target),
+    programmed by 64-bit words and erased by 4 KB pages with the constraints
+    of the STM32WB flash, each operation costing its typical duration in
+    simulated time. A power cut can be requested on the Nth program/erase.
+
+  - time: HAL_GetTick, HAL_Delay and DWT->CYCCNT (SystemCoreClock = 32 MHz)
+    all follow the simulated time, advanced by the flash operations and by
+    the idle time of the sequencer.
+
+  - boot: HOST_Boot runs the firmware in a child process, so that a reset
+    (NVIC_SystemReset, power cut) starts again from the initial RAM content
+    as on the target. The flash and the statistics are shared with the
+    parent; the .noinit section is kept through a software reset only.
+ */
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Core ----------------------------------------------------------------------*/
+
+#define __WEAK                     __attribute__((weak))
+#define __NOP()
+
+extern uint32_t SystemCoreClock;
+
+typedef struct
+{
+  volatile uint32_t CTRL;
+  volatile uint32_t CYCCNT;
+} HOST_DWT_t;
+
+typedef struct
+{
+  volatile uint32_t DEMCR;
+} HOST_CoreDebug_t;
+
+/* CYCCNT follows the simulated time while CYCCNTENA is set */
+HOST_DWT_t *HOST_Dwt( void );
+extern HOST_CoreDebug_t HOST_CoreDebug;
+
+#define DWT                        (HOST_Dwt())
+#define CoreDebug                  (&HOST_CoreDebug)
+#define DWT_CTRL_CYCCNTENA_Msk     (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+
+void NVIC_SystemReset( void ) __attribute__((noreturn));
+
+/* RCC_CSR reset flags (set by HOST_Boot) -----------------------------------*/
+
+/* HOST_ResetFlags is what the application entry reads at startup and gives
+   to App_NVM_Init */
+
+#define RCC_CSR_OBLRSTF            (1UL << 25)
+#define RCC_CSR_PINRSTF            (1UL << 26)
+#define RCC_CSR_BORRSTF            (1UL << 27)
+#define RCC_CSR_SFTRSTF            (1UL << 28)
+#define RCC_CSR_IWDGRSTF           (1UL << 29)
+#define RCC_CSR_WWDGRSTF           (1UL << 30)
+#define RCC_CSR_LPWRRSTF           (1UL << 31)
+
+extern uint32_t HOST_ResetFlags;
+
+/* HAL -----------------------------------------------------------------------*/
+
+typedef enum
+{
+  HAL_OK       = 0x00U,
+  HAL_ERROR    = 0x01U,
+  HAL_BUSY     = 0x02U,
+  HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+uint32_t HAL_GetTick( void );
+void HAL_Delay( uint32_t Delay );
+
+/* Flash ---------------------------------------------------------------------*/
+
+#define FLASH_BASE                 (0x08000000UL)
+#define FLASH_SIZE                 (0x00080000UL)
+#define FLASH_PAGE_SIZE            (0x00001000UL)
+
+#define FLASH_TYPEERASE_PAGES      (0x00U)
+#define FLASH_TYPEPROGRAM_DOUBLEWORD (0x01U)
+
+#define FLASH_FLAG_EOP             (1UL << 0)
+#define FLASH_FLAG_OPERR           (1UL << 1)
+#define FLASH_FLAG_PROGERR         (1UL << 3)
+#define FLASH_FLAG_WRPERR          (1UL << 4)
+#define FLASH_FLAG_PGAERR          (1UL << 5)
+#define FLASH_FLAG_PGSERR          (1UL << 7)
+#define FLASH_FLAG_OPTVERR         (1UL << 15)
+#define FLASH_FLAG_CFGBSY          (1UL << 18)
+
+typedef struct
+{
+  uint32_t TypeErase;
+  uint32_t Page;
+  uint32_t NbPages;
+} FLASH_EraseInitTypeDef;
+
+HAL_StatusTypeDef HAL_FLASH_Unlock( void );
+HAL_StatusTypeDef HAL_FLASH_Lock( void );
+HAL_StatusTypeDef HAL_FLASH_Program( uint32_t TypeProgram, uint32_t Address, uint64_t Data );
+HAL_StatusTypeDef HAL_FLASHEx_Erase( FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError );
+
+/* The operations are synchronous: never busy, never suspended */
+#define __HAL_FLASH_GET_FLAG( f )        (0U)
+#define __HAL_FLASH_CLEAR_FLAG( f )
+#define LL_FLASH_IsActiveFlag_OperationSuspended( )  (0U)
+
+/* Read access to the flash by the EE module, counted (see HOST_FlashStats_t) */
+const volatile uint64_t *HOST_FlashRead( uint32_t address );
+#define EE_PTR( x )                ((uint64_t*)HOST_FlashRead( x ))
+
+/* HSEM ----------------------------------------------------------------------*/
+
+#define HSEM                       ((void*)0)
+
+/* The semaphore CFG_HW_BLOCK_FLASH_REQ_BY_CPU2_SEMID is taken while the CPU2
+   is busy (see HOST_SetCpu2Busy), the others are always free */
+uint32_t LL_HSEM_1StepLock( void *HSEMx, uint32_t Semaphore );
+void LL_HSEM_ReleaseLock( void *HSEMx, uint32_t Semaphore, uint32_t process );
+uint32_t LL_HSEM_GetStatus( void *HSEMx, uint32_t Semaphore );
+
+/* Host control --------------------------------------------------------------*/
+
+/* Typical durations (STM32WB55 datasheet, 64-bit programming and page erase),
+   and the read of a 64-bit word (two AHB accesses with one wait state) */
+#define HOST_FLASH_PROG_NS         (81700ULL)
+#define HOST_FLASH_ERASE_NS        (22020000ULL)
+#define HOST_FLASH_READ_NS         (125ULL)
+
+typedef struct
+{
+  uint64_t reads;        /* 64-bit words read by the EE module */
+  uint64_t programs;     /* 64-bit words programmed */
+  uint64_t erases;       /* pages erased */
+  uint64_t time_ns;      /* simulated time */
+} HOST_FlashStats_t;
+
+typedef enum
+{
+  HOST_RESET_POWER_ON,     /* cold boot */
+  HOST_RESET_SOFTWARE,     /* warm boot: .noinit kept */
+  HOST_RESET_POWER_LOSS    /* cold boot after a brown-out */
+} HOST_Reset_t;
+
+typedef enum
+{
+  HOST_BOOT_RETURNED,      /* the firmware function returned 0 */
+  HOST_BOOT_FAILED,        /* returned non 0 or crashed */
+  HOST_BOOT_SOFTWARE_RESET,/* ended by NVIC_SystemReset */
+  HOST_BOOT_POWER_LOSS     /* ended by the power cut */
+} HOST_BootResult_t;
+
+/* Maps the flash (erased) and the shared state, sets the time to 0 */
+void HOST_Init( void );
+
+/* Runs fn in a fresh copy of the RAM (the one of the caller) after a reset
+   of the given type */
+HOST_BootResult_t HOST_Boot( HOST_Reset_t reset, int (*fn)( void *arg ), void *arg );
+
+/* Memory shared by the boots and the caller (e.g. the model of the data
+   expected in flash), to be allocated before the boots */
+void *HOST_SharedAlloc( size_t size );
+
+/* Erases the whole flash, without cost */
+void HOST_FlashErase( void );
+
+/* Power cut on the program/erase number n counted from now (-1: none). An
+   interrupted program leaves the word unchanged, an interrupted erase leaves
+   the first half of the page unchanged */
+void HOST_FlashCutAt( int64_t n );
+
+void HOST_FlashGetStats( HOST_FlashStats_t *stats );
+uint64_t HOST_TimeNs( void );
+
+/* Advances the simulated time, the expired timers being called */
+void HOST_Advance( uint64_t ns );
+
+/* Runs the sequencer for the given simulated time */
+void HOST_RunFor( uint32_t ms );
+
+/* Runs the sequencer until no task is pending and no timer runs, within the
+   given simulated time: returns false if still busy */
+bool HOST_RunUntilIdle( uint32_t max_ms );
+
+void HOST_SetCpu2Busy( bool busy );
+
+/* Balance of the SHCI_C2_FLASH_EraseActivity ON/OFF calls */
+int32_t HOST_GetEraseActivity( void );
+
+/* Called after each program/erase (NULL: none) */
+void HOST_SetFlashHook( void (*hook)( void ) );
+
+#endif /* HOST_H */
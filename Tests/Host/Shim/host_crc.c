@@ -0,0 +1,54 @@
+/**
+  ******************************************************************************
+  * @file    host_crc.c
+  * @author  MCD Application Team
+  * @brief   Host model of the CRC peripheral
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#include "stm32wbxx_ll_crc.h"
+
+CRC_TypeDef HOST_Crc = { 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0x04C11DB7UL, LL_CRC_POLYLENGTH_32B, 0U, 0U };
+
+/* MSB first, as the CRC unit without input/output reversal */
+static void HOST_CrcFeed(CRC_TypeDef *CRCx, uint32_t data, uint32_t nbits)
+{
+  uint32_t top = 1UL << (CRCx->POLYSIZE - 1U);
+  uint32_t mask = (CRCx->POLYSIZE == 32U) ? 0xFFFFFFFFUL : ((1UL << CRCx->POLYSIZE) - 1U);
+  uint32_t crc = CRCx->DR & mask;
+
+  for (uint32_t i = nbits; i != 0U; i--)
+  {
+    uint32_t bit = (data >> (i - 1U)) & 1U;
+
+    if ((((crc & top) != 0U) ? 1U : 0U) ^ bit)
+    {
+      crc = ((crc << 1) ^ CRCx->POL) & mask;
+    }
+    else
+    {
+      crc = (crc << 1) & mask;
+    }
+  }
+  CRCx->DR = crc;
+}
+
+void LL_CRC_FeedData32(CRC_TypeDef *CRCx, uint32_t InData)
+{
+  HOST_CrcFeed(CRCx, InData, 32U);
+}
+
+void LL_CRC_FeedData8(CRC_TypeDef *CRCx, uint8_t InData)
+{
+  HOST_CrcFeed(CRCx, InData, 8U);
+}
@@ -0,0 +1,155 @@
+/**
+  ******************************************************************************
+  * @file    host_heap.c
+  * @author  MCD Application Team
+  * @brief   Host model of the newlib-nano heap
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#include <string.h>
+
+#include "host_heap.h"
+
+#define HOST_CHUNK_ALIGN           8U
+#define HOST_CHUNK_OFFSET          offsetof(HOST_Chunk_t, next)
+#define HOST_CHUNK_MIN             sizeof(HOST_Chunk_t)
+
+/* Chunk: size, then the payload, which holds the link of the free list once
+   freed */
+typedef struct HOST_Chunk
+{
+  size_t size;
+  struct HOST_Chunk *next;
+} HOST_Chunk_t;
+
+static uint8_t host_heap[HOST_HEAP_SIZE] __attribute__((aligned(16)));
+static HOST_Chunk_t *host_free_list;
+static HOST_HeapStats_t host_heap_stats;
+
+void *HOST_HeapMalloc(size_t size)
+{
+  size_t need = (size + HOST_CHUNK_OFFSET + HOST_CHUNK_ALIGN - 1U) & ~(size_t)(HOST_CHUNK_ALIGN - 1U);
+  HOST_Chunk_t **link = &host_free_list;
+  HOST_Chunk_t *chunk;
+
+  if (need < HOST_CHUNK_MIN)
+  {
+    need = HOST_CHUNK_MIN;
+  }
+
+  /* First fit, the tail of a larger chunk being taken */
+  for (chunk = host_free_list; chunk != NULL; link = &chunk->next, chunk = chunk->next)
+  {
+    host_heap_stats.steps++;
+    if (chunk->size >= need)
+    {
+      if ((chunk->size - need) >= HOST_CHUNK_MIN)
+      {
+        chunk->size -= need;
+        chunk = (HOST_Chunk_t *)((uint8_t *)chunk + chunk->size);
+        chunk->size = need;
+      }
+      else
+      {
+        *link = chunk->next;
+      }
+      return (uint8_t *)chunk + HOST_CHUNK_OFFSET;
+    }
+  }
+
+  if ((host_heap_stats.brk + need) > HOST_HEAP_SIZE)
+  {
+    return NULL;
+  }
+  chunk = (HOST_Chunk_t *)&host_heap[host_heap_stats.brk];
+  chunk->size = need;
+  host_heap_stats.brk += need;
+  if (host_heap_stats.brk > host_heap_stats.brk_max)
+  {
+    host_heap_stats.brk_max = host_heap_stats.brk;
+  }
+  return (uint8_t *)chunk + HOST_CHUNK_OFFSET;
+}
+
+void HOST_HeapFree(void *ptr)
+{
+  HOST_Chunk_t *chunk = (HOST_Chunk_t *)((uint8_t *)ptr - HOST_CHUNK_OFFSET);
+  HOST_Chunk_t *prev = NULL;
+  HOST_Chunk_t *next = host_free_list;
+
+  if (ptr == NULL)
+  {
+    return;
+  }
+
+  /* Inserted by address, merged with its free neighbours */
+  while ((next != NULL) && (next < chunk))
+  {
+    host_heap_stats.steps++;
+    prev = next;
+    next = next->next;
+  }
+  if ((next != NULL) && (((uint8_t *)chunk + chunk->size) == (uint8_t *)next))
+  {
+    chunk->size += next->size;
+    next = next->next;
+  }
+  chunk->next = next;
+  if ((prev != NULL) && (((uint8_t *)prev + prev->size) == (uint8_t *)chunk))
+  {
+    prev->size += chunk->size;
+    prev->next = next;
+  }
+  else if (prev != NULL)
+  {
+    prev->next = chunk;
+  }
+  else
+  {
+    host_free_list = chunk;
+  }
+}
+
+void HOST_HeapReset(void)
+{
+  host_free_list = NULL;
+  memset(&host_heap_stats, 0, sizeof(host_heap_stats));
+}
+
+void HOST_HeapGetStats(HOST_HeapStats_t *stats)
+{
+  HOST_Chunk_t *chunk;
+
+  host_heap_stats.free_bytes = 0U;
+  host_heap_stats.largest_free = 0U;
+  host_heap_stats.free_chunks = 0U;
+  for (chunk = host_free_list; chunk != NULL; chunk = chunk->next)
+  {
+    host_heap_stats.free_bytes += chunk->size;
+    host_heap_stats.free_chunks++;
+    if (chunk->size > host_heap_stats.largest_free)
+    {
+      host_heap_stats.largest_free = chunk->size;
+    }
+  }
+  *stats = host_heap_stats;
+}
+
+double HOST_HeapFragmentation(const HOST_HeapStats_t *stats)
+{
+  if (stats->free_bytes == 0U)
+  {
+    return 0.0;
+  }
+  return 1.0 - ((double)stats->largest_free / (double)stats->free_bytes);
+}
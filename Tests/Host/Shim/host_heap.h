@@ -0,0 +1,57 @@
+/**
+  ******************************************************************************
+  * @file    host_heap.h
+  * @author  MCD Application Team
+  * @brief   Host model of the newlib-nano heap
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/*
+  First fit on a free list sorted by address, the tail of a larger chunk
+  being taken, coalescing on free, the break moved up when no chunk fits
+  (sbrk), in a static region of HOST_HEAP_SIZE bytes. The free chunks walked
+  by the allocations and frees are counted: the cost of a heap walk,
+  independent of the host.
+ */
+
+#ifndef HOST_HEAP_H
+#define HOST_HEAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HOST_HEAP_SIZE             (64U * 1024U)
+
+typedef struct
+{
+  uint64_t steps;        /* free chunks walked */
+  size_t brk;            /* bytes below the break */
+  size_t brk_max;        /* max of brk */
+  size_t free_bytes;     /* bytes of the free chunks below the break */
+  size_t largest_free;   /* bytes of the largest of them */
+  uint32_t free_chunks;  /* number of free chunks */
+} HOST_HeapStats_t;
+
+void *HOST_HeapMalloc(size_t size);
+void HOST_HeapFree(void *ptr);
+
+/* Empty heap, counters cleared */
+void HOST_HeapReset(void);
+
+/* The free chunks are walked for the free_* fields, not counted in steps */
+void HOST_HeapGetStats(HOST_HeapStats_t *stats);
+
+/* 1 - largest free chunk / free bytes (0: no fragmentation) */
+double HOST_HeapFragmentation(const HOST_HeapStats_t *stats);
+
+#endif /* HOST_HEAP_H */
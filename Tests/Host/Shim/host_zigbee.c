@@ -0,0 +1,107 @@
+/**
+  ******************************************************************************
+  * @file    host_zigbee.c
+  * @author  MCD Application Team
+  * @brief   Host model of the Zigbee stack persistence interface
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#include <string.h>
+
+#include "zigbee_interface.h"
+
+#define HOST_ZIGBEE_STATE_MAX      4096U
+
+static uint8_t host_state[HOST_ZIGBEE_STATE_MAX];
+static unsigned int host_state_len;
+static uint8_t host_restored[HOST_ZIGBEE_STATE_MAX];
+static unsigned int host_restored_len;
+static bool host_restored_valid;
+
+void HOST_ZigbeeSetState(const uint8_t *buf, unsigned int len)
+{
+  memcpy(host_state, buf, len);
+  host_state_len = len;
+}
+
+const uint8_t *HOST_ZigbeeRestored(unsigned int *len)
+{
+  *len = host_restored_len;
+  return host_restored_valid ? host_restored : NULL;
+}
+
+unsigned int ZbStateGet(struct ZigBeeT *zb, uint8_t *buf, unsigned int maxlen)
+{
+  (void)zb;
+
+  if (host_state_len > maxlen)
+  {
+    return 0U;
+  }
+  memcpy(buf, host_state, host_state_len);
+  return host_state_len;
+}
+
+/* The restore completes at once */
+enum ZbStatusCodeT ZbStartupPersist(struct ZigBeeT *zb, const void *pdata, unsigned int plen,
+    struct ZbStartupCbkeT *cbke_config,
+    void (*callback)(enum ZbStatusCodeT status, void *arg), void *arg)
+{
+  (void)zb;
+  (void)cbke_config;
+
+  if (plen > HOST_ZIGBEE_STATE_MAX)
+  {
+    return ZB_STATUS_ALLOC_FAIL;
+  }
+  memcpy(host_restored, pdata, plen);
+  host_restored_len = plen;
+  host_restored_valid = true;
+  if (callback != NULL)
+  {
+    callback(ZB_STATUS_SUCCESS, arg);
+  }
+  return ZB_STATUS_SUCCESS;
+}
+
+enum ZbStatusCodeT ZbNwkSet(struct ZigBeeT *zb, enum ZbNwkNibAttrIdT attrId, void *attrPtr, unsigned int attrSz)
+{
+  (void)zb;
+  (void)attrId;
+  (void)attrPtr;
+  (void)attrSz;
+  return ZB_STATUS_SUCCESS;
+}
+
+bool ZbPersistNotifyRegister(struct ZigBeeT *zb, void (*callback)(struct ZigBeeT *zb, void *cbarg), void *cbarg)
+{
+  (void)zb;
+  (void)callback;
+  (void)cbarg;
+  return true;
+}
+
+void ZbIpcCbPoolStats(struct ZbIpcCbPoolStatsT *stats)
+{
+  memset(stats, 0, sizeof(*stats));
+}
+
+void ZbM0HeapStats(struct ZbM0HeapStatsT *stats)
+{
+  memset(stats, 0, sizeof(*stats));
+}
+
+void zb_malloc_report(void (*print)(const char *fmt, ...))
+{
+  (void)print;
+}
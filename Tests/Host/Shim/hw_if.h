@@ -0,0 +1,47 @@
+/**
+  ******************************************************************************
+  * @file    hw_if.h
+  * @author  MCD Application Team
+  * @brief   Host version of the timer server interface
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#ifndef HW_IF_H
+#define HW_IF_H
+
+#include <stdint.h>
+
+/* One tick per ms */
+#define HW_TS_SERVER_1ms_NB_TICKS   (1U)
+#define HW_TS_SERVER_1S_NB_TICKS    (1000U * HW_TS_SERVER_1ms_NB_TICKS)
+
+typedef enum
+{
+  hw_ts_SingleShot,
+  hw_ts_Repeated
+} HW_TS_Mode_t;
+
+typedef enum
+{
+  hw_ts_Successful,
+  hw_ts_Failed,
+} HW_TS_ReturnStatus_t;
+
+typedef void (*HW_TS_pTimerCb_t)(void);
+
+HW_TS_ReturnStatus_t HW_TS_Create(uint32_t TimerProcessID, uint8_t *pTimerId, HW_TS_Mode_t TimerMode, HW_TS_pTimerCb_t pTimerCallBack);
+void HW_TS_Delete(uint8_t TimerID);
+void HW_TS_Stop(uint8_t TimerID);
+void HW_TS_Start(uint8_t TimerID, uint32_t timeout_ticks);
+
+#endif /* HW_IF_H */
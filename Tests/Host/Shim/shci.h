@@ -0,0 +1,35 @@
+/**
+  ******************************************************************************
+  * @file    shci.h
+  * @author  MCD Application Team
+  * @brief   Host version of the system commands to the CPU2
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#ifndef SHCI_H
+#define SHCI_H
+
+#include <stdint.h>
+
+typedef enum
+{
+  ERASE_ACTIVITY_OFF = 0x00,
+  ERASE_ACTIVITY_ON = 0x01,
+} SHCI_EraseActivity_t;
+
+typedef uint8_t SHCI_CmdStatus_t;
+
+/* Counts the erase windows opened (see HOST_GetEraseActivity) */
+SHCI_CmdStatus_t SHCI_C2_FLASH_EraseActivity( SHCI_EraseActivity_t erase_activity );
+
+#endif /* SHCI_H */
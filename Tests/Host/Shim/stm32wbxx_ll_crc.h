@@ -0,0 +1,90 @@
+/**
+  ******************************************************************************
+  * @file    stm32wbxx_ll_crc.h
+  * @author  MCD Application Team
+  * @brief   Host model of the CRC peripheral (LL driver)
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#ifndef STM32WBxx_LL_CRC_H
+#define STM32WBxx_LL_CRC_H
+
+#include <stdint.h>
+
+/* Bitwise model of the CRC unit: programmable polynomial of 7, 8, 16 or 32
+   bits, MSB first, fed by 8 or 32 bits */
+typedef struct
+{
+  uint32_t DR;
+  uint32_t INIT;
+  uint32_t POL;
+  uint32_t POLYSIZE;
+  uint32_t REV_IN;
+  uint32_t REV_OUT;
+} CRC_TypeDef;
+
+extern CRC_TypeDef HOST_Crc;
+#define CRC                        (&HOST_Crc)
+
+#define LL_CRC_POLYLENGTH_32B      32U
+#define LL_CRC_POLYLENGTH_16B      16U
+#define LL_CRC_POLYLENGTH_8B       8U
+#define LL_CRC_POLYLENGTH_7B       7U
+#define LL_CRC_INDATA_REVERSE_NONE 0U
+#define LL_CRC_OUTDATA_REVERSE_NONE 0U
+
+void LL_CRC_FeedData32(CRC_TypeDef *CRCx, uint32_t InData);
+void LL_CRC_FeedData8(CRC_TypeDef *CRCx, uint8_t InData);
+
+static inline void LL_CRC_SetPolynomialSize(CRC_TypeDef *CRCx, uint32_t PolySize)
+{
+  CRCx->POLYSIZE = PolySize;
+}
+
+static inline void LL_CRC_SetPolynomialCoef(CRC_TypeDef *CRCx, uint32_t PolynomCoef)
+{
+  CRCx->POL = PolynomCoef;
+}
+
+/* Only the non reversed modes are modelled */
+static inline void LL_CRC_SetInputDataReverseMode(CRC_TypeDef *CRCx, uint32_t ReverseMode)
+{
+  CRCx->REV_IN = ReverseMode;
+}
+
+static inline void LL_CRC_SetOutputDataReverseMode(CRC_TypeDef *CRCx, uint32_t ReverseMode)
+{
+  CRCx->REV_OUT = ReverseMode;
+}
+
+static inline void LL_CRC_SetInitialData(CRC_TypeDef *CRCx, uint32_t InitCrc)
+{
+  CRCx->INIT = InitCrc;
+}
+
+static inline void LL_CRC_ResetCRCCalculationUnit(CRC_TypeDef *CRCx)
+{
+  CRCx->DR = CRCx->INIT;
+}
+
+static inline uint16_t LL_CRC_ReadData16(CRC_TypeDef *CRCx)
+{
+  return (uint16_t)CRCx->DR;
+}
+
+static inline uint32_t LL_CRC_ReadData32(CRC_TypeDef *CRCx)
+{
+  return CRCx->DR;
+}
+
+#endif /* STM32WBxx_LL_CRC_H */
@@ -0,0 +1,29 @@
+/**
+  ******************************************************************************
+  * @file    stm_logging.h
+  * @author  MCD Application Team
+  * @brief   Host version of the application log
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#ifndef STM_LOGGING_H
+#define STM_LOGGING_H
+
+#include <stdio.h>
+
+/* Printed when HOST_VERBOSE is set in the environment */
+void HOST_Log( const char *fmt, ... );
+
+#define APP_ZB_DBG( ... )          HOST_Log( __VA_ARGS__ )
+
+#endif /* STM_LOGGING_H */
@@ -0,0 +1,28 @@
+/**
+  ******************************************************************************
+  * @file    utilities_common.h
+  * @author  MCD Application Team
+  * @brief   Host version of the common utilities header
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#ifndef UTILITIES_COMMON_H
+#define UTILITIES_COMMON_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "host.h"
+#include "utilities_conf.h"
+
+#endif /* UTILITIES_COMMON_H */
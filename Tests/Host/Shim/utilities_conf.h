@@ -0,0 +1,39 @@
+/**
+  ******************************************************************************
+  * @file    utilities_conf.h
+  * @author  MCD Application Team
+  * @brief   Host version of the utilities configuration
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#ifndef UTILITIES_CONF_H
+#define UTILITIES_CONF_H
+
+#include <string.h>
+
+#include "host.h"
+
+/* No interrupt on the host: the timers are called from the idle loop */
+#define UTILS_ENTER_CRITICAL_SECTION( )   uint32_t primask_bit = 0U; (void)primask_bit
+#define UTILS_EXIT_CRITICAL_SECTION( )    (void)primask_bit
+
+#define UTILS_MEMSET8( dest, value, size )      memset( dest, value, size);
+
+#define UTIL_SEQ_INIT_CRITICAL_SECTION( )
+#define UTIL_SEQ_ENTER_CRITICAL_SECTION( )      UTILS_ENTER_CRITICAL_SECTION( )
+#define UTIL_SEQ_EXIT_CRITICAL_SECTION( )       UTILS_EXIT_CRITICAL_SECTION( )
+#define UTIL_SEQ_CONF_TASK_NBR                  (32)
+#define UTIL_SEQ_CONF_PRIO_NBR                  (2)
+#define UTIL_SEQ_MEMSET8( dest, value, size )   UTILS_MEMSET8( dest, value, size )
+
+#endif /* UTILITIES_CONF_H */
@@ -0,0 +1,26 @@
+/**
+  ******************************************************************************
+  * @file    cmsis_compiler.h
+  * @author  MCD Application Team
+  * @brief   Host version of the CMSIS compiler header (__CLZ only)
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#ifndef __CMSIS_COMPILER_H
+#define __CMSIS_COMPILER_H
+
+#include <stdint.h>
+
+#define __CLZ(x)                   ((uint8_t)(((x) == 0U) ? 32U : (uint32_t)__builtin_clz(x)))
+
+#endif /* __CMSIS_COMPILER_H */
@@ -0,0 +1,24 @@
+/**
+  ******************************************************************************
+  * @file    stm32wbxx_hal.h
+  * @author  MCD Application Team
+  * @brief   Host version of the HAL header included by the Zigbee core
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#ifndef STM32WBxx_HAL_H
+#define STM32WBxx_HAL_H
+
+#include "stm32wbxx_hal_def.h"
+
+#endif /* STM32WBxx_HAL_H */
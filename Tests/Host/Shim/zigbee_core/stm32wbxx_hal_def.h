@@ -0,0 +1,30 @@
+/**
+  ******************************************************************************
+  * @file    stm32wbxx_hal_def.h
+  * @author  MCD Application Team
+  * @brief   Host version of the HAL definitions used by zigbee_core_wb.c
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#ifndef STM32WBxx_HAL_DEF_H
+#define STM32WBxx_HAL_DEF_H
+
+typedef enum
+{
+  HAL_OK       = 0x00U,
+  HAL_ERROR    = 0x01U,
+  HAL_BUSY     = 0x02U,
+  HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+#endif /* STM32WBxx_HAL_DEF_H */
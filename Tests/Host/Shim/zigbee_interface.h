@@ -0,0 +1,77 @@
+/**
+  ******************************************************************************
+  * @file    zigbee_interface.h
+  * @author  MCD Application Team
+  * @brief   Host version of the Zigbee stack interface used by app_nvm.c
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+#ifndef _ZIGBEE_INTERFACE
+#define _ZIGBEE_INTERFACE
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Stack model: the persistence image is the one given to
+   HOST_ZigbeeSetState, ZbPersistNotifyRegister only records the callback */
+struct ZigBeeT;
+struct ZbStartupCbkeT;
+
+enum ZbStatusCodeT {
+    ZB_STATUS_SUCCESS = 0x00,
+    ZB_STATUS_ALLOC_FAIL = 0x70,
+};
+
+#define ZB_WPAN_STATUS_SUCCESS 0x00
+
+enum ZbNwkNibAttrIdT {
+    ZB_NWK_NIB_ID_ExtendedPanId = 0x9a,
+};
+
+unsigned int ZbStateGet(struct ZigBeeT *zb, uint8_t *buf, unsigned int maxlen);
+enum ZbStatusCodeT ZbStartupPersist(struct ZigBeeT *zb, const void *pdata, unsigned int plen,
+    struct ZbStartupCbkeT *cbke_config,
+    void (*callback)(enum ZbStatusCodeT status, void *arg), void *arg);
+enum ZbStatusCodeT ZbNwkSet(struct ZigBeeT *zb, enum ZbNwkNibAttrIdT attrId, void *attrPtr, unsigned int attrSz);
+bool ZbPersistNotifyRegister(struct ZigBeeT *zb, void (*callback)(struct ZigBeeT *zb, void *cbarg), void *cbarg);
+
+struct ZbIpcCbPoolStatsT {
+    unsigned int size; /* entries in the pool */
+    unsigned int in_use; /* entries allocated */
+    unsigned int high_water; /* max of in_use */
+    unsigned int exhausted; /* allocations done while the pool was empty */
+    unsigned int heap_in_use; /* allocations from the heap not freed yet */
+};
+
+struct ZbM0HeapStatsT {
+    unsigned int size; /* bytes of the heap region */
+    unsigned int used; /* bytes of the allocated blocks */
+    unsigned int requested; /* bytes requested for them (used - requested: internal fragmentation) */
+    unsigned int used_max; /* max of used */
+    unsigned int free_blocks; /* number of free blocks */
+    unsigned int largest_free; /* bytes of the largest free block (vs size - used: external fragmentation) */
+    unsigned int alloc_cnt; /* allocations served by the region */
+    unsigned int fallback_cnt; /* allocations served by malloc(), region full */
+    unsigned int fail_cnt; /* allocations failed */
+};
+
+void ZbIpcCbPoolStats(struct ZbIpcCbPoolStatsT *stats);
+void ZbM0HeapStats(struct ZbM0HeapStatsT *stats);
+void zb_malloc_report(void (*print)(const char *fmt, ...));
+
+/* Host control */
+void HOST_ZigbeeSetState(const uint8_t *buf, unsigned int len);
+/* Image given to the last ZbStartupPersist (NULL if none since the boot) */
+const uint8_t *HOST_ZigbeeRestored(unsigned int *len);
+
+#endif /* _ZIGBEE_INTERFACE */
@@ -0,0 +1,335 @@
+/**
+  ******************************************************************************
+  * @file    bench_cbpool.c
+  * @author  MCD Application Team
+  * @brief   Callback info pool of the Zigbee requests against the heap
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/*
+  zigbee_core_wb.c is included, its malloc/free going to the model of the
+  newlib-nano heap (host_heap.h).
+
+  The same bursts of ZCL requests are run twice: the callback info of each
+  request taken from the pool (zb_ipc_m4_cb_info_alloc), then from the heap
+  as before the pool (malloc and memset). Each request also holds a payload
+  buffer from the heap until its response, the responses coming back in a
+  random order, and some of them leave a long lived allocation behind (the
+  stack timers, the attributes). Reported per mode:
+    - latency of the callback info: free chunks walked by the heap model
+      for its allocation and free (deterministic), mean host ns of the
+      allocation (indicative only),
+    - fragmentation of the heap after each burst: 1 - largest free chunk /
+      free bytes below the break, and the break itself (heap footprint).
+  The pool counters (ZbIpcCbPoolStats) are checked against the outstanding
+  requests. The sizes are the host ones (64-bit pointers).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "host_heap.h"
+
+/* Heap model, used by zigbee_core_wb.c as its malloc */
+#define malloc(size)               HOST_HeapMalloc(size)
+#define free(ptr)                  HOST_HeapFree(ptr)
+
+#include "zigbee_core_wb.c"
+
+/* Private defines -----------------------------------------------------------*/
+
+#define BENCH_SEED                 1U
+#define BENCH_BURSTS               5000U
+#define BENCH_BURST_MAX            24U   /* requests submitted per burst */
+#define BENCH_OUTSTANDING_MAX      64U
+#define BENCH_LONG_LIVED_MAX       32U
+
+#define CHECK(c) do { if (!(c)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c); return 1; } } while (0)
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  struct zb_ipc_m4_cb_info_t *info;
+  void *payload;
+} BENCH_Request_t;
+
+typedef struct
+{
+  void *ptr;
+  uint32_t expiry;      /* burst of its free */
+} BENCH_LongLived_t;
+
+typedef struct
+{
+  const char *name;
+  uint64_t nb_alloc;
+  uint64_t steps;       /* free chunks walked for the callback info */
+  uint32_t steps_max;
+  uint64_t time_ns;
+  double frag_sum;
+  double frag_max;
+  size_t brk_max;
+  uint32_t outstanding_max;
+  uint32_t pool_max;    /* pool entries held at most */
+  uint32_t exhausted;   /* allocations done with all pool entries held */
+} BENCH_Results_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+static BENCH_Request_t bench_requests[BENCH_OUTSTANDING_MAX];
+static uint32_t bench_nb_requests;
+static BENCH_LongLived_t bench_long_lived[BENCH_LONG_LIVED_MAX];
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint64_t BENCH_Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/* Free chunks walked by the heap so far */
+static uint64_t BENCH_Steps(void)
+{
+  HOST_HeapStats_t stats;
+
+  HOST_HeapGetStats(&stats);
+  return stats.steps;
+}
+
+static void BENCH_Callback(void)
+{
+}
+
+/* Callback info of a request, from the pool or from the heap as before it */
+static struct zb_ipc_m4_cb_info_t * BENCH_InfoAlloc(uint8_t pool, BENCH_Results_t *results)
+{
+  struct zb_ipc_m4_cb_info_t *info;
+  uint64_t steps = BENCH_Steps();
+  uint64_t start = BENCH_Now();
+
+  if (pool != 0U)
+  {
+    info = zb_ipc_m4_cb_info_alloc((void *)BENCH_Callback, results);
+  }
+  else
+  {
+    info = malloc(sizeof(struct zb_ipc_m4_cb_info_t));
+    if (info != NULL)
+    {
+      memset(info, 0, sizeof(struct zb_ipc_m4_cb_info_t));
+      info->callback = (void *)BENCH_Callback;
+      info->arg = results;
+    }
+  }
+
+  results->time_ns += BENCH_Now() - start;
+  steps = BENCH_Steps() - steps;
+  results->nb_alloc++;
+  results->steps += steps;
+  if (steps > results->steps_max)
+  {
+    results->steps_max = steps;
+  }
+  return info;
+}
+
+static void BENCH_InfoFree(uint8_t pool, BENCH_Results_t *results, struct zb_ipc_m4_cb_info_t *info)
+{
+  uint64_t steps = BENCH_Steps();
+
+  if (pool != 0U)
+  {
+    zb_ipc_m4_cb_info_free(info);
+  }
+  else
+  {
+    free(info);
+  }
+  results->steps += BENCH_Steps() - steps;
+}
+
+/* Pending requests holding an entry of the pool */
+static uint32_t BENCH_PoolInUse(void)
+{
+  uint32_t nb = 0U;
+
+  for (uint32_t i = 0; i < bench_nb_requests; i++)
+  {
+    if ((bench_requests[i].info >= &zb_ipc_cb_pool.info[0]) &&
+        (bench_requests[i].info < &zb_ipc_cb_pool.info[ZB_IPC_CB_INFO_POOL_SZ]))
+    {
+      nb++;
+    }
+  }
+  return nb;
+}
+
+/* Response of a pending request, in a random order */
+static void BENCH_Complete(uint8_t pool, BENCH_Results_t *results)
+{
+  uint32_t i = (uint32_t)rand() % bench_nb_requests;
+
+  BENCH_InfoFree(pool, results, bench_requests[i].info);
+  free(bench_requests[i].payload);
+  bench_requests[i] = bench_requests[--bench_nb_requests];
+}
+
+static int BENCH_Submit(uint8_t pool, BENCH_Results_t *results, uint32_t burst)
+{
+  BENCH_Request_t *request = &bench_requests[bench_nb_requests];
+  uint32_t in_use = BENCH_PoolInUse();
+  uint32_t i;
+
+  if ((pool != 0U) && (in_use == ZB_IPC_CB_INFO_POOL_SZ))
+  {
+    results->exhausted++;
+  }
+
+  /* ZCL payload, then the callback info of the request */
+  request->payload = malloc(24U + ((uint32_t)rand() % 136U));
+  request->info = BENCH_InfoAlloc(pool, results);
+  CHECK((request->payload != NULL) && (request->info != NULL));
+  bench_nb_requests++;
+  if (bench_nb_requests > results->outstanding_max)
+  {
+    results->outstanding_max = bench_nb_requests;
+  }
+  in_use = BENCH_PoolInUse();
+  if (in_use > results->pool_max)
+  {
+    results->pool_max = in_use;
+  }
+
+  /* One in 8 leaves a long lived allocation behind */
+  if ((rand() % 8) == 0)
+  {
+    i = (uint32_t)rand() % BENCH_LONG_LIVED_MAX;
+    free(bench_long_lived[i].ptr);
+    bench_long_lived[i].ptr = malloc(16U + ((uint32_t)rand() % 240U));
+    bench_long_lived[i].expiry = burst + 1U + ((uint32_t)rand() % 200U);
+    CHECK(bench_long_lived[i].ptr != NULL);
+  }
+  return 0;
+}
+
+static int BENCH_Run(uint8_t pool, BENCH_Results_t *results)
+{
+  struct ZbIpcCbPoolStatsT stats;
+  HOST_HeapStats_t heap;
+  double frag;
+  uint32_t nb;
+
+  srand(BENCH_SEED);
+  HOST_HeapReset();
+  memset(&zb_ipc_cb_pool, 0, sizeof(zb_ipc_cb_pool));
+  memset(bench_long_lived, 0, sizeof(bench_long_lived));
+  bench_nb_requests = 0U;
+
+  for (uint32_t burst = 0; burst < BENCH_BURSTS; burst++)
+  {
+    /* Burst of requests, some responses coming back meanwhile */
+    nb = 1U + ((uint32_t)rand() % BENCH_BURST_MAX);
+    for (uint32_t i = 0; i < nb; i++)
+    {
+      if ((bench_nb_requests != 0U) && ((rand() % 4) == 0))
+      {
+        BENCH_Complete(pool, results);
+      }
+      if ((bench_nb_requests < BENCH_OUTSTANDING_MAX) && (BENCH_Submit(pool, results, burst) != 0))
+      {
+        return 1;
+      }
+    }
+
+    /* Most of the responses before the next burst */
+    nb = bench_nb_requests - (bench_nb_requests / 4U);
+    for (uint32_t i = 0; i < nb; i++)
+    {
+      BENCH_Complete(pool, results);
+    }
+    for (uint32_t i = 0; i < BENCH_LONG_LIVED_MAX; i++)
+    {
+      if ((bench_long_lived[i].ptr != NULL) && (bench_long_lived[i].expiry <= burst))
+      {
+        free(bench_long_lived[i].ptr);
+        bench_long_lived[i].ptr = NULL;
+      }
+    }
+
+    HOST_HeapGetStats(&heap);
+    frag = HOST_HeapFragmentation(&heap);
+    results->frag_sum += frag;
+    if (frag > results->frag_max)
+    {
+      results->frag_max = frag;
+    }
+  }
+
+  while (bench_nb_requests != 0U)
+  {
+    BENCH_Complete(pool, results);
+  }
+  for (uint32_t i = 0; i < BENCH_LONG_LIVED_MAX; i++)
+  {
+    free(bench_long_lived[i].ptr);
+  }
+
+  /* Everything freed: a single free chunk up to the break */
+  HOST_HeapGetStats(&heap);
+  CHECK((heap.free_chunks == 1U) && (heap.free_bytes == heap.brk));
+  results->brk_max = heap.brk_max;
+
+  if (pool != 0U)
+  {
+    ZbIpcCbPoolStats(&stats);
+    CHECK((stats.size == ZB_IPC_CB_INFO_POOL_SZ) && (stats.in_use == 0U) && (stats.heap_in_use == 0U));
+    CHECK(stats.high_water == results->pool_max);
+    CHECK(stats.exhausted == results->exhausted);
+  }
+  return 0;
+}
+
+static void BENCH_Print(const BENCH_Results_t *results)
+{
+  printf("%-6s | %8.2f %6u | %8.1f | %6.3f %6.3f | %6u\n", results->name,
+         (double)results->steps / (double)results->nb_alloc, (unsigned)results->steps_max,
+         (double)results->time_ns / (double)results->nb_alloc,
+         results->frag_sum / BENCH_BURSTS, results->frag_max, (unsigned)results->brk_max);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+int main(void)
+{
+  static BENCH_Results_t results[2] = { { .name = "pool" }, { .name = "heap" } };
+
+  if ((BENCH_Run(1U, &results[0]) != 0) || (BENCH_Run(0U, &results[1]) != 0))
+  {
+    return 1;
+  }
+
+  printf("%u bursts of up to %u requests, %u entries in the pool, %u requests pending at most\n",
+         (unsigned)BENCH_BURSTS, (unsigned)BENCH_BURST_MAX, (unsigned)ZB_IPC_CB_INFO_POOL_SZ,
+         (unsigned)results[0].outstanding_max);
+  printf("%u allocations done with the pool empty (heap used)\n", (unsigned)results[0].exhausted);
+  printf("%-6s | %8s %6s | %8s | %6s %6s | %6s\n", "info", "walk", "max", "ns",
+         "frag", "max", "brk");
+  BENCH_Print(&results[0]);
+  BENCH_Print(&results[1]);
+  return 0;
+}
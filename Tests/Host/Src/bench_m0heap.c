@@ -0,0 +1,583 @@
+/**
+  ******************************************************************************
+  * @file    bench_m0heap.c
+  * @author  MCD Application Team
+  * @brief   Trace replay and fuzz test of the heap of the M0 memory requests
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/*
+  zigbee_core_wb.c is included: its buddy heap (zb_m0_heap_alloc/free) serves
+  the requests as Zigbee_M0RequestProcessing() does (size header included),
+  the fallback malloc() being the one of the host.
+
+  bench_m0heap <trace>
+    Replays a trace of the M0 requests, as dumped by ZbM0HeapTraceDump():
+    "a <ptr> <size>" or "f <ptr>" per line, '#' starting a comment. The same
+    requests are served by the model of the newlib-nano heap (host_heap.h)
+    which served them before. Reported for both: work per request (splits
+    and merges of the buddy heap, free chunks walked by the heap model),
+    host ns per request (indicative only), peak usage and fragmentation
+    (1 - largest free block / free bytes) after each request.
+
+  bench_m0heap -f <seed> <requests>
+    Random requests (sizes up to ZB_HEAP_MAX_ALLOC, the region filled up to
+    the fallback), the whole heap being checked after each one: free lists
+    and their bitmap, no free buddies left unmerged, usage counters, content
+    of the live allocations.
+
+  bench_m0heap -g <trace>
+    Writes a trace generated from a model of the stack requests (tables at
+    startup, then the frames, timers and buffers of the join and of the
+    traffic), for want of a recording.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "host_heap.h"
+
+#include "zigbee_core_wb.c"
+
+/* Private defines -----------------------------------------------------------*/
+
+#define BENCH_M0_HDR               4U     /* size header added by Zigbee_M0RequestProcessing */
+#define BENCH_LIVE_MAX             1024U  /* live allocations of a trace */
+#define BENCH_MAP_SIZE             4096U  /* open addressing, power of two */
+#define BENCH_FUZZ_LIVE_MAX        512U
+#define BENCH_REGION_SIZE          (1UL << ZB_M0_HEAP_ORDER)
+
+#define CHECK(c) do { if (!(c)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c); return 1; } } while (0)
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  unsigned long key;    /* pointer of the trace, 0: empty slot */
+  void *buddy;
+  void *model;
+  uint32_t sz;
+} BENCH_Live_t;
+
+typedef struct
+{
+  const char *name;
+  uint64_t nb;
+  uint64_t work;        /* splits and merges, or free chunks walked */
+  uint32_t work_max;
+  uint64_t time_ns;
+  double frag_sum;
+  double frag_max;
+  uint32_t peak;        /* bytes used at most (region, or below the break) */
+} BENCH_Results_t;
+
+typedef struct
+{
+  uint32_t id;
+  uint32_t expiry;      /* request number of its free */
+} BENCH_GenLive_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+static BENCH_Live_t bench_map[BENCH_MAP_SIZE];
+static uint32_t bench_nb_live;
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint64_t BENCH_Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static void BENCH_Account(BENCH_Results_t *results, uint32_t work, uint64_t time_ns)
+{
+  results->nb++;
+  results->work += work;
+  results->time_ns += time_ns;
+  if (work > results->work_max)
+  {
+    results->work_max = work;
+  }
+}
+
+static void BENCH_Fragmentation(BENCH_Results_t *results, double frag)
+{
+  results->frag_sum += frag;
+  if (frag > results->frag_max)
+  {
+    results->frag_max = frag;
+  }
+}
+
+static uint8_t BENCH_InRegion(const void *ptr)
+{
+  const uint8_t *region = (const uint8_t *)zb_m0_heap_region;
+
+  return (((const uint8_t *)ptr >= region) && ((const uint8_t *)ptr < (region + BENCH_REGION_SIZE))) ? 1U : 0U;
+}
+
+/* Buddy heap: the splits of an allocation and the merges of a free are
+   given by the change of the number of free blocks (none from malloc) */
+static void * BENCH_BuddyAlloc(BENCH_Results_t *results, uint32_t sz)
+{
+  uint32_t free_blocks = zb_m0_heap.stats.free_blocks;
+  uint64_t start = BENCH_Now();
+  void *ptr = zb_m0_heap_alloc(sz + BENCH_M0_HDR);
+  uint64_t time_ns = BENCH_Now() - start;
+
+  BENCH_Account(results, (BENCH_InRegion(ptr) != 0U) ? ((zb_m0_heap.stats.free_blocks + 1U) - free_blocks) : 0U,
+                time_ns);
+  return ptr;
+}
+
+static void BENCH_BuddyFree(BENCH_Results_t *results, void *ptr)
+{
+  uint32_t free_blocks = zb_m0_heap.stats.free_blocks;
+  uint8_t in_region = BENCH_InRegion(ptr);
+  uint64_t start = BENCH_Now();
+  uint64_t time_ns;
+
+  zb_m0_heap_free(ptr);
+  time_ns = BENCH_Now() - start;
+  BENCH_Account(results, (in_region != 0U) ? ((free_blocks + 1U) - zb_m0_heap.stats.free_blocks) : 0U, time_ns);
+}
+
+static void BENCH_BuddySample(BENCH_Results_t *results)
+{
+  struct ZbM0HeapStatsT stats;
+  uint32_t free_bytes;
+
+  ZbM0HeapStats(&stats);
+  free_bytes = stats.size - stats.used;
+  BENCH_Fragmentation(results, (free_bytes == 0U) ? 0.0 : (1.0 - ((double)stats.largest_free / free_bytes)));
+  results->peak = stats.used_max;
+}
+
+/* Heap model, as before the buddy heap */
+static void * BENCH_ModelAlloc(BENCH_Results_t *results, uint32_t sz)
+{
+  HOST_HeapStats_t stats;
+  uint64_t steps, start;
+  void *ptr;
+
+  HOST_HeapGetStats(&stats);
+  steps = stats.steps;
+  start = BENCH_Now();
+  ptr = HOST_HeapMalloc(sz + BENCH_M0_HDR);
+  start = BENCH_Now() - start;
+  HOST_HeapGetStats(&stats);
+  BENCH_Account(results, (uint32_t)(stats.steps - steps), start);
+  return ptr;
+}
+
+static void BENCH_ModelFree(BENCH_Results_t *results, void *ptr)
+{
+  HOST_HeapStats_t stats;
+  uint64_t steps, start;
+
+  HOST_HeapGetStats(&stats);
+  steps = stats.steps;
+  start = BENCH_Now();
+  HOST_HeapFree(ptr);
+  start = BENCH_Now() - start;
+  HOST_HeapGetStats(&stats);
+  BENCH_Account(results, (uint32_t)(stats.steps - steps), start);
+}
+
+static void BENCH_ModelSample(BENCH_Results_t *results)
+{
+  HOST_HeapStats_t stats;
+
+  HOST_HeapGetStats(&stats);
+  BENCH_Fragmentation(results, HOST_HeapFragmentation(&stats));
+  results->peak = (uint32_t)stats.brk_max;
+}
+
+/* Live allocation of the trace with this pointer, or the empty slot for it */
+static BENCH_Live_t * BENCH_MapFind(unsigned long key)
+{
+  uint32_t i = (uint32_t)((key >> 3) * 2654435761UL) & (BENCH_MAP_SIZE - 1U);
+
+  while ((bench_map[i].key != 0UL) && (bench_map[i].key != key))
+  {
+    i = (i + 1U) & (BENCH_MAP_SIZE - 1U);
+  }
+  return &bench_map[i];
+}
+
+/* Removal by backward shift, as the allocation table of zigbee_core_wb.c */
+static void BENCH_MapRemove(BENCH_Live_t *entry)
+{
+  uint32_t i = (uint32_t)(entry - bench_map);
+  uint32_t j = i;
+  uint32_t home;
+
+  for (;;)
+  {
+    j = (j + 1U) & (BENCH_MAP_SIZE - 1U);
+    if (bench_map[j].key == 0UL)
+    {
+      break;
+    }
+    home = (uint32_t)((bench_map[j].key >> 3) * 2654435761UL) & (BENCH_MAP_SIZE - 1U);
+    if (((j - home) & (BENCH_MAP_SIZE - 1U)) < ((j - i) & (BENCH_MAP_SIZE - 1U)))
+    {
+      continue;
+    }
+    bench_map[i] = bench_map[j];
+    i = j;
+  }
+  bench_map[i].key = 0UL;
+  bench_nb_live--;
+}
+
+static int BENCH_Replay(const char *path)
+{
+  BENCH_Results_t results[2] = { { .name = "buddy" }, { .name = "heap" } };
+  struct ZbM0HeapStatsT stats;
+  BENCH_Live_t *entry;
+  unsigned long key, sz;
+  uint32_t nb_alloc = 0U, nb_free = 0U, nb_unknown = 0U, live_max = 0U;
+  char line[128];
+  char op;
+  FILE *file = fopen(path, "r");
+
+  CHECK(file != NULL);
+  HOST_HeapReset();
+
+  while (fgets(line, sizeof(line), file) != NULL)
+  {
+    if ((line[0] == '#') || (line[0] == '\n'))
+    {
+      continue;
+    }
+    if ((sscanf(line, "%c %lx %lu", &op, &key, &sz) == 3) && (op == 'a'))
+    {
+      entry = BENCH_MapFind(key);
+      CHECK((entry->key == 0UL) && (key != 0UL) && (bench_nb_live < BENCH_LIVE_MAX));
+      entry->key = key;
+      entry->sz = (uint32_t)sz;
+      entry->buddy = BENCH_BuddyAlloc(&results[0], (uint32_t)sz);
+      entry->model = BENCH_ModelAlloc(&results[1], (uint32_t)sz);
+      CHECK((entry->buddy != NULL) && (entry->model != NULL));
+      bench_nb_live++;
+      nb_alloc++;
+      if (bench_nb_live > live_max)
+      {
+        live_max = bench_nb_live;
+      }
+    }
+    else if ((sscanf(line, "%c %lx", &op, &key) == 2) && (op == 'f'))
+    {
+      entry = BENCH_MapFind(key);
+      if (entry->key == 0UL)
+      {
+        /* Allocated before the start of the recording */
+        nb_unknown++;
+        continue;
+      }
+      BENCH_BuddyFree(&results[0], entry->buddy);
+      BENCH_ModelFree(&results[1], entry->model);
+      BENCH_MapRemove(entry);
+      nb_free++;
+    }
+    else
+    {
+      printf("FAIL: bad trace line: %s", line);
+      fclose(file);
+      return 1;
+    }
+    BENCH_BuddySample(&results[0]);
+    BENCH_ModelSample(&results[1]);
+  }
+  fclose(file);
+  ZbM0HeapStats(&stats);
+
+  printf("%s: %u allocations, %u frees (%u unknown), %u live at most\n", path,
+         (unsigned)nb_alloc, (unsigned)nb_free, (unsigned)nb_unknown, (unsigned)live_max);
+  printf("buddy region %u bytes: %u used at most, %u from malloc (region full), %u failed\n",
+         (unsigned)stats.size, (unsigned)results[0].peak, (unsigned)stats.fallback_cnt, (unsigned)stats.fail_cnt);
+  printf("%-6s | %6s %5s | %6s | %6s %6s | %6s\n", "heap", "work", "max", "ns", "frag", "max", "peak");
+  for (uint32_t i = 0; i < 2U; i++)
+  {
+    printf("%-6s | %6.2f %5u | %6.1f | %6.3f %6.3f | %6u\n", results[i].name,
+           (double)results[i].work / (double)results[i].nb, (unsigned)results[i].work_max,
+           (double)results[i].time_ns / (double)results[i].nb,
+           results[i].frag_sum / (double)results[i].nb, results[i].frag_max, (unsigned)results[i].peak);
+  }
+
+  /* Bounded work: at most one split or merge per block size */
+  CHECK(results[0].work_max <= (ZB_M0_HEAP_ORDER - ZB_M0_HEAP_MIN_ORDER + 1U));
+  return 0;
+}
+
+/* Whole heap check: free lists, bitmap, merges, counters */
+static int BENCH_Check(uint32_t used, uint32_t requested)
+{
+  struct zb_m0_heap_block_t *block, *buddy;
+  uint32_t free_bytes = 0U, free_blocks = 0U;
+  uint32_t order, offset, prev;
+
+  for (order = 0U; order <= ZB_M0_HEAP_ORDER; order++)
+  {
+    CHECK(((zb_m0_heap.avail >> order) & 1U) == (zb_m0_heap.free_list[order] != NULL));
+    prev = ZB_M0_HEAP_NONE;
+    for (block = zb_m0_heap.free_list[order]; block != NULL;
+         block = (block->next != ZB_M0_HEAP_NONE) ? ZB_M0_HEAP_BLOCK(block->next) : NULL)
+    {
+      offset = ZB_M0_HEAP_OFFSET(block);
+      CHECK((order >= ZB_M0_HEAP_MIN_ORDER) && ((offset & ((1UL << order) - 1U)) == 0U));
+      CHECK((block->tag == ZB_M0_HEAP_TAG_FREE) && (block->order == order) && (block->prev == prev));
+      if (order < ZB_M0_HEAP_ORDER)
+      {
+        buddy = ZB_M0_HEAP_BLOCK(offset ^ (1UL << order));
+        CHECK((buddy->tag != ZB_M0_HEAP_TAG_FREE) || (buddy->order != order));
+      }
+      free_bytes += 1UL << order;
+      free_blocks++;
+      prev = offset;
+    }
+  }
+  CHECK(free_blocks == zb_m0_heap.stats.free_blocks);
+  CHECK((free_bytes + zb_m0_heap.stats.used) == BENCH_REGION_SIZE);
+  CHECK((zb_m0_heap.stats.used == used) && (zb_m0_heap.stats.requested == requested));
+  return 0;
+}
+
+static uint32_t BENCH_FuzzSize(void)
+{
+  uint32_t r = (uint32_t)rand() % 100U;
+
+  if (r < 70U)
+  {
+    return 1U + ((uint32_t)rand() % 128U);
+  }
+  if (r < 95U)
+  {
+    return 128U + ((uint32_t)rand() % 896U);
+  }
+  return 1024U + ((uint32_t)rand() % (ZB_HEAP_MAX_ALLOC - 1024U));
+}
+
+static uint32_t BENCH_BlockSize(uint32_t sz)
+{
+  uint32_t need = sz + BENCH_M0_HDR + ZB_M0_HEAP_HDR_SZ;
+  uint32_t size = 1UL << ZB_M0_HEAP_MIN_ORDER;
+
+  while (size < need)
+  {
+    size <<= 1;
+  }
+  return size;
+}
+
+static int BENCH_Fuzz(unsigned int seed, uint32_t nb_requests)
+{
+  static struct
+  {
+    uint8_t *ptr;
+    uint32_t sz;
+    uint8_t pattern;
+  } live[BENCH_FUZZ_LIVE_MAX];
+  uint32_t nb_live = 0U, used = 0U, requested = 0U, nb_fallback = 0U, used_max = 0U;
+  uint32_t i, j;
+
+  srand(seed);
+  for (uint32_t n = 0; n < nb_requests; n++)
+  {
+    if ((nb_live < BENCH_FUZZ_LIVE_MAX) && ((nb_live == 0U) || ((rand() % 100) < 52)))
+    {
+      live[nb_live].sz = BENCH_FuzzSize();
+      live[nb_live].ptr = zb_m0_heap_alloc(live[nb_live].sz + BENCH_M0_HDR);
+      live[nb_live].pattern = (uint8_t)rand();
+      CHECK(live[nb_live].ptr != NULL);
+      if (BENCH_InRegion(live[nb_live].ptr) != 0U)
+      {
+        CHECK(((uintptr_t)live[nb_live].ptr & 7U) == 0U);
+        used += BENCH_BlockSize(live[nb_live].sz);
+        requested += live[nb_live].sz + BENCH_M0_HDR;
+      }
+      else
+      {
+        nb_fallback++;
+      }
+      memset(live[nb_live].ptr, live[nb_live].pattern, live[nb_live].sz + BENCH_M0_HDR);
+      nb_live++;
+    }
+    else
+    {
+      i = (uint32_t)rand() % nb_live;
+      for (j = 0; j < live[i].sz + BENCH_M0_HDR; j++)
+      {
+        CHECK(live[i].ptr[j] == live[i].pattern);
+      }
+      if (BENCH_InRegion(live[i].ptr) != 0U)
+      {
+        used -= BENCH_BlockSize(live[i].sz);
+        requested -= live[i].sz + BENCH_M0_HDR;
+      }
+      zb_m0_heap_free(live[i].ptr);
+      live[i] = live[--nb_live];
+    }
+    if (used > used_max)
+    {
+      used_max = used;
+    }
+    if (BENCH_Check(used, requested) != 0)
+    {
+      printf("FAIL: request %u\n", (unsigned)n);
+      return 1;
+    }
+  }
+
+  while (nb_live != 0U)
+  {
+    zb_m0_heap_free(live[--nb_live].ptr);
+  }
+  CHECK((zb_m0_heap.stats.free_blocks == 1U) && (zb_m0_heap.free_list[ZB_M0_HEAP_ORDER] != NULL));
+  CHECK(zb_m0_heap.stats.fallback_cnt == nb_fallback);
+
+  printf("fuzz seed %u: %u requests checked, region %u bytes used at most, %u from malloc (region full)\n",
+         seed, (unsigned)nb_requests, (unsigned)used_max, (unsigned)nb_fallback);
+  return 0;
+}
+
+/* Size in [min, max] */
+static uint32_t BENCH_GenSize(uint32_t min, uint32_t max)
+{
+  return min + ((uint32_t)rand() % (max - min + 1U));
+}
+
+static void BENCH_GenAlloc(FILE *file, BENCH_GenLive_t *live, uint32_t *nb_live, uint32_t *next_id,
+                           uint32_t n, uint32_t sz, uint32_t lifetime)
+{
+  /* The pointers are identifiers, never reused */
+  live[*nb_live].id = (*next_id)++;
+  live[*nb_live].expiry = (lifetime == 0U) ? UINT32_MAX : (n + lifetime);
+  fprintf(file, "a %lx %u\n", 0x20008000UL + (8UL * live[*nb_live].id), (unsigned)sz);
+  (*nb_live)++;
+}
+
+static int BENCH_Generate(const char *path)
+{
+  static BENCH_GenLive_t live[BENCH_LIVE_MAX];
+  uint32_t nb_live = 0U, next_id = 0U, n, i, r;
+  FILE *file = fopen(path, "w");
+
+  CHECK(file != NULL);
+  srand(1U);
+  fprintf(file, "# M0 memory requests generated by bench_m0heap -g (model of the stack,\n");
+  fprintf(file, "# not a recording): tables at startup, join, then ZCL traffic\n");
+
+  /* Tables and contexts allocated at startup, never freed */
+  for (i = 0; i < 12U; i++)
+  {
+    BENCH_GenAlloc(file, live, &nb_live, &next_id, 0U, BENCH_GenSize(32U, (i < 2U) ? 512U : 160U), 0U);
+  }
+
+  for (n = 0; n < 4000U; n++)
+  {
+    /* Releases due */
+    for (i = 0; i < nb_live; )
+    {
+      if (live[i].expiry <= n)
+      {
+        fprintf(file, "f %lx\n", 0x20008000UL + (8UL * live[i].id));
+        live[i] = live[--nb_live];
+      }
+      else
+      {
+        i++;
+      }
+    }
+    if (nb_live >= (BENCH_LIVE_MAX - 1U))
+    {
+      continue;
+    }
+
+    r = (uint32_t)rand() % 100U;
+    if (n < 400U)
+    {
+      /* Join: frames, timers, neighbour and route entries */
+      if (r < 55U)
+      {
+        BENCH_GenAlloc(file, live, &nb_live, &next_id, n, BENCH_GenSize(60U, 180U), BENCH_GenSize(1U, 8U));
+      }
+      else if (r < 80U)
+      {
+        BENCH_GenAlloc(file, live, &nb_live, &next_id, n, BENCH_GenSize(24U, 40U), BENCH_GenSize(2U, 60U));
+      }
+      else if (r < 85U)
+      {
+        BENCH_GenAlloc(file, live, &nb_live, &next_id, n, BENCH_GenSize(32U, 64U), BENCH_GenSize(200U, 1500U));
+      }
+      else
+      {
+        BENCH_GenAlloc(file, live, &nb_live, &next_id, n, BENCH_GenSize(16U, 96U), BENCH_GenSize(2U, 20U));
+      }
+    }
+    else if (r < 60U)
+    {
+      /* Frames in and out */
+      BENCH_GenAlloc(file, live, &nb_live, &next_id, n, BENCH_GenSize(64U, 200U), BENCH_GenSize(1U, 6U));
+    }
+    else if (r < 80U)
+    {
+      /* Timers */
+      BENCH_GenAlloc(file, live, &nb_live, &next_id, n, BENCH_GenSize(24U, 40U), BENCH_GenSize(1U, 50U));
+    }
+    else if (r < 97U)
+    {
+      /* ZCL requests and responses */
+      BENCH_GenAlloc(file, live, &nb_live, &next_id, n, BENCH_GenSize(16U, 96U), BENCH_GenSize(2U, 20U));
+    }
+    else if (r < 99U)
+    {
+      /* Table entries */
+      BENCH_GenAlloc(file, live, &nb_live, &next_id, n, BENCH_GenSize(32U, 128U), BENCH_GenSize(200U, 1500U));
+    }
+    else
+    {
+      /* Fragmented transfers (APS) */
+      BENCH_GenAlloc(file, live, &nb_live, &next_id, n, BENCH_GenSize(256U, 1024U), BENCH_GenSize(2U, 10U));
+    }
+  }
+  fclose(file);
+  printf("%s: %u allocations generated\n", path, (unsigned)next_id);
+  return 0;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+  if ((argc == 4) && (strcmp(argv[1], "-f") == 0))
+  {
+    return BENCH_Fuzz((unsigned int)strtoul(argv[2], NULL, 0), (uint32_t)strtoul(argv[3], NULL, 0));
+  }
+  if ((argc == 3) && (strcmp(argv[1], "-g") == 0))
+  {
+    return BENCH_Generate(argv[2]);
+  }
+  if (argc == 2)
+  {
+    return BENCH_Replay(argv[1]);
+  }
+
+  printf("usage: %s <trace> | -f <seed> <requests> | -g <trace>\n", argv[0]);
+  return 1;
+}
@@ -0,0 +1,218 @@
+/**
+  ******************************************************************************
+  * @file    bench_nvm.c
+  * @author  MCD Application Team
+  * @brief   Flash cost of the persistence workloads of the Zigbee applications
+  *          on the host flash model
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/*
+  Replays the persistence workloads of a device (save after joining, saves
+  of the frequent small changes of the stack state, save of a big change,
+  update of an application record, restore at boot) through app_nvm.c, and
+  reports for each one the flash words read and programmed, the pages erased
+  and the simulated time (flash operations at their typical duration) per
+  operation. The background clean of the standby pools is reported apart.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "app_nvm.h"
+#include "ee.h"
+
+/* Private defines -----------------------------------------------------------*/
+
+#define BENCH_SEED                 5U
+#define BENCH_STATE_LEN            3000U
+#define BENCH_SMALL_SAVES          500U
+#define BENCH_BIG_SAVES            20U
+#define BENCH_RECORD_UPDATES       200U
+#define BENCH_RESTORES             20U
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  HOST_FlashStats_t start;
+  HOST_FlashStats_t total;
+  uint32_t nb;
+} BENCH_Meter_t;
+
+typedef struct
+{
+  uint8_t state[ST_PERSIST_MAX_ALLOC_SZ];
+  BENCH_Meter_t join;
+  BENCH_Meter_t small;
+  BENCH_Meter_t big;
+  BENCH_Meter_t record;
+  BENCH_Meter_t clean;
+  BENCH_Meter_t cold;
+  BENCH_Meter_t warm;
+} BENCH_Results_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+static BENCH_Results_t *results;
+static uint8_t bench_record[16];
+
+/* Private functions ---------------------------------------------------------*/
+
+void App_Core_Restore_State(void)
+{
+}
+
+void App_Core_Fast_Restore(void)
+{
+}
+
+static void BENCH_Start(BENCH_Meter_t *meter)
+{
+  HOST_FlashGetStats(&meter->start);
+}
+
+static void BENCH_Stop(BENCH_Meter_t *meter)
+{
+  HOST_FlashStats_t now;
+
+  HOST_FlashGetStats(&now);
+  meter->total.reads += now.reads - meter->start.reads;
+  meter->total.programs += now.programs - meter->start.programs;
+  meter->total.erases += now.erases - meter->start.erases;
+  meter->total.time_ns += now.time_ns - meter->start.time_ns;
+  meter->nb++;
+}
+
+static void BENCH_Print(const char *name, const BENCH_Meter_t *meter)
+{
+  double nb = (meter->nb != 0U) ? (double)meter->nb : 1.0;
+
+  printf("%-28s %6u %10.1f %10.1f %8.3f %12.1f\n", name, (unsigned)meter->nb,
+         meter->total.reads / nb, meter->total.programs / nb,
+         meter->total.erases / nb, meter->total.time_ns / nb / 1000.0);
+}
+
+/* Changes n random bytes of the state, a part of them being zeroed */
+static void BENCH_Change(uint32_t n)
+{
+  while (n-- != 0U)
+  {
+    results->state[rand() % BENCH_STATE_LEN] = (rand() % 3) ? (uint8_t)rand() : 0U;
+  }
+  HOST_ZigbeeSetState(results->state, BENCH_STATE_LEN);
+}
+
+/* Save of a change, the background clean being run apart */
+static void BENCH_Save(BENCH_Meter_t *meter, uint32_t change)
+{
+  BENCH_Change(change);
+  BENCH_Start(meter);
+  (void)App_Persist_Save(NULL);
+  BENCH_Stop(meter);
+
+  BENCH_Start(&results->clean);
+  (void)HOST_RunUntilIdle(60000U);
+  BENCH_Stop(&results->clean);
+}
+
+static int BENCH_Device(void *arg)
+{
+  (void)arg;
+
+  App_NVM_Init(HOST_ResetFlags);
+  (void)HOST_RunUntilIdle(60000U);
+
+  /* Network joined: first save */
+  for (uint32_t i = 0; i < BENCH_STATE_LEN; i++)
+  {
+    results->state[i] = (rand() % 2) ? (uint8_t)rand() : 0U;
+  }
+  BENCH_Save(&results->join, 0U);
+
+  /* Frame counters, neighbor table updates... */
+  for (uint32_t i = 0; i < BENCH_SMALL_SAVES; i++)
+  {
+    BENCH_Save(&results->small, 1U + (uint32_t)(rand() % 8));
+  }
+
+  /* Binding table, groups rewritten */
+  for (uint32_t i = 0; i < BENCH_BIG_SAVES; i++)
+  {
+    BENCH_Save(&results->big, BENCH_STATE_LEN / 2U);
+  }
+
+  /* Application state (e.g. light level), one byte changed */
+  (void)App_NVM_Record_Register(1U, 1U, bench_record, sizeof(bench_record));
+  for (uint32_t i = 0; i < BENCH_RECORD_UPDATES; i++)
+  {
+    bench_record[rand() % sizeof(bench_record)] = (uint8_t)rand();
+    BENCH_Start(&results->record);
+    (void)App_NVM_Record_SetDirty(1U);
+    App_NVM_Record_Flush();
+    BENCH_Stop(&results->record);
+  }
+  return 0;
+}
+
+static int BENCH_Restore(void *arg)
+{
+  BENCH_Meter_t *meter = arg;
+  bool status;
+
+  BENCH_Start(meter);
+  App_NVM_Init(HOST_ResetFlags);
+  status = App_NVM_Read();
+  BENCH_Stop(meter);
+
+  App_NVM_Shutdown();
+  if (status && (meter == &results->cold))
+  {
+    NVIC_SystemReset();
+  }
+  return status ? 0 : 1;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+int main(void)
+{
+  srand(BENCH_SEED);
+  HOST_Init();
+  results = HOST_SharedAlloc(sizeof(BENCH_Results_t));
+
+  if (HOST_Boot(HOST_RESET_POWER_ON, BENCH_Device, NULL) != HOST_BOOT_RETURNED)
+  {
+    printf("FAIL: workload\n");
+    return 1;
+  }
+  for (uint32_t i = 0; i < BENCH_RESTORES; i++)
+  {
+    if ((HOST_Boot(HOST_RESET_POWER_ON, BENCH_Restore, &results->cold) != HOST_BOOT_SOFTWARE_RESET) ||
+        (HOST_Boot(HOST_RESET_SOFTWARE, BENCH_Restore, &results->warm) != HOST_BOOT_RETURNED))
+    {
+      printf("FAIL: restore\n");
+      return 1;
+    }
+  }
+
+  printf("%-28s %6s %10s %10s %8s %12s\n", "per operation", "nb", "reads", "programs", "erases", "time (us)");
+  BENCH_Print("save after join", &results->join);
+  BENCH_Print("save of 1-8 bytes changed", &results->small);
+  BENCH_Print("save of 1500 bytes changed", &results->big);
+  BENCH_Print("record update (1 byte)", &results->record);
+  BENCH_Print("background clean (per save)", &results->clean);
+  BENCH_Print("restore, cold boot", &results->cold);
+  BENCH_Print("restore, warm boot", &results->warm);
+  return 0;
+}
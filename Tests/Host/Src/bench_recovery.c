@@ -0,0 +1,233 @@
+/**
+  ******************************************************************************
+  * @file    bench_recovery.c
+  * @author  MCD Application Team
+  * @brief   EE_Init time per page state combination on the host flash model
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/*
+  The bank 0 is formatted, then filled by single writes on a set of live
+  variables until the state of the case is reached (write page, interrupted
+  transfer or page change, standby pool left dirty, clean shutdown). The
+  next boot runs EE_Init: the time of each step given by EE_GetInitProfile
+  (cycle counter following the simulated time) and the flash words read and
+  programmed are reported, so that the bound documented in ee.h (Recovery
+  time) can be checked for each combination.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "ee_cfg.h"
+#include "ee.h"
+
+/* Private defines -----------------------------------------------------------*/
+
+#define BENCH_EE_BASE              (FLASH_BASE + 0x70000U)
+#define BENCH_LIVE_VARS            300U
+#define BENCH_PAGE_ELTS            ((HW_FLASH_PAGE_SIZE / 8U) - 4U)
+#define BENCH_POOL_PAGES           (CFG_EE_BANK0_NB_OF_PAGE / 2U)
+#define BENCH_POOL_ELTS            (BENCH_POOL_PAGES * BENCH_PAGE_ELTS)
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  const char *name;
+  uint32_t used;        /* elements written in the pool before the reset */
+  uint8_t  transfer;    /* first filled until a pool transfer (no clean) */
+  uint8_t  shutdown;    /* EE_Shutdown and software reset */
+  int32_t  cut;         /* power cut at this program of one more write */
+} BENCH_Case_t;
+
+typedef struct
+{
+  uint32_t nb_writes;
+  EE_InitProfile_t profile;
+  HOST_FlashStats_t stats;
+} BENCH_Results_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+static BENCH_Results_t *results;
+
+static const BENCH_Case_t bench_cases[] =
+{
+  { "ACTIVE page 0",                   BENCH_LIVE_VARS + 100U,                0U, 0U, -1 },
+  { "ACTIVE page 3",                   (3U * BENCH_PAGE_ELTS) + 100U,         0U, 0U, -1 },
+  { "ACTIVE last page",                BENCH_POOL_ELTS - 10U,                 0U, 0U, -1 },
+  { "ACTIVE/ACTIVE (page change cut)", BENCH_PAGE_ELTS,                       0U, 0U,  1 },
+  { "RECEIVE (transfer cut)",          BENCH_POOL_ELTS,                       0U, 0U, 60 },
+  { "ACTIVE, standby ERASING",         BENCH_LIVE_VARS + 100U,                1U, 0U, -1 },
+  { "fast init (clean shutdown)",      (3U * BENCH_PAGE_ELTS) + 100U,         0U, 1U, -1 },
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+static void BENCH_Diff(HOST_FlashStats_t *result, const HOST_FlashStats_t *start)
+{
+  HOST_FlashStats_t now;
+
+  HOST_FlashGetStats(&now);
+  result->reads = now.reads - start->reads;
+  result->programs = now.programs - start->programs;
+  result->erases = now.erases - start->erases;
+  result->time_ns = now.time_ns - start->time_ns;
+}
+
+/* Write number n of the sequence: the live variables in a shuffled order */
+static int BENCH_Write(uint32_t n)
+{
+  return EE_Write(0, (uint16_t)((n * 7919U) % BENCH_LIVE_VARS), n);
+}
+
+static uint32_t BENCH_Used(void)
+{
+  EE_Status_t status;
+
+  EE_GetStatus(0, &status);
+  return BENCH_POOL_ELTS - status.free_elements;
+}
+
+static int BENCH_Fill(void *arg)
+{
+  const BENCH_Case_t *bench_case = arg;
+  int status;
+
+  if (EE_Init(1, BENCH_EE_BASE) != EE_OK)
+  {
+    return 1;
+  }
+  results->nb_writes = 0U;
+
+  /* Pool transfer, the old pool being left in ERASING state */
+  if (bench_case->transfer != 0U)
+  {
+    do
+    {
+      status = BENCH_Write(results->nb_writes++);
+    } while (status == EE_OK);
+    if (status != EE_CLEAN_NEEDED)
+    {
+      return 1;
+    }
+  }
+
+  while (BENCH_Used() < bench_case->used)
+  {
+    if (BENCH_Write(results->nb_writes++) != EE_OK)
+    {
+      return 1;
+    }
+  }
+
+  if (bench_case->shutdown != 0U)
+  {
+    EE_Shutdown();
+    NVIC_SystemReset();
+  }
+  return 0;
+}
+
+/* One more write (page change or pool transfer), cut by the power loss */
+static int BENCH_Cut(void *arg)
+{
+  const BENCH_Case_t *bench_case = arg;
+
+  (void)bench_case;
+  if (EE_Init(0, BENCH_EE_BASE) != EE_OK)
+  {
+    return 1;
+  }
+  (void)BENCH_Write(results->nb_writes);
+  return 0;
+}
+
+static int BENCH_Init(void *arg)
+{
+  HOST_FlashStats_t start;
+
+  (void)arg;
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  HOST_FlashGetStats(&start);
+  if (EE_Init(0, BENCH_EE_BASE) != EE_OK)
+  {
+    return 1;
+  }
+  BENCH_Diff(&results->stats, &start);
+  EE_GetInitProfile(0, &results->profile);
+  return 0;
+}
+
+static double BENCH_Us(uint32_t cycles)
+{
+  return cycles / (SystemCoreClock / 1e6);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+int main(void)
+{
+  const BENCH_Case_t *bench_case;
+  HOST_BootResult_t result;
+  HOST_Reset_t reset;
+  const EE_InitProfile_t *p;
+
+  HOST_Init();
+  results = HOST_SharedAlloc(sizeof(BENCH_Results_t));
+
+  printf("bank 0: %u pages per pool, %u live variables, times in us\n",
+         (unsigned)BENCH_POOL_PAGES, (unsigned)BENCH_LIVE_VARS);
+  printf("%-32s | %5s %5s | %7s %7s %7s %7s %7s %8s | %7s %5s\n", "case",
+         "write", "dirty", "search", "count", "transf", "index", "stats", "total", "reads", "progs");
+
+  for (uint32_t i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); i++)
+  {
+    bench_case = &bench_cases[i];
+
+    result = HOST_Boot(HOST_RESET_POWER_ON, BENCH_Fill, (void *)bench_case);
+    reset = HOST_RESET_POWER_ON;
+    if (bench_case->shutdown != 0U)
+    {
+      reset = HOST_RESET_SOFTWARE;
+      result = (result == HOST_BOOT_SOFTWARE_RESET) ? HOST_BOOT_RETURNED : HOST_BOOT_FAILED;
+    }
+    if ((result == HOST_BOOT_RETURNED) && (bench_case->cut >= 0))
+    {
+      HOST_FlashCutAt(bench_case->cut);
+      result = HOST_Boot(HOST_RESET_POWER_ON, BENCH_Cut, (void *)bench_case);
+      HOST_FlashCutAt(-1);
+      reset = HOST_RESET_POWER_LOSS;
+      result = (result == HOST_BOOT_POWER_LOSS) ? HOST_BOOT_RETURNED : HOST_BOOT_FAILED;
+    }
+    if ((result != HOST_BOOT_RETURNED) ||
+        (HOST_Boot(reset, BENCH_Init, NULL) != HOST_BOOT_RETURNED))
+    {
+      printf("FAIL: %s\n", bench_case->name);
+      return 1;
+    }
+
+    p = &results->profile;
+    printf("%-32s | %5s %5u | %7.1f %7.1f %7.1f %7.1f %7.1f %8.1f | %7llu %5llu\n", bench_case->name,
+           (p->fast_init != 0U) ? "-" : (p->write_state == 1U) ? "RECV" : "ACTV", (unsigned)p->dirty_pages,
+           BENCH_Us(p->search), BENCH_Us(p->count), BENCH_Us(p->transfer), BENCH_Us(p->index),
+           BENCH_Us(p->stats), BENCH_Us(p->total),
+           (unsigned long long)results->stats.reads, (unsigned long long)results->stats.programs);
+  }
+  return 0;
+}
@@ -0,0 +1,162 @@
+/**
+  ******************************************************************************
+  * @file    bench_restore.c
+  * @author  MCD Application Team
+  * @brief   Restore time of the persistent data at a cold boot on the host
+  *          flash model, built with and without the EE RAM index
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/*
+  The stack state is saved a number of times (small changes), so that the
+  active pool is more or less filled, then the device is powered up again:
+  the cost of EE_Init (App_NVM_Init), of the read of the newest snapshot
+  (App_NVM_Read) and of single variable reads is reported in flash words
+  read and simulated time. Built with CFG_EE_INDEX set to 1 (bench_restore)
+  and 0 (bench_restore_noindex).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "app_nvm.h"
+#include "ee.h"
+
+/* Private defines -----------------------------------------------------------*/
+
+#define BENCH_SEED                 7U
+#define BENCH_STATE_LEN            3000U
+#define BENCH_READS                200U
+
+#ifndef CFG_EE_INDEX
+#define CFG_EE_INDEX               1
+#endif
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  uint8_t state[ST_PERSIST_MAX_ALLOC_SZ];
+  uint32_t saves;
+  HOST_FlashStats_t init;
+  HOST_FlashStats_t read;
+  HOST_FlashStats_t var;
+} BENCH_Results_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+static BENCH_Results_t *results;
+static const uint32_t bench_saves[] = { 1U, 20U, 60U, 120U };
+
+/* Private functions ---------------------------------------------------------*/
+
+void App_Core_Restore_State(void)
+{
+}
+
+void App_Core_Fast_Restore(void)
+{
+}
+
+static void BENCH_Diff(HOST_FlashStats_t *result, const HOST_FlashStats_t *start)
+{
+  HOST_FlashStats_t now;
+
+  HOST_FlashGetStats(&now);
+  result->reads = now.reads - start->reads;
+  result->programs = now.programs - start->programs;
+  result->erases = now.erases - start->erases;
+  result->time_ns = now.time_ns - start->time_ns;
+}
+
+/* Saves until the given count, the standby pools being cleaned */
+static int BENCH_Fill(void *arg)
+{
+  uint32_t saves = *(const uint32_t *)arg;
+
+  App_NVM_Init(HOST_ResetFlags);
+  while (results->saves < saves)
+  {
+    for (uint32_t n = 1U + (uint32_t)(rand() % 8); n != 0U; n--)
+    {
+      results->state[rand() % BENCH_STATE_LEN] = (uint8_t)rand();
+    }
+    HOST_ZigbeeSetState(results->state, BENCH_STATE_LEN);
+    if (!App_Persist_Save(NULL))
+    {
+      return 1;
+    }
+    (void)HOST_RunUntilIdle(60000U);
+    results->saves++;
+  }
+  return 0;
+}
+
+static int BENCH_Boot(void *arg)
+{
+  HOST_FlashStats_t start;
+  uint32_t data;
+
+  (void)arg;
+
+  HOST_FlashGetStats(&start);
+  App_NVM_Init(HOST_ResetFlags);
+  BENCH_Diff(&results->init, &start);
+
+  HOST_FlashGetStats(&start);
+  if (!App_NVM_Read())
+  {
+    return 1;
+  }
+  BENCH_Diff(&results->read, &start);
+
+  HOST_FlashGetStats(&start);
+  for (uint32_t i = 0; i < BENCH_READS; i++)
+  {
+    (void)EE_Read(0, (uint16_t)(rand() % (2U * APP_NVM_SNAPSHOT_WORDS)), &data);
+  }
+  BENCH_Diff(&results->var, &start);
+  return 0;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+int main(void)
+{
+  srand(BENCH_SEED);
+  HOST_Init();
+  results = HOST_SharedAlloc(sizeof(BENCH_Results_t));
+  for (uint32_t i = 0; i < BENCH_STATE_LEN; i++)
+  {
+    results->state[i] = (rand() % 2) ? (uint8_t)rand() : 0U;
+  }
+
+  printf("RAM index %s\n", (CFG_EE_INDEX != 0) ? "enabled" : "disabled");
+  printf("%6s | %10s %10s | %10s %10s | %10s %10s\n", "saves",
+         "init rd", "init us", "snap rd", "snap us", "var rd", "var us");
+
+  for (uint32_t i = 0; i < sizeof(bench_saves) / sizeof(bench_saves[0]); i++)
+  {
+    if ((HOST_Boot(HOST_RESET_POWER_ON, BENCH_Fill, (void *)&bench_saves[i]) != HOST_BOOT_RETURNED) ||
+        (HOST_Boot(HOST_RESET_POWER_ON, BENCH_Boot, NULL) != HOST_BOOT_RETURNED))
+    {
+      printf("FAIL: restore after %u saves\n", (unsigned)bench_saves[i]);
+      return 1;
+    }
+    printf("%6u | %10llu %10.1f | %10llu %10.1f | %10.1f %10.2f\n", (unsigned)bench_saves[i],
+           (unsigned long long)results->init.reads, results->init.time_ns / 1000.0,
+           (unsigned long long)results->read.reads, results->read.time_ns / 1000.0,
+           (double)results->var.reads / BENCH_READS, results->var.time_ns / 1000.0 / BENCH_READS);
+  }
+  return 0;
+}
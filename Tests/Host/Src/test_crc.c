@@ -0,0 +1,170 @@
+/**
+  ******************************************************************************
+  * @file    test_crc.c
+  * @author  MCD Application Team
+  * @brief   Element CRC of the EEPROM emulation: equivalence of the backends
+  *          and check throughput on the host
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/*
+  ee.c is included, so that its CRC functions are tested as built. This file
+  is built once per backend (CFG_EE_CRC: EE_CRC_REF, EE_CRC_TABLE, EE_CRC_HW
+  on the host model of the CRC peripheral): each build checks the CRC of
+  random narrow and wide elements against a bitwise CRC16-CCITT of the bytes
+  the element CRC covers, so that the three backends give the same flash
+  content. The number of elements checked per second (EE_ElIsValid for a
+  narrow element, the CRC of a full wide element) is then reported; it
+  measures the host, the EE_CRC_HW figure being the one of the model.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ee.c"
+
+/* Private defines -----------------------------------------------------------*/
+
+#define TEST_VECTORS               100000U
+#define TEST_BENCH_NB              2000000U
+#define TEST_BENCH_SET             4096U     /* elements, one in 4 corrupted */
+#define TEST_SEED                  3U
+
+#define CHECK( c ) do { if ( !(c) ) { printf( "FAIL %s:%d: %s\n", __FILE__, __LINE__, #c ); return 1; } } while ( 0 )
+
+/* Private variables ---------------------------------------------------------*/
+
+static const char* const test_backend[] = { "EE_CRC_REF", "EE_CRC_TABLE", "EE_CRC_HW" };
+
+/* Private functions ---------------------------------------------------------*/
+
+/* CRC16-CCITT (polynomial 0x1021, initial value 0, no reflection), bitwise */
+static uint16_t TEST_Crc( const uint8_t* bytes, uint32_t size )
+{
+  uint16_t crc = 0;
+
+  while ( size-- > 0 )
+  {
+    crc ^= (uint16_t)(*bytes++ << 8);
+    for ( int i = 0; i < 8; i++ )
+    {
+      crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ 0x1021U) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+/* Bytes covered by the element CRC: element bytes 2 to 7, then the data
+   words, most significant byte first */
+static uint16_t TEST_ElCrc( uint64_t el, const uint32_t* data, uint32_t nb )
+{
+  uint8_t bytes[6 + (4 * CFG_EE_WIDE_NB)];
+  uint32_t size = 0;
+
+  for ( int i = 2; i < 8; i++ )
+  {
+    bytes[size++] = (uint8_t)(el >> (8 * i));
+  }
+  for ( uint32_t i = 0; i < nb; i++ )
+  {
+    bytes[size++] = (uint8_t)(data[i] >> 24);
+    bytes[size++] = (uint8_t)(data[i] >> 16);
+    bytes[size++] = (uint8_t)(data[i] >> 8);
+    bytes[size++] = (uint8_t)data[i];
+  }
+  return TEST_Crc( bytes, size );
+}
+
+static uint32_t TEST_Rand32( void )
+{
+  return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+static double TEST_Now( void )
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+int main( void )
+{
+  uint32_t data[CFG_EE_WIDE_NB];
+  uint64_t wide[2 + (CFG_EE_WIDE_NB + 1) / 2];
+  static uint64_t el_set[TEST_BENCH_SET];
+  volatile uint32_t sink = 0;
+  double start, narrow_rate, wide_rate;
+
+  srand( TEST_SEED );
+  EE_CrcInit( );
+
+  /* Reference */
+  CHECK( TEST_Crc( (const uint8_t*)"123456789", 9 ) == 0x31C3U );
+
+  for ( uint32_t n = 0; n < TEST_VECTORS; n++ )
+  {
+    uint16_t addr = (uint16_t)(rand() & 0x3FFF);
+    uint32_t nb = 2 + (uint32_t)(rand() % (CFG_EE_WIDE_NB - 1));
+    uint64_t el;
+
+    for ( uint32_t i = 0; i < nb; i++ )
+    {
+      data[i] = (rand() % 4) ? TEST_Rand32( ) : 0U;
+    }
+
+    /* Narrow element: CRC as the reference, a flipped bit detected */
+    el = EE_BuildEl( addr, data[0] );
+    CHECK( (uint16_t)el == TEST_ElCrc( el, NULL, 0 ) );
+    CHECK( EE_ElIsValid( 0, el, 1 ) );
+    CHECK( !EE_ElIsValid( 0, el ^ (1ULL << (16 + rand() % 48)), 1 ) );
+
+    /* Wide element: CRC of the header and the data words */
+    (void)EE_BuildWide( wide, addr, data, nb );
+    CHECK( (uint16_t)wide[0] == TEST_ElCrc( wide[0], data, nb ) );
+    CHECK( EE_CrcWide( wide[0], data, nb ) == (uint16_t)wide[0] );
+  }
+
+  /* Throughput */
+  for ( uint32_t n = 0; n < TEST_BENCH_SET; n++ )
+  {
+    el_set[n] = EE_BuildEl( (uint16_t)n, TEST_Rand32( ) ) ^ ((n % 4) == 0);
+  }
+  start = TEST_Now( );
+  for ( uint32_t n = 0; n < TEST_BENCH_NB; n++ )
+  {
+    sink += EE_ElIsValid( 0, el_set[n % TEST_BENCH_SET], 1 );
+  }
+  narrow_rate = TEST_BENCH_NB / (TEST_Now( ) - start);
+
+  for ( uint32_t i = 0; i < CFG_EE_WIDE_NB; i++ )
+  {
+    data[i] = TEST_Rand32( );
+  }
+  start = TEST_Now( );
+  for ( uint32_t n = 0; n < TEST_BENCH_NB / 16; n++ )
+  {
+    data[0] = n;
+    sink += EE_CrcWide( (uint64_t)n << 16, data, CFG_EE_WIDE_NB );
+  }
+  wide_rate = (TEST_BENCH_NB / 16) / (TEST_Now( ) - start);
+
+  printf( "crc: %s, %u vectors OK\n", test_backend[CFG_EE_CRC], TEST_VECTORS );
+  printf( "crc: %.2f M narrow elements/s, %.2f M wide elements (%d words)/s\n",
+          narrow_rate / 1e6, wide_rate / 1e6, CFG_EE_WIDE_NB );
+  (void)sink;
+  return 0;
+}
@@ -0,0 +1,265 @@
+/**
+  ******************************************************************************
+  * @file    test_ee.c
+  * @author  MCD Application Team
+  * @brief   Power loss test of the EEPROM emulation on the host flash model
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/*
+  Each round is one boot: EE_Init recovers the banks, every variable is
+  checked against the model, then a random write (single or block, both
+  banks) is done, sometimes followed by the clean of the standby pools.
+  The power is cut at a random program/erase of the round, the recovery
+  included: a variable being written must then read either its old or its
+  new value, all the others their last value. Some rounds end with
+  EE_Shutdown and a software reset instead (fast init of the next boot).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "ee_cfg.h"
+#include "ee.h"
+
+/* Private defines -----------------------------------------------------------*/
+
+#define TEST_EE_BASE               (FLASH_BASE + 0x70000U)
+#define TEST_ROUNDS                3000U
+#define TEST_BLOCK_MAX             200U
+#define TEST_SEED                  1U
+
+#define CHECK( c ) do { if ( !(c) ) { printf( "FAIL %s:%d: %s\n", __FILE__, __LINE__, #c ); return 1; } } while ( 0 )
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  uint32_t value;
+  uint32_t next;      /* value being written (pending) */
+  uint8_t  present;
+  uint8_t  pending;
+} TEST_Var_t;
+
+typedef struct
+{
+  TEST_Var_t var[2][CFG_EE_BANK0_MAX_NB];
+  uint32_t nb_resolved_old;
+  uint32_t nb_resolved_new;
+  uint32_t nb_fast_init;
+  uint16_t erase_count[2][CFG_EE_BANK0_NB_OF_PAGE];
+  uint32_t nb_transfers[2];
+} TEST_Model_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+static const uint16_t test_max_nb[2] = { CFG_EE_BANK0_MAX_NB, CFG_EE_BANK1_MAX_NB };
+static const uint32_t test_nb_pages[2] = { CFG_EE_BANK0_NB_OF_PAGE, CFG_EE_BANK1_NB_OF_PAGE };
+static TEST_Model_t *model;
+
+/* Private functions ---------------------------------------------------------*/
+
+static int TEST_Format( void *arg )
+{
+  (void)arg;
+  return EE_Init( 1, TEST_EE_BASE );
+}
+
+/* Checks the banks against the model, the pending values being resolved */
+static int TEST_Check( void )
+{
+  for ( int bank = 0; bank < 2; bank++ )
+  {
+    for ( uint16_t addr = 0; addr < test_max_nb[bank]; addr++ )
+    {
+      TEST_Var_t *v = &model->var[bank][addr];
+      uint32_t data = 0;
+      int status = EE_Read( bank, addr, &data );
+
+      if ( v->pending && (status == EE_OK) && (data == v->next) )
+      {
+        v->value = v->next;
+        v->present = 1;
+        model->nb_resolved_new++;
+      }
+      else
+      {
+        if ( v->pending )
+        {
+          model->nb_resolved_old++;
+        }
+        CHECK( status == (v->present ? EE_OK : EE_NOT_FOUND) );
+        CHECK( !v->present || (data == v->value) );
+      }
+      v->pending = 0;
+    }
+  }
+  return 0;
+}
+
+static void TEST_Commit( int bank, uint16_t addr, uint16_t size )
+{
+  for ( uint16_t i = 0; i < size; i++ )
+  {
+    TEST_Var_t *v = &model->var[bank][addr + i];
+
+    v->value = v->next;
+    v->present = 1;
+    v->pending = 0;
+  }
+}
+
+static int TEST_Round( void *arg )
+{
+  uint32_t data[TEST_BLOCK_MAX];
+  EE_InitProfile_t profile;
+  int bank = rand() % 2;
+  uint16_t size = (rand() % 4) ? 1U : (uint16_t)(1 + rand() % TEST_BLOCK_MAX);
+  uint16_t addr;
+  int status;
+
+  (void)arg;
+
+  CHECK( EE_Init( 0, TEST_EE_BASE ) == EE_OK );
+  EE_GetInitProfile( 0, &profile );
+  model->nb_fast_init += profile.fast_init;
+  if ( TEST_Check() != 0 )
+  {
+    return 1;
+  }
+
+  /* Random write, mostly on a few hot variables */
+  if ( size > test_max_nb[bank] )
+  {
+    size = test_max_nb[bank];
+  }
+  addr = (uint16_t)((rand() % 2) ? (rand() % 8) : (rand() % (test_max_nb[bank] - size + 1)));
+  if ( addr + size > test_max_nb[bank] )
+  {
+    addr = (uint16_t)(test_max_nb[bank] - size);
+  }
+  for ( uint16_t i = 0; i < size; i++ )
+  {
+    TEST_Var_t *v = &model->var[bank][addr + i];
+
+    data[i] = (rand() % 4) ? (uint32_t)rand() : v->value;
+    v->next = data[i];
+    v->pending = 1;
+  }
+
+  status = (size == 1U) ? EE_Write( bank, addr, data[0] ) : EE_WriteBlock( bank, addr, data, size );
+  CHECK( (status == EE_OK) || (status == EE_CLEAN_NEEDED) );
+  TEST_Commit( bank, addr, size );
+
+  if ( (status == EE_CLEAN_NEEDED) || ((rand() % 4) == 0) )
+  {
+    while ( EE_CleanPage( 0 ) == EE_CLEAN_NEEDED );
+    while ( EE_CleanPage( 1 ) == EE_CLEAN_NEEDED );
+  }
+
+  if ( (rand() % 8) == 0 )
+  {
+    EE_Shutdown( );
+    NVIC_SystemReset( );
+  }
+  return 0;
+}
+
+/* Statistics of the banks, as loaded by the recovery */
+static int TEST_StatsGet( void *arg )
+{
+  EE_Status_t status;
+
+  (void)arg;
+
+  CHECK( EE_Init( 0, TEST_EE_BASE ) == EE_OK );
+  for ( int bank = 0; bank < 2; bank++ )
+  {
+    EE_GetStatus( bank, &status );
+    model->nb_transfers[bank] = status.nb_transfers;
+    for ( uint32_t page = 0; page < test_nb_pages[bank]; page++ )
+    {
+      model->erase_count[bank][page] = EE_GetEraseCount( bank, page );
+    }
+  }
+  CHECK( (model->nb_transfers[0] + model->nb_transfers[1]) != 0 );
+  return 0;
+}
+
+/* Format at a cold boot: statistics kept, each page erased once more */
+static int TEST_StatsFormat( void *arg )
+{
+  EE_Status_t status;
+
+  (void)arg;
+
+  CHECK( EE_Init( 1, TEST_EE_BASE ) == EE_OK );
+  for ( int bank = 0; bank < 2; bank++ )
+  {
+    EE_GetStatus( bank, &status );
+    CHECK( status.nb_transfers == model->nb_transfers[bank] );
+    for ( uint32_t page = 0; page < test_nb_pages[bank]; page++ )
+    {
+      CHECK( EE_GetEraseCount( bank, page ) == model->erase_count[bank][page] + 1 );
+    }
+  }
+  return 0;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+int main( void )
+{
+  HOST_FlashStats_t stats;
+  HOST_Reset_t reset = HOST_RESET_POWER_ON;
+  uint32_t nb_cut = 0;
+
+  srand( TEST_SEED );
+  HOST_Init( );
+  model = HOST_SharedAlloc( sizeof(TEST_Model_t) );
+  CHECK( HOST_Boot( HOST_RESET_POWER_ON, TEST_Format, NULL ) == HOST_BOOT_RETURNED );
+
+  for ( uint32_t round = 0; round < TEST_ROUNDS; round++ )
+  {
+    HOST_BootResult_t result;
+
+    /* Cut at any step of the round, mostly in the first ones (a single
+       write is one program, a pool transfer up to ~2000) */
+    HOST_FlashCutAt( (rand() % 2) ? (rand() % 8) : (rand() % 2) ? (rand() % 256) : (rand() % 2048) );
+    result = HOST_Boot( reset, TEST_Round, NULL );
+    HOST_FlashCutAt( -1 );
+
+    if ( result == HOST_BOOT_FAILED )
+    {
+      printf( "FAIL: round %u\n", (unsigned)round );
+      return 1;
+    }
+    nb_cut += (result == HOST_BOOT_POWER_LOSS);
+    reset = (result == HOST_BOOT_SOFTWARE_RESET) ? HOST_RESET_SOFTWARE :
+            (result == HOST_BOOT_POWER_LOSS) ? HOST_RESET_POWER_LOSS : HOST_RESET_POWER_ON;
+  }
+
+  /* A format after a power up keeps the statistics saved in flash */
+  CHECK( HOST_Boot( HOST_RESET_POWER_ON, TEST_StatsGet, NULL ) == HOST_BOOT_RETURNED );
+  CHECK( HOST_Boot( HOST_RESET_POWER_ON, TEST_StatsFormat, NULL ) == HOST_BOOT_RETURNED );
+
+  HOST_FlashGetStats( &stats );
+  printf( "ee: %u rounds, %u power cuts (%u writes lost, %u kept), %u fast init\n",
+          TEST_ROUNDS, (unsigned)nb_cut, (unsigned)model->nb_resolved_old,
+          (unsigned)model->nb_resolved_new, (unsigned)model->nb_fast_init );
+  printf( "ee: %llu programs, %llu erases, %.1f s\n",
+          (unsigned long long)stats.programs, (unsigned long long)stats.erases,
+          stats.time_ns / 1e9 );
+  return 0;
+}
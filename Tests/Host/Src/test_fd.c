@@ -0,0 +1,166 @@
+/**
+  ******************************************************************************
+  * @file    test_fd.c
+  * @author  MCD Application Team
+  * @brief   Guard windows of the flash driver queue on the host flash model
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/*
+  Erases are queued with FD_SubmitErase() and the queue is processed as the
+  application task would (FD_ProcessQueue() when notified or at the end of
+  the delay given to FD_QueueDeferred()), while guard windows are requested
+  with FD_DeferOperations():
+    - an operation is not started within a window, the queue processing
+      being deferred until its end,
+    - a new request extends the window, a shorter one does not shorten it,
+    - a window requested during a batch stops it after the running erase,
+    - windows requested all along: the operation is forced once deferred
+      for CFG_FD_GUARD_MAX_DEFER_MS,
+    - the synchronous operations are not deferred.
+ */
+
+#include <stdio.h>
+
+#include "host.h"
+#include "hw_flash.h"
+#include "flash_driver.h"
+
+/* Private defines -----------------------------------------------------------*/
+
+#define TEST_SECTOR                0x70U
+#define TEST_NS_PER_MS             1000000ULL
+
+#define CHECK(c) do { if(!(c)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c); return 1; } } while(0)
+
+/* Private variables ---------------------------------------------------------*/
+
+static uint32_t test_nb_notify;
+static uint32_t test_deferred_ms;
+static uint32_t test_hook_guard_ms;
+
+/* Private functions ---------------------------------------------------------*/
+
+void FD_QueueNotify(void)
+{
+  test_nb_notify++;
+}
+
+void FD_QueueDeferred(uint32_t DelayMs)
+{
+  test_deferred_ms = DelayMs;
+}
+
+/* Guard window requested under the flash operation (e.g. from an interrupt) */
+static void TEST_FlashHook(void)
+{
+  if(test_hook_guard_ms != 0)
+  {
+    FD_DeferOperations(test_hook_guard_ms);
+    test_hook_guard_ms = 0;
+  }
+}
+
+static void TEST_AdvanceMs(uint32_t ms)
+{
+  HOST_Advance(ms * TEST_NS_PER_MS);
+}
+
+static uint32_t TEST_NbErases(void)
+{
+  FD_Statistics_t stats;
+
+  FD_GetStatistics(&stats);
+  return stats.NbrOfErases;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+int main(void)
+{
+  FD_Statistics_t stats;
+  uint64_t data = 0x0123456789ABCDEFULL;
+  uint32_t start;
+  uint32_t forced_ms;
+
+  HOST_Init();
+  HOST_SetFlashHook(TEST_FlashHook);
+  FD_ResetStatistics();
+
+  /* Within a window: nothing started, processing deferred to its end */
+  FD_DeferOperations(30);
+  CHECK(FD_SubmitErase(TEST_SECTOR, 3, NULL, NULL) == 0);
+  test_deferred_ms = 0;
+  FD_ProcessQueue();
+  CHECK((TEST_NbErases() == 0) && (test_deferred_ms == 30));
+
+  /* Extension: a shorter request keeps the window, a longer one extends it */
+  TEST_AdvanceMs(10);
+  FD_DeferOperations(5);
+  CHECK(FD_GetGuardTimeLeft() == 20);
+  FD_ProcessQueue();
+  CHECK((TEST_NbErases() == 0) && (test_deferred_ms == 20));
+  FD_DeferOperations(40);
+  CHECK(FD_GetGuardTimeLeft() == 40);
+  FD_ProcessQueue();
+  CHECK((TEST_NbErases() == 0) && (test_deferred_ms == 40));
+
+  /* End of the window: the batch runs, a window requested under the first
+     erase stops it */
+  TEST_AdvanceMs(40);
+  test_hook_guard_ms = 50;
+  test_deferred_ms = 0;
+  FD_ProcessQueue();
+  CHECK((TEST_NbErases() == 1) && (test_deferred_ms == 50));
+  TEST_AdvanceMs(50);
+  FD_ProcessQueue();
+  CHECK(TEST_NbErases() == 3);
+  FD_GetStatistics(&stats);
+  CHECK((stats.NbrOfDeferred == 4) && (stats.NbrOfForced == 0));
+  CHECK(HOST_GetEraseActivity() == 0);
+
+  /* Windows requested all along: forced after CFG_FD_GUARD_MAX_DEFER_MS */
+  CHECK(FD_SubmitErase(TEST_SECTOR, 1, NULL, NULL) == 0);
+  start = HAL_GetTick();
+  forced_ms = 0;
+  while((TEST_NbErases() == 3) && ((HAL_GetTick() - start) < (2 * CFG_FD_GUARD_MAX_DEFER_MS)))
+  {
+    FD_DeferOperations(100);
+    test_deferred_ms = 0;
+    FD_ProcessQueue();
+    if(TEST_NbErases() == 3)
+    {
+      CHECK((test_deferred_ms != 0) && (test_deferred_ms <= 100));
+      TEST_AdvanceMs((test_deferred_ms + 1) / 2);
+    }
+    else
+    {
+      forced_ms = HAL_GetTick() - start;
+    }
+  }
+  CHECK(TEST_NbErases() == 4);
+  CHECK((forced_ms >= CFG_FD_GUARD_MAX_DEFER_MS) && (forced_ms <= CFG_FD_GUARD_MAX_DEFER_MS + 100));
+  FD_GetStatistics(&stats);
+  CHECK(stats.NbrOfForced == 1);
+
+  /* Synchronous operations not deferred (counted as forced) */
+  FD_DeferOperations(100);
+  CHECK(FD_WriteData(FLASH_BASE + (TEST_SECTOR * HW_FLASH_PAGE_SIZE), &data, 1) == 0);
+  FD_GetStatistics(&stats);
+  CHECK((stats.NbrOfWrites == 1) && (stats.NbrOfForced == 2));
+  CHECK(HOST_GetEraseActivity() == 0);
+
+  printf("fd: guard windows deferred the queue %u times, erase forced %u ms after its first deferral\n",
+         (unsigned)stats.NbrOfDeferred, (unsigned)forced_ms);
+  return 0;
+}
@@ -0,0 +1,501 @@
+/**
+  ******************************************************************************
+  * @file    test_nvm.c
+  * @author  MCD Application Team
+  * @brief   Test of the persistence of the Zigbee applications (app_nvm.c) on
+  *          the host flash model
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/*
+  app_nvm.c is included to check its internal state. Each boot runs
+  App_NVM_Init and the read of the persistent data, as the application does,
+  then a step of the test. The stack state saved is a random image changing
+  by a few bytes at each save, as the real one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "app_nvm.c"
+
+/* Private defines -----------------------------------------------------------*/
+
+#define TEST_SEED                  3U
+#define TEST_SAVES                 300U
+#define TEST_POWER_CUTS            2000U
+#define TEST_EXPORT_MAX            20000U
+#define TEST_RECORD_LEN            24U
+#define TEST_RECORD_CUTS           200U
+
+#define CHECK( c ) do { if (!(c)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c); return 1; } } while (0)
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  uint8_t  state[ST_PERSIST_MAX_ALLOC_SZ];
+  uint32_t len;
+  uint8_t  prev[ST_PERSIST_MAX_ALLOC_SZ];
+  uint32_t prev_len;
+  uint32_t nb_new;
+  uint32_t nb_prev;
+  uint32_t nb_warm;
+  uint8_t  export[TEST_EXPORT_MAX];
+  size_t   export_len;
+  uint16_t record_addr[2];
+  uint8_t  record_old[TEST_RECORD_LEN];
+  uint8_t  record_new[TEST_RECORD_LEN];
+  uint32_t record_nb;
+  uint32_t record_nb_new;
+  bool     record_written;
+} TEST_Model_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+static TEST_Model_t *model;
+
+/* Private functions ---------------------------------------------------------*/
+
+void App_Core_Restore_State(void)
+{
+}
+
+void App_Core_Fast_Restore(void)
+{
+}
+
+/* New stack state: a few bytes changed, size varying */
+static void TEST_Mutate(void)
+{
+  memcpy(model->prev, model->state, sizeof(model->state));
+  model->prev_len = model->len;
+
+  model->len = 1500U + (uint32_t)(rand() % 2400);
+  for (int k = rand() % 40; k >= 0; k--)
+  {
+    model->state[rand() % model->len] = (rand() % 3) ? 0U : (uint8_t)rand();
+  }
+  memset(&model->state[model->len], 0, sizeof(model->state) - model->len);
+  HOST_ZigbeeSetState(model->state, model->len);
+}
+
+static bool TEST_Matches(const uint8_t *state, uint32_t len)
+{
+  return (cache_persistent_data.U32_data[0] == len) &&
+         (memcmp(&cache_persistent_data.U8_data[ST_PERSIST_FLASH_DATA_OFFSET], state, len) == 0);
+}
+
+/* Boot: the persistent data read back are the last saved or, after a power
+   cut during the save, the previous ones */
+static int TEST_Start(void)
+{
+  App_NVM_Init(HOST_ResetFlags);
+  if (model->len == 0U)
+  {
+    return 0;
+  }
+
+  CHECK(App_NVM_Read());
+  if (TEST_Matches(model->state, model->len))
+  {
+    model->nb_new++;
+  }
+  else
+  {
+    CHECK(TEST_Matches(model->prev, model->prev_len));
+    memcpy(model->state, model->prev, sizeof(model->state));
+    model->len = model->prev_len;
+    model->nb_prev++;
+  }
+  model->nb_warm += persist_load_warm;
+  HOST_ZigbeeSetState(model->state, model->len);
+  return 0;
+}
+
+/* Save, the background clean running or not, ended by a power cut or a
+   clean shutdown in some boots */
+static int TEST_Save(void *arg)
+{
+  (void)arg;
+
+  CHECK(TEST_Start() == 0);
+  TEST_Mutate();
+  CHECK(App_Persist_Save(NULL));
+  if (rand() % 2)
+  {
+    CHECK(HOST_RunUntilIdle(10000U));
+  }
+  if ((rand() % 4) == 0)
+  {
+    App_NVM_Shutdown();
+    NVIC_SystemReset();
+  }
+  return 0;
+}
+
+static int TEST_Saves(void)
+{
+  HOST_Reset_t reset = HOST_RESET_POWER_ON;
+  uint32_t nb_cut = 0U;
+
+  for (uint32_t i = 0; i < TEST_SAVES + TEST_POWER_CUTS; i++)
+  {
+    HOST_BootResult_t result;
+
+    if (i >= TEST_SAVES)
+    {
+      HOST_FlashCutAt(rand() % 400);
+    }
+    result = HOST_Boot(reset, TEST_Save, NULL);
+    HOST_FlashCutAt(-1);
+    CHECK(result != HOST_BOOT_FAILED);
+
+    nb_cut += (result == HOST_BOOT_POWER_LOSS);
+    reset = (result == HOST_BOOT_SOFTWARE_RESET) ? HOST_RESET_SOFTWARE :
+            (result == HOST_BOOT_POWER_LOSS) ? HOST_RESET_POWER_LOSS : HOST_RESET_POWER_ON;
+  }
+  CHECK(HOST_Boot(reset, TEST_Save, NULL) != HOST_BOOT_FAILED);
+
+  printf("nvm: %u saves, %u power cuts (%u read back new, %u previous), %u warm loads\n",
+         TEST_SAVES + TEST_POWER_CUTS, (unsigned)nb_cut, (unsigned)model->nb_new,
+         (unsigned)model->nb_prev, (unsigned)model->nb_warm);
+  return 0;
+}
+
+/* Warm reset: a corrupted RAM cache is not used */
+static int TEST_Warm_Corrupt(void *arg)
+{
+  (void)arg;
+
+  cache_persistent_data.U8_data[10] ^= 1U;
+  App_NVM_Init(HOST_ResetFlags);
+  CHECK(App_NVM_Read() && !persist_load_warm);
+  CHECK(TEST_Matches(model->state, model->len));
+  return 0;
+}
+
+static int TEST_Shutdown(void *arg)
+{
+  (void)arg;
+
+  CHECK(TEST_Start() == 0);
+  App_NVM_Shutdown();
+  NVIC_SystemReset();
+}
+
+/* Image of an older firmware (length word then data, without snapshot
+   header): not read */
+static int TEST_Legacy(void *arg)
+{
+  uint32_t image[3] = { 5U, 0x04030201U, 0x05U };
+
+  (void)arg;
+
+  App_NVM_Init(HOST_ResetFlags);
+  App_NVM_Erase();
+  CHECK(EE_WriteBlock(0, ZIGBEE_DB_START_ADDR, image, 3U) == EE_OK);
+  CHECK(!App_NVM_Read());
+  return 0;
+}
+
+/* Both snapshots corrupted: nothing read */
+static int TEST_Corrupt(void *arg)
+{
+  (void)arg;
+
+  App_NVM_Init(HOST_ResetFlags);
+  App_NVM_Erase();
+  TEST_Mutate();
+  CHECK(App_Persist_Save(NULL));
+  TEST_Mutate();
+  CHECK(App_Persist_Save(NULL));
+  CHECK(EE_Write(0, APP_NVM_SNAPSHOT_ADDR(0) + 2U, 0U) == EE_OK);
+  CHECK(EE_Write(0, APP_NVM_SNAPSHOT_ADDR(1) + 2U, 0U) == EE_OK);
+  cache_persistent_info.magic = 0U;
+  CHECK(!App_NVM_Read());
+  return 0;
+}
+
+/* Coalesced save postponed by the guard windows, up to
+   CFG_FD_GUARD_MAX_DEFER_MS after its max delay */
+static int TEST_Guard(void *arg)
+{
+  uint32_t start;
+  uint32_t saved = 0U;
+
+  (void)arg;
+
+  CHECK(TEST_Start() == 0);
+  CHECK(HOST_RunUntilIdle(10000U));
+  TEST_Mutate();
+
+  /* Not postponed without guard */
+  start = HAL_GetTick();
+  App_Persist_Notify_cb(NULL, NULL);
+  HOST_RunFor(CFG_PERSIST_SAVE_WINDOW_MS + 10U);
+  CHECK(!persist_dirty);
+
+  /* A guard window at the end of the save window postpones the save */
+  TEST_Mutate();
+  start = HAL_GetTick();
+  App_Persist_Notify_cb(NULL, NULL);
+  HOST_RunFor(CFG_PERSIST_SAVE_WINDOW_MS - 10U);
+  FD_DeferOperations(80U);
+  HOST_RunFor(50U);
+  CHECK(persist_dirty);
+  HOST_RunFor(50U);
+  CHECK(!persist_dirty);
+
+  /* Guard windows requested all along: forced at the bound */
+  TEST_Mutate();
+  start = HAL_GetTick();
+  App_Persist_Notify_cb(NULL, NULL);
+  while (persist_dirty && ((HAL_GetTick() - start) < 2U * (CFG_PERSIST_SAVE_MAX_DELAY_MS + CFG_FD_GUARD_MAX_DEFER_MS)))
+  {
+    FD_DeferOperations(APP_NVM_TX_GUARD_MS);
+    HOST_RunFor(APP_NVM_TX_GUARD_MS / 2U);
+    if (!persist_dirty)
+    {
+      saved = HAL_GetTick() - start;
+    }
+  }
+  CHECK(!persist_dirty);
+  CHECK((saved >= CFG_PERSIST_SAVE_MAX_DELAY_MS) &&
+        (saved <= CFG_PERSIST_SAVE_MAX_DELAY_MS + CFG_FD_GUARD_MAX_DEFER_MS + APP_NVM_TX_GUARD_MS));
+  printf("nvm: save forced %u ms after the notification under guard windows\n", (unsigned)saved);
+  return 0;
+}
+
+/* State export: the frames are captured from the trace output */
+static int TEST_Export(void *arg)
+{
+  (void)arg;
+
+  CHECK(TEST_Start() == 0);
+  (void)HOST_TraceCapture(model->export, sizeof(model->export));
+  App_NVM_Export_State();
+  CHECK(HOST_RunUntilIdle(60000U));
+  model->export_len = HOST_TraceCapture(NULL, 0U);
+  CHECK((model->export_len > model->len) && (model->export_len <= sizeof(model->export)));
+  return 0;
+}
+
+/* Import of the exported state in an erased NVM, by chunks received under
+   interrupt between the runs of the transfer task: ends with a reset */
+static int TEST_Import(void *arg)
+{
+  int corrupt = *(int *)arg;
+  size_t chunk = 1U + (size_t)(rand() % 300);
+
+  App_NVM_Init(HOST_ResetFlags);
+  App_NVM_Erase();
+  cache_persistent_info.magic = 0U;
+
+  if (corrupt == 2)
+  {
+    /* Receive buffer overflow: aborted */
+    App_NVM_Import_Start();
+    for (size_t i = 0; i < APP_NVM_RX_BUFFER_SIZE + 10U; i++)
+    {
+      (void)App_NVM_Import_Rx(model->export[i]);
+    }
+    CHECK(HOST_RunUntilIdle(1000U));
+    CHECK(nvm_transfer_state == APP_NVM_TRANSFER_IDLE);
+    return 0;
+  }
+
+  if (corrupt != 0)
+  {
+    model->export[40] ^= 1U;
+  }
+  App_NVM_Import_Start();
+  for (size_t i = 0; i < model->export_len; i += chunk)
+  {
+    for (size_t j = i; (j < i + chunk) && (j < model->export_len); j++)
+    {
+      if (!App_NVM_Import_Rx(model->export[j]))
+      {
+        break;
+      }
+    }
+    HOST_RunFor(1U);
+  }
+  CHECK(HOST_RunUntilIdle(1000U));
+  if (corrupt != 0)
+  {
+    model->export[40] ^= 1U;
+  }
+
+  /* Not reset: refused */
+  CHECK((corrupt != 0) && (nvm_transfer_state == APP_NVM_TRANSFER_IDLE));
+  return 0;
+}
+
+static int TEST_Transfer(void)
+{
+  int corrupt;
+
+  CHECK(HOST_Boot(HOST_RESET_POWER_ON, TEST_Export, NULL) == HOST_BOOT_RETURNED);
+  for (corrupt = 1; corrupt <= 2; corrupt++)
+  {
+    CHECK(HOST_Boot(HOST_RESET_POWER_ON, TEST_Import, &corrupt) == HOST_BOOT_RETURNED);
+  }
+  corrupt = 0;
+  CHECK(HOST_Boot(HOST_RESET_POWER_ON, TEST_Import, &corrupt) == HOST_BOOT_SOFTWARE_RESET);
+  model->nb_new = 0U;
+  CHECK(HOST_Boot(HOST_RESET_SOFTWARE, TEST_Save, NULL) != HOST_BOOT_FAILED);
+  CHECK(model->nb_new == 1U);
+  printf("nvm: state exported in %u bytes and imported\n", (unsigned)model->export_len);
+  return 0;
+}
+
+/* Records registered, reloaded in any order, reallocated on a size change */
+static int TEST_Records_Write(void *arg)
+{
+  struct { uint8_t a[5]; } r1 = { { 1, 2, 3, 4, 5 } };
+  uint8_t r2[10];
+
+  (void)arg;
+
+  App_NVM_Init(HOST_ResetFlags);
+  App_NVM_Erase();
+  memset(r2, 7, sizeof(r2));
+  CHECK(App_NVM_Record_Register(1U, 1U, &r1, 5U));
+  CHECK(App_NVM_Record_Register(2U, 1U, r2, 10U));
+  CHECK(!App_NVM_Record_Load(1U));
+  CHECK(App_NVM_Record_SetDirty(1U) && App_NVM_Record_SetDirty(2U));
+  CHECK(HOST_RunUntilIdle(1000U));
+  model->record_addr[0] = nvm_records[0].addr;
+  model->record_addr[1] = nvm_records[1].addr;
+  return 0;
+}
+
+static int TEST_Records_Read(void *arg)
+{
+  struct { uint8_t a[5]; } r1;
+  uint8_t r2[13];
+  uint32_t r3 = 0x11223344U;
+  uint32_t hdr;
+
+  (void)arg;
+
+  App_NVM_Init(HOST_ResetFlags);
+  memset(&r1, 0, sizeof(r1));
+  memset(r2, 0, sizeof(r2));
+  CHECK(App_NVM_Record_Register(2U, 1U, r2, 10U));
+  CHECK(App_NVM_Record_Register(1U, 1U, &r1, 5U));
+  CHECK(App_NVM_Record_Load(1U) && App_NVM_Record_Load(2U));
+  CHECK((r1.a[4] == 5U) && (r2[9] == 7U));
+  CHECK((nvm_records[0].addr == model->record_addr[1]) && (nvm_records[1].addr == model->record_addr[0]));
+
+  /* New version not loaded (at the registration and at a new one), new size
+     reallocated, new record appended */
+  CHECK(App_NVM_Record_Register(1U, 2U, &r1, 5U) && !App_NVM_Record_Load(1U));
+  CHECK(nvm_records[1].addr == model->record_addr[0]);
+  nvm_records_nb = 0U;
+  CHECK(App_NVM_Record_Register(1U, 2U, &r1, 5U) && !App_NVM_Record_Load(1U));
+  CHECK(App_NVM_Record_Register(2U, 1U, r2, 13U) && !App_NVM_Record_Load(2U));
+  CHECK(nvm_records[1].addr != model->record_addr[1]);
+  CHECK(App_NVM_Record_Register(3U, 1U, &r3, 4U) && App_NVM_Record_SetDirty(3U));
+  App_NVM_Record_Flush();
+  CHECK((EE_Read(APP_NVM_DATA_BANK, model->record_addr[1], &hdr) == EE_OK) && ((hdr & 0xFFFFU) == APP_NVM_RECORD_ID_FREE));
+  return 0;
+}
+
+/* Record written with a power cut at any step : the previous or the new
+   value is loaded at the next boot */
+static int TEST_Records_Cut(void *arg)
+{
+  uint8_t record[TEST_RECORD_LEN];
+  uint32_t i;
+
+  (void)arg;
+
+  App_NVM_Init(HOST_ResetFlags);
+  CHECK(App_NVM_Record_Register(4U, 1U, record, sizeof(record)));
+  if (model->record_written)
+  {
+    CHECK(App_NVM_Record_Load(4U));
+    if (memcmp(record, model->record_new, sizeof(record)) == 0)
+    {
+      model->record_nb_new++;
+    }
+    else
+    {
+      CHECK(memcmp(record, model->record_old, sizeof(record)) == 0);
+    }
+    memcpy(model->record_old, record, sizeof(record));
+  }
+
+  model->record_nb++;
+  for (i = 0U; i < sizeof(record); i++)
+  {
+    record[i] = (uint8_t)((model->record_nb * 31U) + (i * 7U));
+  }
+  memcpy(model->record_new, record, sizeof(record));
+  CHECK(App_NVM_Record_SetDirty(4U));
+  App_NVM_Record_Flush();
+  model->record_written = true;
+  return 0;
+}
+
+static int TEST_Records(void)
+{
+  HOST_BootResult_t result = HOST_BOOT_RETURNED;
+  uint32_t nb_cut = 0U;
+  uint32_t i;
+
+  CHECK(HOST_Boot(HOST_RESET_POWER_ON, TEST_Records_Write, NULL) == HOST_BOOT_RETURNED);
+  CHECK(HOST_Boot(HOST_RESET_POWER_ON, TEST_Records_Read, NULL) == HOST_BOOT_RETURNED);
+  printf("nvm: records reloaded, reallocated on a size change\n");
+
+  for (i = 0U; i < TEST_RECORD_CUTS; i++)
+  {
+    HOST_FlashCutAt(rand() % 16);
+    result = HOST_Boot((result == HOST_BOOT_POWER_LOSS) ? HOST_RESET_POWER_LOSS : HOST_RESET_POWER_ON,
+                       TEST_Records_Cut, NULL);
+    HOST_FlashCutAt(-1);
+    CHECK((result == HOST_BOOT_RETURNED) || (result == HOST_BOOT_POWER_LOSS));
+    nb_cut += (result == HOST_BOOT_POWER_LOSS);
+  }
+  CHECK(HOST_Boot(HOST_RESET_POWER_ON, TEST_Records_Cut, NULL) == HOST_BOOT_RETURNED);
+  printf("nvm: record written through %u power cuts (%u read back new)\n",
+         (unsigned)nb_cut, (unsigned)model->record_nb_new);
+  return 0;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+int main(void)
+{
+  srand(TEST_SEED);
+  HOST_Init();
+  model = HOST_SharedAlloc(sizeof(TEST_Model_t));
+
+  CHECK(TEST_Saves() == 0);
+
+  CHECK(HOST_Boot(HOST_RESET_POWER_ON, TEST_Shutdown, NULL) == HOST_BOOT_SOFTWARE_RESET);
+  CHECK(HOST_Boot(HOST_RESET_SOFTWARE, TEST_Warm_Corrupt, NULL) == HOST_BOOT_RETURNED);
+  printf("nvm: corrupted RAM cache not used after a warm reset\n");
+
+  CHECK(HOST_Boot(HOST_RESET_POWER_ON, TEST_Guard, NULL) == HOST_BOOT_RETURNED);
+  CHECK(TEST_Transfer() == 0);
+
+  CHECK(TEST_Records() == 0);
+
+  CHECK(HOST_Boot(HOST_RESET_POWER_ON, TEST_Legacy, NULL) == HOST_BOOT_RETURNED);
+  CHECK(HOST_Boot(HOST_RESET_POWER_ON, TEST_Corrupt, NULL) == HOST_BOOT_RETURNED);
+  printf("nvm: legacy image and corrupted snapshots rejected\n");
+  return 0;
+}